@@ -50,6 +50,14 @@ if errorlevel 1 (
     GOTO :EOF
 )
 
+call %DIR_CMD%\results.cmd !args!
+if errorlevel 1 (
+    if %timed% EQU 1 (
+        ctime.exe -end metrics\all.ctm %errorlevel%
+    )
+    GOTO :EOF
+)
+
 if %timed% EQU 1 (
     ctime.exe -end metrics\all.ctm %errorlevel%
 )
@@ -65,5 +73,14 @@ if %test% EQU 1 (
         exception_butts.dll ^
         but_butts.dll
     popd
+
+    REM: run the exception and driver tests on the other backend, too
+    if %seh% EQU 0 (
+        call %DIR_CMD%\exception.cmd !args! seh test
+        if errorlevel 1 (
+            GOTO :EOF
+        )
+        call %DIR_CMD%\but.cmd !args! seh test
+    )
 )
 ENDLOCAL
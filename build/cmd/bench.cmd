@@ -0,0 +1,59 @@
+@ECHO OFF
+SETLOCAL ENABLEDELAYEDEXPANSION ENABLEEXTENSIONS
+
+:: See LICENSE.txt for copyright and licensing information about this file.
+
+SET PROJECT_NAME="BUT Benchmarks"
+SET PROJECT_NAME=%PROJECT_NAME:"=%
+TITLE %PROJECT_NAME%
+
+SET DIR_CMD=%~dp0
+SET DIR_CMD=%DIR_CMD:~0,-1%
+SET DIR_LOCAL=%DIR_CMD%\local
+CALL %DIR_CMD%\options.cmd %*
+
+if %timed% EQU 1 (
+    if NOT EXIST metrics (
+        md metrics
+    )
+    ctime.exe -begin metrics\bench.ctm
+)
+
+CALL %DIR_CMD%\setup.cmd %*
+
+:: Build the project
+IF %build% EQU 1 (
+    IF %verbose% EQU 1 (
+        ECHO.
+        ECHO Build the %PROJECT_NAME%
+    )
+    cl %CommonCompilerFlagsFinal% /I%DIR_INCLUDE% ^
+    %DIR_REPO%\cmd\but_bench\but_bench_windows.c /Fo:%DIR_OUT_OBJ%\ ^
+    /Fd:%DIR_OUT_BIN%\but_bench.pdb /Fe:%DIR_OUT_BIN%\but_bench.exe /link ^
+    %CommonLinkerFlagsFinal% dbghelp.lib /ENTRY:mainCRTStartup
+    if errorlevel 1 (
+        echo failed to build the %PROJECT_NAME%
+        if %timed% EQU 1 (
+            ctime.exe -end metrics\bench.ctm %errorlevel%
+        )
+        GOTO :EOF
+    )
+)
+
+if %timed% EQU 1 (
+    ctime.exe -end metrics\bench.ctm %errorlevel%
+)
+
+:: Benchmarks are only meaningful in optimized builds, so compare results from
+:: "bench.cmd release test" runs. Each line of but_bench.jsonl is one JSON object.
+if %test% EQU 1 (
+    if %verbose% EQU 1 (
+        ECHO Run the %PROJECT_NAME%
+        ECHO.
+    )
+    pushd %DIR_OUT_BIN%
+    but_bench.exe but_bench.jsonl
+    type but_bench.jsonl
+    popd
+)
+ENDLOCAL
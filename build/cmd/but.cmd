@@ -37,7 +37,7 @@ IF %build% EQU 1 (
     cl %CommonCompilerFlagsFinal% /I"%DIR_INCLUDE%" /DDLL_BUILD ^
         %DIR_REPO%\src\but_butts.c /Fo:%DIR_OUT_OBJ%\ ^
         /Fd:%DIR_OUT_BIN%\but_butts.pdb ^
-        /LD /link %CommonLinkerFlagsFinal% /LIBPATH:%DIR_OUT_LIB% ^
+        /LD /link %CommonLinkerFlagsFinal% /LIBPATH:%DIR_OUT_LIB% dbghelp.lib ^
         /OUT:%DIR_OUT_BIN%\but_butts.dll /IMPLIB:%DIR_OUT_LIB%\but_butts.lib
     if errorlevel 1 (
         echo failed to build the %PROJECT_NAME% driver test suite
@@ -54,7 +54,7 @@ IF %build% EQU 1 (
     cl %CommonCompilerFlagsFinal% /I"%DIR_INCLUDE%" /DDLL_BUILD ^
     %DIR_REPO%\src\but_test_data.c ^
     /Fo:%DIR_OUT_OBJ%\ /Fd:%DIR_OUT_BIN%\but_test_data.pdb ^
-    /LD /link %CommonLinkerFlagsFinal% ^
+    /LD /link %CommonLinkerFlagsFinal% dbghelp.lib ^
     /OUT:%DIR_OUT_BIN%\but_test_data.dll ^
     /IMPLIB:%DIR_OUT_LIB%\but_test_data.lib
     if errorlevel 1 (
@@ -72,7 +72,7 @@ IF %build% EQU 1 (
     cl %CommonCompilerFlagsFinal% /I%DIR_INCLUDE% ^
     %DIR_REPO%\cmd\but\but_main_windows.c  /Fo:%DIR_OUT_OBJ%\ ^
     /Fd:%DIR_OUT_BIN%\but.pdb /Fe:%DIR_OUT_BIN%\but.exe /link ^
-    %CommonLinkerFlagsFinal% /ENTRY:mainCRTStartup
+    %CommonLinkerFlagsFinal% dbghelp.lib /ENTRY:mainCRTStartup
     if errorlevel 1 (
         echo failed to build the %PROJECT_NAME% Program
         if %timed% EQU 1 (
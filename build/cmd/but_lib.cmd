@@ -29,6 +29,8 @@ IF %build% EQU 1 (
 
     REM: Compile source files to object files
     cl %CommonCompilerFlagsFinal% /I"%DIR_INCLUDE%" /c ^
+        %DIR_REPO%\src\but_assert.c ^
+        %DIR_REPO%\src\but_tracing.c ^
         %DIR_REPO%\src\exception.c ^
         %DIR_REPO%\src\exception_assert.c ^
         %DIR_REPO%\src\log.c ^
@@ -44,6 +46,8 @@ IF %build% EQU 1 (
     REM: Link object files into static library
     lib /NOLOGO ^
         /OUT:%DIR_OUT_LIB%\but.lib ^
+        %DIR_OUT_OBJ%\but_assert.obj ^
+        %DIR_OUT_OBJ%\but_tracing.obj ^
         %DIR_OUT_OBJ%\exception.obj ^
         %DIR_OUT_OBJ%\exception_assert.obj ^
         %DIR_OUT_OBJ%\log.obj
@@ -59,6 +63,7 @@ IF %build% EQU 1 (
     COPY %DIR_INCLUDE%\but.h %DIR_OUT_INC%\ 1>NUL
     COPY %DIR_INCLUDE%\but_assert.h %DIR_OUT_INC%\ 1>NUL
     COPY %DIR_INCLUDE%\but_macros.h %DIR_OUT_INC%\ 1>NUL
+    COPY %DIR_INCLUDE%\but_tracing.h %DIR_OUT_INC%\ 1>NUL
     COPY %DIR_INCLUDE%\exception.h %DIR_OUT_INC%\ 1>NUL
     COPY %DIR_INCLUDE%\exception_assert.h %DIR_OUT_INC%\ 1>NUL
     COPY %DIR_INCLUDE%\exception_types.h %DIR_OUT_INC%\ 1>NUL
@@ -183,6 +183,12 @@ IF %release% EQU 1 (
     SET CommonCompilerFlagsFinal=%CommonCompilerFlagsDEBUG%
 )
 
+:: BUT_EXCEPTIONS_SEH selects the exception backend built on structured exception handling.
+:: Every module must use the same backend, so it's a common flag.
+IF %seh% EQU 1 (
+    SET CommonCompilerFlagsFinal=%CommonCompilerFlagsFinal% /DBUT_EXCEPTIONS_SEH
+)
+
 :: Can't use this to eliminate the C runtime when setjmp/longjmp are used
 SET LinkerNoDefault=/nodefaultlib kernel32.lib
 
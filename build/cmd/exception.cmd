@@ -26,6 +26,9 @@ IF NOT "%release%"=="" (
         SET REL_OPT=release
     )
 )
+if %seh% EQU 1 (
+    SET SEH_OPT=seh
+)
 
 :: Build the project
 IF %build% EQU 1 (
@@ -64,7 +67,7 @@ if %timed% EQU 1 (
 
 if %test% EQU 1 (
     IF NOT EXIST "%DIR_OUT_BIN%\but.exe" (
-        call %DIR_CMD%\but.cmd build %REL_OPT%
+        call %DIR_CMD%\but.cmd build %REL_OPT% %SEH_OPT%
         if errorlevel 1 (
             GOTO :EOF
         )
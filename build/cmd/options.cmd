@@ -25,9 +25,11 @@ SETLOCAL ENABLEDELAYEDEXPANSION ENABLEEXTENSIONS
 ::  verbose:    Display details of steps during the build process.
 ::  trace:      Display the values of these options.
 ::  timed:      Enable timing metrics collection with ctime.
+::  seh:        build the exception library on structured exception handling
+::              instead of setjmp/longjmp.
 
 :: Remember to export these in the ENDLOCAL section below
-SET "options=build: debug: release: cleanall: clean: cleanplat: x64: x86: win32: test: vs2017: vs2019: vs2022: verbose: trace: timed:"
+SET "options=build: debug: release: cleanall: clean: cleanplat: x64: x86: win32: test: vs2017: vs2019: vs2022: verbose: trace: timed: seh:"
 :: Initialize flags to zero
 FOR %%O in (%options%) DO FOR /f "tokens=1,* delims=:" %%A in ("%%O") DO (
     if NOT "%%~B"=="" (
@@ -108,4 +110,5 @@ ENDLOCAL & (
     SET "verbose=%verbose%"
     SET "trace=%trace%"
     SET "timed=%timed%"
+    SET "seh=%seh%"
 )
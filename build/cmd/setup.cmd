@@ -86,6 +86,8 @@ if %debug% EQU 1 (
 ) else (
     SET BUILD_TYPE=release
 )
+:: The structured exception handling backend builds into a folder of its own
+if %seh% EQU 1 SET BUILD_TYPE=!BUILD_TYPE!-seh
 
 if %build% EQU 1 (
     IF "%VSSOLUTION%"=="" (
@@ -7,17 +7,35 @@
  *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
+#include "../../src/but_alloc.c"
+#include "../../src/but_arena.c"
+#include "../../src/but_case_table.c"
+#include "../../src/but_capture.c"
 #include "../../src/but_driver.c"
+#include "../../src/but_events.c"
+#include "../../src/but_junit.c"
+#include "../../src/but_perf.c"
+#include "../../src/but_profile.c"
+#include "../../src/but_progress.c"
+#include "../../src/but_report.c"
 #include "../../src/but_result_context.c"
+#include "../../src/but_results.c"
+#include "../../src/but_timer.c"
+#include "../../src/but_trace.c"
+#include "../../src/but_usage.c"
 #include "../../src/exception_assert.c"
 #include "../../src/exception.c"
 #include "../../src/log.c"
 
-#include <but_macros.h> // BUT_CONTAINER
+#include <abbreviated_types.h> // flag32, u64
+#include <but_macros.h>        // BUT_CONTAINER, BUT_ARRAY_COUNT
 
-#include <stddef.h> // size_t
-#include <stdio.h>  // printf, snprintf
-#include <stdlib.h> // exit
+#include <inttypes.h> // PRIu64
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t, offsetof
+#include <stdio.h>    // printf, snprintf
+#include <stdlib.h>   // exit, malloc, free, qsort, strtol, strtoul
+#include <string.h>   // strcmp, strcspn
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -51,6 +69,331 @@ static BUT_HANDLER_FN(exception_handler) {
     }
 }
 
+/**
+ * @brief A resource-usage measurement by which the summary of a test suite can be
+ * sorted.
+ */
+typedef struct UsageMetric {
+    char const *name;   ///< the name given to --sort-by
+    char const *label;  ///< the name used in the summary
+    size_t      offset; ///< the offset of the measurement in a BUTUsage
+} UsageMetric;
+
+static UsageMetric const g_usage_metrics_[] = {
+    {"user", "user CPU time (ns)", offsetof(BUTUsage, user_ns)},
+    {"system", "system CPU time (ns)", offsetof(BUTUsage, system_ns)},
+    {"rss", "peak RSS growth (bytes)", offsetof(BUTUsage, peak_rss_bytes)},
+    {"faults", "page faults", offsetof(BUTUsage, page_faults)},
+    {"switches", "context switches", offsetof(BUTUsage, context_switches)},
+    {"io", "I/O operations", offsetof(BUTUsage, io_operations)},
+};
+
+/**
+ * @brief The command-line options and the paths to the test suites to exercise.
+ */
+typedef struct DriverOptions {
+    flag32             flags;          ///< BUTOption flags passed to but_set_options
+    UsageMetric const *sort_by;        ///< sort each suite's usage by this, or NULL
+    u32                slowest;        ///< the number of slowest cases to list, or 0
+    char const        *profile;        ///< the path for folded stacks, or NULL
+    FILE              *profile_out;    ///< the stream opened from profile
+    char const        *trace;          ///< the path for the timeline, or NULL
+    char const        *junit_path;     ///< the path for the JUnit report, or NULL
+    BUTJUnit          *junit;          ///< the JUnit report opened from junit_path
+    char const        *results_path;   ///< the path for the binary result log, or NULL
+    BUTResultsWriter  *results;        ///< the result log opened from results_path
+    BUTProgress       *progress;       ///< the progress line, unless verbose is set
+    char const        *events_path;    ///< the path for the event stream, or NULL
+    int                events_fd;      ///< the descriptor for the event stream, or -1
+    BUTEvents         *events;         ///< the event stream
+    bool               capture_output; ///< true to capture each case's output
+    BUTCapture        *capture;        ///< captures each case's output, or NULL
+    bool               verbose;        ///< list each test case, not a progress line
+    char             **suites;         ///< paths to test suites in the order given
+    int                suite_count;    ///< the number of test-suite paths
+} DriverOptions;
+
+static void display_usage(char const *program) {
+    printf("Usage: %s [options] (path to test suite)+\n", program);
+    printf("Options:\n");
+    printf("  --verbose         list each test case as it runs, instead of a progress "
+           "line\n");
+    printf("  --capture         capture each test's output, and print it only if the "
+           "test fails\n");
+    printf("  --perf-counters   report hardware performance counters for each test\n");
+    printf("  --track-allocs    report heap allocations and leaks for each test\n");
+    printf("  --leaks-fail      fail tests that leak heap memory; implies "
+           "--track-allocs\n");
+    printf("  --usage           report CPU time, memory, page faults, context "
+           "switches, and I/O for each test\n");
+    printf("  --sort-by METRIC  list each suite's tests by METRIC, largest first; "
+           "implies --usage\n");
+    printf("                    METRIC is one of:");
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(g_usage_metrics_); i++) {
+        printf(" %s", g_usage_metrics_[i].name);
+    }
+    printf("\n");
+    printf("  --slowest N       list each suite's N slowest tests, and the suites that "
+           "spend most of their time in setup and cleanup\n");
+    printf("  --profile FILE    sample each test function and write folded stacks to "
+           "FILE\n");
+    printf("  --junit FILE      write a JUnit XML report to FILE as each test "
+           "finishes\n");
+    printf("  --results FILE    append each test's result to a binary log in FILE\n");
+    printf("  --events FILE     write a JSON line to FILE for each event of the run\n");
+    printf("  --events-fd N     write the JSON events to file descriptor N\n");
+    printf("  --trace FILE      write a timeline of the run to FILE in the Chrome "
+           "trace-event format\n");
+}
+
+static UsageMetric const *find_usage_metric(char const *name) {
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(g_usage_metrics_); i++) {
+        if (strcmp(g_usage_metrics_[i].name, name) == 0) {
+            return &g_usage_metrics_[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief separate options from test-suite paths.
+ *
+ * @param argc the number of command-line arguments.
+ * @param argv the command-line arguments.
+ * @param options receives the options and test-suite paths.
+ * @return true if the command line is valid, and false otherwise.
+ */
+static bool parse_options(int argc, char **argv, DriverOptions *options) {
+    options->flags          = 0;
+    options->sort_by        = NULL;
+    options->slowest        = 0;
+    options->profile        = NULL;
+    options->profile_out    = NULL;
+    options->trace          = NULL;
+    options->junit_path     = NULL;
+    options->junit          = NULL;
+    options->results_path   = NULL;
+    options->results        = NULL;
+    options->progress       = NULL;
+    options->events_path    = NULL;
+    options->events_fd      = -1;
+    options->events         = NULL;
+    options->capture_output = false;
+    options->capture        = NULL;
+    options->verbose        = false;
+    options->suite_count    = 0;
+    options->suites         = malloc((size_t)argc * sizeof *options->suites);
+    if (options->suites == NULL) {
+        return false;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            options->suites[options->suite_count++] = argv[i];
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            options->verbose = true;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            options->capture_output = true;
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            options->flags |= BUT_OPTION_PERF_COUNTERS;
+        } else if (strcmp(argv[i], "--track-allocs") == 0) {
+            options->flags |= BUT_OPTION_TRACK_ALLOCS;
+        } else if (strcmp(argv[i], "--leaks-fail") == 0) {
+            options->flags |= BUT_OPTION_TRACK_ALLOCS | BUT_OPTION_LEAKS_FAIL;
+        } else if (strcmp(argv[i], "--usage") == 0) {
+            options->flags |= BUT_OPTION_USAGE;
+        } else if (strcmp(argv[i], "--sort-by") == 0) {
+            if (i + 1 < argc) {
+                options->sort_by = find_usage_metric(argv[++i]);
+            }
+            if (options->sort_by == NULL) {
+                printf("Error: --sort-by requires a metric\n");
+                return false;
+            }
+            options->flags |= BUT_OPTION_USAGE;
+        } else if (strcmp(argv[i], "--slowest") == 0) {
+            char *end = NULL;
+
+            if (i + 1 < argc) {
+                options->slowest = (u32)strtoul(argv[++i], &end, 10);
+            }
+            if (end == NULL || *end != '\0' || options->slowest == 0) {
+                printf("Error: --slowest requires a number of test cases\n");
+                return false;
+            }
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            if (i + 1 == argc) {
+                printf("Error: --profile requires a file\n");
+                return false;
+            }
+            options->profile = argv[++i];
+            options->flags |= BUT_OPTION_PROFILE;
+        } else if (strcmp(argv[i], "--results") == 0) {
+            if (i + 1 == argc) {
+                printf("Error: --results requires a file\n");
+                return false;
+            }
+            options->results_path = argv[++i];
+        } else if (strcmp(argv[i], "--events") == 0) {
+            if (i + 1 == argc) {
+                printf("Error: --events requires a file\n");
+                return false;
+            }
+            options->events_path = argv[++i];
+        } else if (strcmp(argv[i], "--events-fd") == 0) {
+            char *end = NULL;
+
+            if (i + 1 < argc) {
+                options->events_fd = (int)strtol(argv[++i], &end, 10);
+            }
+            if (end == NULL || *end != '\0' || options->events_fd < 0) {
+                printf("Error: --events-fd requires a file descriptor\n");
+                return false;
+            }
+        } else if (strcmp(argv[i], "--junit") == 0) {
+            if (i + 1 == argc) {
+                printf("Error: --junit requires a file\n");
+                return false;
+            }
+            options->junit_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 == argc) {
+                printf("Error: --trace requires a file\n");
+                return false;
+            }
+            options->trace = argv[++i];
+            options->flags |= BUT_OPTION_TRACE;
+        } else {
+            printf("Error: unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    // Both would open the one event stream.
+    if (options->events_path != NULL && options->events_fd >= 0) {
+        printf("Error: --events and --events-fd can't be used together\n");
+        return false;
+    }
+
+    // Per-case measurements are printed under each test case's name.
+    if (options->flags
+        & (BUT_OPTION_PERF_COUNTERS | BUT_OPTION_TRACK_ALLOCS | BUT_OPTION_USAGE
+           | BUT_OPTION_TRACE)) {
+        options->verbose = true;
+    }
+
+    return options->suite_count > 0;
+}
+
+static void display_counter(char const *name, BUTPerfCounterFlag flag,
+                            BUTPerfCounters const *counters, u64 value) {
+    if (counters->valid & flag) {
+        printf("%s: %" PRIu64, name, value);
+    } else {
+        printf("%s: n/a", name);
+    }
+}
+
+static void display_case_metrics(BUTContext *bctx) {
+    BUTCaseMetrics const *metrics = but_get_case_metrics(bctx, but_get_index(bctx));
+
+    if (metrics != NULL && (bctx->env.options & BUT_OPTION_PERF_COUNTERS)) {
+        BUTPerfCounters const *counters = &metrics->counters;
+
+        printf("        ");
+        display_counter("cycles", BUT_PERF_CYCLES, counters, counters->cycles);
+        display_counter(", instructions", BUT_PERF_INSTRUCTIONS, counters,
+                        counters->instructions);
+        display_counter(", L1D misses", BUT_PERF_L1D_MISSES, counters,
+                        counters->l1d_misses);
+        display_counter(", LLC misses", BUT_PERF_LLC_MISSES, counters,
+                        counters->llc_misses);
+        display_counter(", branch misses", BUT_PERF_BRANCH_MISSES, counters,
+                        counters->branch_misses);
+        printf("\n");
+    }
+
+    if (metrics != NULL && (bctx->env.options & BUT_OPTION_TRACK_ALLOCS)) {
+        BUTAllocStats const *allocs = &metrics->allocs;
+
+        printf("        allocations: %" PRIu64 ", bytes: %" PRIu64
+               ", peak bytes: %" PRIu64 ", leaks: %u (%" PRIu64 " bytes)\n",
+               allocs->allocations, allocs->bytes, allocs->peak_bytes, allocs->leaks,
+               allocs->leaked_bytes);
+        if (allocs->leaks > 0) {
+            but_alloc_report_leaks(stdout, "          ");
+        }
+    }
+
+    if (metrics != NULL && (bctx->env.options & BUT_OPTION_USAGE)) {
+        BUTUsage const *usage = &metrics->usage;
+
+        printf("        user: %.3f ms, system: %.3f ms, peak RSS growth: %" PRIu64
+               " bytes, page faults: %" PRIu64 ", context switches: ",
+               (double)usage->user_ns / 1e6, (double)usage->system_ns / 1e6,
+               usage->peak_rss_bytes, usage->page_faults);
+        if (usage->switches_valid) {
+            printf("%" PRIu64, usage->context_switches);
+        } else {
+            printf("n/a");
+        }
+        printf(", I/O: %" PRIu64 " operations (%" PRIu64 " bytes)\n",
+               usage->io_operations, usage->io_bytes);
+    }
+
+    if (metrics != NULL && (bctx->env.options & BUT_OPTION_TRACE)
+        && (metrics->trace.count > 0 || metrics->trace.other > 0)) {
+        BUTTraceSummary const *trace = &metrics->trace;
+
+        printf("        trace:");
+        for (u32 i = 0; i < trace->count; i++) {
+            BUTTraceTotal const *total = &trace->totals[i];
+
+            if (total->counter) {
+                printf("%s %s = %" PRId64, i == 0 ? "" : ",", total->name, total->value);
+            } else {
+                printf("%s %s %" PRIu64 "x %.3f ms", i == 0 ? "" : ",", total->name,
+                       total->count, (double)total->total_ns / 1e6);
+            }
+        }
+        if (trace->other > 0) {
+            printf("%s %u more events", trace->count == 0 ? "" : ",", trace->other);
+        }
+        printf("\n");
+    }
+}
+
+static void display_sorted_usage(BUTContext *bctx, BUTTestSuite *bts,
+                                 UsageMetric const *metric) {
+    SortedCase *cases = malloc(bts->count * sizeof *cases);
+    u32         count = 0;
+
+    if (cases == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < bts->count; i++) {
+        BUTCaseMetrics const *metrics = but_get_case_metrics(bctx, i);
+
+        if (metrics != NULL) {
+            cases[count].index = i;
+            cases[count].value
+                = *(u64 const *)((char const *)&metrics->usage + metric->offset);
+            count++;
+        }
+    }
+
+    qsort(cases, count, sizeof *cases, compare_sorted_cases);
+    printf("\nTest cases by %s:\n", metric->label);
+    for (u32 i = 0; i < count; i++) {
+        printf("%20" PRIu64 "  %6u. %s\n", cases[i].value, cases[i].index + 1,
+               but_get_case_name(bctx, cases[i].index));
+    }
+
+    free(cases);
+}
+
 static void display_test_case(BUTContext *bctx) {
     char        counter_buf[16]; // 16 bytes should be plenty for a counter.
     char const *test_case_name;
@@ -64,6 +407,25 @@ static void display_test_case(BUTContext *bctx) {
     printf("%s%s\n", counter_buf, test_case_name);
 }
 
+// Print a line for each way the current test case failed.
+static void display_failures(BUTContext *bctx) {
+    u32                  index = but_get_index(bctx);
+    u32                  count;
+    ResultContext const *results = but_get_case_results(bctx, index, &count);
+
+    for (u32 i = 0; i < count; i++) {
+        printf("%6u. %s: %s", index + 1, but_get_test_case_name(bctx),
+               but_results_status_name(results[i].status));
+        if (results[i].reason != NULL) {
+            printf(": %s", results[i].reason);
+        }
+        if (results[i].file != NULL) {
+            printf(" @%s:%d", results[i].file, results[i].line);
+        }
+        printf("\n");
+    }
+}
+
 static void display_test_results(BUTContext *bctx, BUTTestSuite *bts) {
     size_t passed, setup_failures, test_failures, cleanup_failures, count_total_failures;
     char   counter_buf[6]  = {0};
@@ -109,21 +471,165 @@ static void display_test_results(BUTContext *bctx, BUTTestSuite *bts) {
     }
 }
 
-static void exercise_test_suite(BUTContext *bctx, BUTTestSuite *bts) {
-    but_begin(bctx, bts);
-    while (but_has_more(bctx)) {
+/**
+ * @brief write the result of the current test case to the reports that stream results.
+ *
+ * @param bctx the test context.
+ * @param options the command-line options.
+ * @param duration_ns how long the case took.
+ * @param output what the case printed, or NULL.
+ */
+static void report_case(BUTContext *bctx, DriverOptions const *options,
+                        u64 duration_ns, char const *output) {
+    but_junit_write_case(options->junit, bctx, duration_ns, output);
+    but_events_case_finished(options->events, bctx, duration_ns);
+
+    if (options->results->out != NULL) {
+        u32                  index = but_get_index(bctx);
+        u32                  count;
+        ResultContext const *result = but_get_case_results(bctx, index, &count);
+        BUTResultsEntry      entry;
+
+        entry.suite       = bctx->env.bts->name;
+        entry.name        = but_get_test_case_name(bctx);
+        entry.index       = index;
+        entry.status      = result != NULL ? result->status : BUT_PASSED;
+        entry.reason      = result != NULL ? result->reason : NULL;
+        entry.file        = result != NULL ? result->file : NULL;
+        entry.output      = output;
+        entry.line        = result != NULL ? (u32)result->line : 0;
+        entry.suite_size  = bctx->env.bts->count;
+        entry.duration_ns = duration_ns;
+        but_results_write(options->results, &entry);
+    }
+}
+
+// Finish capturing the output of the current test case, and keep it if it failed.
+static char const *end_capture(BUTContext *bctx, DriverOptions const *options) {
+    if (options->capture == NULL) {
+        return NULL;
+    }
+
+    but_capture_end(options->capture);
+    if (but_get_result(bctx, but_get_index(bctx)) == BUT_PASSED) {
+        return NULL;
+    }
+
+    return but_keep_case_output(bctx, but_capture_read(options->capture));
+}
+
+// Print the captured output of a test case, indented under its results.
+static void display_output(char const *output) {
+    while (*output != '\0') {
+        size_t length = strcspn(output, "\r\n");
+
+        printf("        | %.*s\n", (int)length, output);
+        output += length;
+        if (*output == '\r') {
+            output++;
+        }
+        if (*output == '\n') {
+            output++;
+        }
+    }
+}
+
+/**
+ * @brief the state of the suite being exercised that its case callbacks share.
+ */
+typedef struct SuiteRun {
+    DriverOptions const *options;    ///< the command-line options
+    u64                  case_begin; ///< when the current case started, in timer ticks
+} SuiteRun;
+
+// Announce a test case and start measuring it.
+static BUT_CASE_CALLBACK(case_started) {
+    SuiteRun            *run     = data;
+    DriverOptions const *options = run->options;
+
+    but_events_case_started(options->events, bctx);
+    if (options->verbose) {
         display_test_case(bctx);
-        BUT_TRY {
-            but_driver(bctx);
+    } else {
+        but_progress_begin_case(options->progress, but_get_test_case_name(bctx));
+    }
+    if (options->capture != NULL) {
+        but_capture_begin(options->capture);
+    }
+    run->case_begin = but_timer_now();
+}
+
+// Report a test case, including one whose setup or cleanup threw.
+static BUT_CASE_CALLBACK(case_finished) {
+    SuiteRun            *run     = data;
+    DriverOptions const *options = run->options;
+    u64                  duration_ns;
+    char const          *output;
+
+    duration_ns = but_timer_ticks_to_ns(but_timer_now() - run->case_begin);
+    output      = end_capture(bctx, options);
+
+    report_case(bctx, options, duration_ns, output);
+    if (options->verbose) {
+        display_case_metrics(bctx);
+    } else {
+        bool failed = but_get_result(bctx, but_get_index(bctx)) != BUT_PASSED;
+
+        but_progress_end_case(options->progress, failed);
+        if (failed) {
+            but_progress_clear(options->progress);
+            display_failures(bctx);
         }
-        BUT_CATCH_ALL {
-            BUT_RETHROW;
+    }
+    if (output != NULL) {
+        display_output(output);
+    }
+    if (options->profile_out != NULL) {
+        but_profile_write_folded(&bctx->env.profiler, options->profile_out,
+                                 bctx->env.bts->name, but_get_test_case_name(bctx));
+    }
+}
+
+static void exercise_test_suite(BUTContext *bctx, BUTTestSuite *bts,
+                                DriverOptions const *options, BUTSuiteTimes *times) {
+    SuiteRun        run       = {.options = options};
+    BUTRunCallbacks callbacks = {
+        .case_started  = case_started,
+        .case_finished = case_finished,
+        .data          = &run,
+    };
+
+    but_begin(bctx, bts);
+    but_junit_begin_suite(options->junit, bts);
+    but_results_write_suite(options->results, bts->name, bts->count);
+    if (!options->verbose) {
+        but_progress_begin_suite(options->progress, bts->name, bts->count);
+    }
+    BUT_TRY {
+        but_run_range(bctx, 0, bts->count, &callbacks);
+    }
+    BUT_CATCH_ALL {
+        if (!options->verbose) {
+            but_progress_end_suite(options->progress);
         }
-        BUT_END_TRY;
-        but_next(bctx);
+        BUT_RETHROW;
     }
+    BUT_END_TRY;
 
+    but_junit_end_suite(options->junit);
+    but_events_suite_finished(options->events, bctx);
+    if (!options->verbose) {
+        but_progress_end_suite(options->progress);
+    }
     display_test_results(bctx, bts);
+    if (options->sort_by != NULL) {
+        display_sorted_usage(bctx, bts, options->sort_by);
+    }
+    if (options->slowest > 0) {
+        but_report_slowest(stdout, bctx, bts, options->slowest);
+        but_report_suite_times(bctx, bts, times);
+    }
+    but_end(bctx);
 }
 
 /**
@@ -140,17 +646,105 @@ int main(int argc, char **argv) {
     but_get_test_suite get_test_suite;
     BUTTestSuite      *bts;
     BUTContext         bctx;
+    DriverOptions      options;
+    BUTJUnit           junit   = {0};
+    BUTResultsWriter   results = {0};
+    BUTProgress        progress;
+    BUTCapture         capture;
+    BUTEvents          events  = {0};
+
+    if (parse_options(argc, argv, &options)) {
+        int            test_suites = 0;
+        BUTSuiteTimes *suite_times = NULL;
+
+        if (options.profile != NULL
+            && fopen_s(&options.profile_out, options.profile, "w") != 0) {
+            printf("Error: failed to open %s\n", options.profile);
+            free(options.suites);
+            return 1;
+        }
+
+        options.junit    = &junit;
+        options.results  = &results;
+        options.progress = &progress;
+        options.events   = &events;
+        but_progress_init(&progress, stdout);
+        if (options.results_path != NULL
+            && !but_results_create(&results, options.results_path)) {
+            printf("Error: failed to open %s\n", options.results_path);
+            if (options.profile_out != NULL) {
+                fclose(options.profile_out);
+            }
+            free(options.suites);
+            return 1;
+        }
+
+        if (options.junit_path != NULL
+            && !but_junit_open(&junit, options.junit_path)) {
+            printf("Error: failed to open %s\n", options.junit_path);
+            if (options.profile_out != NULL) {
+                fclose(options.profile_out);
+            }
+            but_results_close(&results);
+            free(options.suites);
+            return 1;
+        }
+
+        if ((options.events_path != NULL
+             && !but_events_open(&events, options.events_path))
+            || (options.events_fd >= 0
+                && !but_events_open_fd(&events, options.events_fd))) {
+            printf("Error: failed to open the event stream\n");
+            if (options.profile_out != NULL) {
+                fclose(options.profile_out);
+            }
+            but_junit_close(&junit);
+            but_results_close(&results);
+            free(options.suites);
+            return 1;
+        }
+
+        if (options.capture_output) {
+            if (!but_capture_open(&capture)) {
+                printf("Error: failed to create a file to capture output, error = %lu\n",
+                       GetLastError());
+                if (options.profile_out != NULL) {
+                    fclose(options.profile_out);
+                }
+                but_junit_close(&junit);
+                but_results_close(&results);
+                but_events_close(&events);
+                free(options.suites);
+                return 1;
+            }
+            options.capture = &capture;
+        }
 
-    if (argc > 1) {
-        int test_suites = 0;
         logger_init();
         logger_set_level(LOG_INFO);
         logger_set_output_by_filename("but.log");
+        if (options.trace != NULL) {
+            but_trace_enable();
+        }
+        but_events_run_started(&events, options.suite_count);
+        if (options.slowest > 0) {
+            suite_times = calloc((size_t)options.suite_count, sizeof *suite_times);
+            if (suite_times == NULL) {
+                options.slowest = 0;
+            }
+        }
 
         BUT_TRY {
-            // Assume each argument is a path to a test suite
-            for (i = 1; i < argc; i++) {
-                ts_path    = argv[i];
+            for (i = 0; i < options.suite_count; i++) {
+                u64 load_begin = but_trace_now();
+                u64 run_begin;
+
+                ts_path = options.suites[i];
+                if (options.capture != NULL) {
+                    // The suite's C runtime binds its streams to the standard handles
+                    // as it's loaded.
+                    but_capture_redirect(options.capture);
+                }
                 test_suite = LoadLibraryA(ts_path);
                 if (test_suite) {
                     but_set_exception_context_fn *set_context
@@ -161,48 +755,94 @@ int main(int argc, char **argv) {
                         set_context = but_set_exception_context;
                         printf("Error: test suite %s doesn't export "
                                "but_set_exception_context\n",
-                               argv[i]);
+                               ts_path);
                     }
 
                     get_test_suite
                         = (but_get_test_suite)GetProcAddress(test_suite,
                                                              "get_test_suite");
                     if (get_test_suite) {
+                        if ((options.flags & BUT_OPTION_TRACK_ALLOCS)
+                            && !but_alloc_attach(test_suite)) {
+                            printf("Warning: can't track heap allocations in %s\n",
+                                   ts_path);
+                        }
                         but_initialize(&bctx, exception_handler);
+                        but_set_options(&bctx, options.flags);
                         // register our exception handler with the test suite.
-                        set_context(&bctx.exception_context, __FILE__, __LINE__);
+                        but_register_suite(&bctx, set_context);
+                        but_attach_thread(&bctx);
+                        if (options.capture != NULL) {
+                            options.capture->flush = (but_flush_output_fn *)
+                                GetProcAddress(test_suite, "but_flush_output");
+                        }
                         bts = get_test_suite();
+                        but_trace_span("load", logger_get_filename(ts_path), load_begin,
+                                       but_trace_now());
+                        but_events_suite_loaded(&events, bts, ts_path);
                         printf("\n%s (%u): test suite %d of %d\n", bts->name, bts->count,
-                               i, argc - 1);
-                        exercise_test_suite(&bctx, bts);
+                               i + 1, options.suite_count);
+                        run_begin = but_trace_now();
+                        exercise_test_suite(&bctx, bts, &options,
+                                            suite_times != NULL
+                                                ? &suite_times[test_suites]
+                                                : NULL);
+                        but_trace_span("suite", bts->name, run_begin, but_trace_now());
+                        but_detach_thread(&bctx);
                         test_suites++;
-                        if (i < argc) {
+                        if (i + 1 < options.suite_count) {
                             printf("*******************************************\n");
                         }
                     } else {
                         printf("Error: test suite %s doesn't export get_test_suite\n",
-                               argv[i]);
+                               ts_path);
                     }
 
+                    if (options.flags & BUT_OPTION_TRACK_ALLOCS) {
+                        but_alloc_detach(test_suite);
+                    }
                     FreeLibrary(test_suite);
                 } else {
                     printf("Failed to load test suite %s, error = %lu\n", ts_path,
                            GetLastError());
                 }
+                if (options.capture != NULL) {
+                    but_capture_restore(options.capture);
+                }
             }
-            if (argc == 2) {
+            but_events_run_finished(&events, test_suites);
+            if (options.slowest > 0) {
+                but_report_fixture_heavy(stdout, suite_times, test_suites);
+            }
+            if (options.suite_count == 1) {
                 printf("\nExercised 1 test suite.\n");
             } else {
-                printf("\nExercised %d of %d test suites.\n", test_suites, argc - 1);
+                printf("\nExercised %d of %d test suites.\n", test_suites,
+                       options.suite_count);
             }
         }
         BUT_FINALLY {
             logger_close();
+            if (options.profile_out != NULL) {
+                fclose(options.profile_out);
+            }
+            but_junit_close(&junit);
+            but_results_close(&results);
+            but_events_close(&events);
+            free(suite_times);
+            if (options.capture != NULL) {
+                but_capture_close(options.capture);
+            }
+            if (options.trace != NULL && !but_trace_write(options.trace)) {
+                printf("Error: failed to write %s\n", options.trace);
+            }
         }
         BUT_END_TRY;
     } else {
-        printf("Usage: %s (path to test suite)+\n", argv[0]);
+        display_usage(argv[0]);
     }
 
+    free(options.suites);
+
     return 0;
 }
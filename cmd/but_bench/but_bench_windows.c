@@ -0,0 +1,333 @@
+/**
+ * @file but_bench_windows.c
+ * @author Douglas Cuthbertson
+ * @brief Benchmarks for the hot paths of the Basic Unit Test (BUT) framework itself.
+ * @version 0.1
+ * @date 2025-09-14
+ *
+ * Each benchmark is run several times and reported as one JSON object per line, so the
+ * output of two builds can be compared to detect regressions in the framework's
+ * overhead.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "../../src/but_alloc.c"
+#include "../../src/but_arena.c"
+#include "../../src/but_case_table.c"
+#include "../../src/but_driver.c"
+#include "../../src/but_perf.c"
+#include "../../src/but_profile.c"
+#include "../../src/but_result_context.c"
+#include "../../src/but_timer.c"
+#include "../../src/but_trace.c"
+#include "../../src/but_usage.c"
+#include "../../src/exception_assert.c"
+#include "../../src/exception.c"
+#include "../../src/log.c"
+
+#include <but.h>               // BUTTestCase, BUTTestSuite
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_EQ_INT, BUT_ASSERT_STREQ
+#include <abbreviated_types.h> // u32, u64
+#include <but_macros.h>        // BUT_UNUSED, BUT_ARRAY_COUNT
+
+#include <inttypes.h> // PRIu64
+#include <stdbool.h>  // bool, true, false
+#include <stdint.h>   // uintptr_t
+#include <stdio.h>    // fprintf, fopen_s
+#include <stdlib.h>   // malloc, free
+
+#define BENCH_REPETITIONS    5        ///< the number of timed runs of each benchmark
+#define BENCH_ITERATIONS     1000000u ///< iterations for the exception and assert paths
+#define BENCH_CASES          1000000u ///< the number of empty cases in the driver suites
+#define BENCH_LOG_ITERATIONS 100000u  ///< log_write flushes each line, so run fewer
+
+typedef void bench_fn(u64 iterations);
+typedef void bench_teardown_fn(void);
+
+typedef struct Benchmark {
+    char const        *name;       ///< the name reported in the output
+    bench_fn          *fn;         ///< the code under measurement
+    u64                iterations; ///< the number of operations in one run
+    bench_fn          *setup;      ///< untimed preparation before each run, or NULL
+    bench_teardown_fn *teardown;   ///< untimed cleanup after each run, or NULL
+} Benchmark;
+
+// Accumulate side effects here so the optimizer can't discard the measured code.
+static u32 volatile g_sink_;
+
+static BUT_SETUP_FN(empty_setup) {
+    BUT_UNUSED(btc);
+}
+
+static BUT_TEST_FN(empty_test) {
+    BUT_UNUSED(btc);
+}
+
+static BUT_CLEANUP_FN(empty_cleanup) {
+    BUT_UNUSED(btc);
+}
+
+// A case with only a test function enters one try block in but_driver.
+static BUTTestCase g_test_only_case_ = {
+    .name    = "empty test",
+    .setup   = NULL,
+    .test    = empty_test,
+    .cleanup = NULL,
+};
+
+// A case with all three functions enters all three try blocks in but_driver.
+static BUTTestCase g_full_case_ = {
+    .name    = "empty setup, test, and cleanup",
+    .setup   = empty_setup,
+    .test    = empty_test,
+    .cleanup = empty_cleanup,
+};
+
+static void bench_try_no_throw(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        BUT_TRY {
+            g_sink_++;
+        }
+        BUT_END_TRY;
+    }
+}
+
+static void bench_throw_catch(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        BUT_TRY {
+            but_throw(but_test_exception, NULL, __FILE__, __LINE__);
+        }
+        BUT_CATCH(but_test_exception) {
+            g_sink_++;
+        }
+        BUT_END_TRY;
+    }
+}
+
+static void bench_get_exception_context(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        g_sink_ += (u32)(uintptr_t)but_get_exception_context(__FILE__, __LINE__);
+    }
+}
+
+static void bench_assert_true(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        u32 value = g_sink_;
+        BUT_ASSERT_TRUE(value == g_sink_);
+    }
+}
+
+static void bench_assert_eq_int(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        int value = (int)g_sink_;
+        BUT_ASSERT_EQ_INT(value, value);
+    }
+}
+
+static void bench_assert_streq(u64 iterations) {
+    char const *volatile expected = "basic unit test";
+
+    for (u64 i = 0; i < iterations; i++) {
+        BUT_ASSERT_STREQ(expected, "basic unit test");
+    }
+}
+
+// The suite the driver benchmarks run. Building it, and beginning and ending it, happen
+// outside the timed region, so only running the cases is measured.
+static BUTContext    g_suite_context_;
+static BUTTestSuite  g_suite_;
+static BUTTestCase **g_suite_cases_;
+
+/**
+ * @brief build and begin a suite of identical cases.
+ *
+ * @param btc the case that fills every slot in the suite.
+ * @param count the number of cases in the suite.
+ */
+static void set_up_empty_suite(BUTTestCase *btc, u64 count) {
+    g_suite_cases_ = malloc(count * sizeof *g_suite_cases_);
+    if (g_suite_cases_ == NULL) {
+        BUT_THROW_DETAILS(but_internal_error, "failed to allocate %" PRIu64 " cases",
+                          count);
+    }
+
+    for (u64 i = 0; i < count; i++) {
+        g_suite_cases_[i] = btc;
+    }
+
+    g_suite_.name       = "empty cases";
+    g_suite_.count      = (u32)count;
+    g_suite_.test_cases = g_suite_cases_;
+
+    but_initialize(&g_suite_context_, NULL);
+    but_begin(&g_suite_context_, &g_suite_);
+}
+
+static void set_up_test_only_suite(u64 iterations) {
+    set_up_empty_suite(&g_test_only_case_, iterations);
+}
+
+static void set_up_full_case_suite(u64 iterations) {
+    set_up_empty_suite(&g_full_case_, iterations);
+}
+
+static void tear_down_empty_suite(void) {
+    but_end(&g_suite_context_);
+    free(g_suite_cases_);
+    g_suite_cases_ = NULL;
+}
+
+// Run the suite the way but.exe did before but_run_range, minus the output.
+static void bench_driver(u64 iterations) {
+    BUT_UNUSED(iterations);
+    while (but_has_more(&g_suite_context_)) {
+        BUT_TRY {
+            but_driver(&g_suite_context_);
+        }
+        BUT_CATCH_ALL {
+            BUT_RETHROW;
+        }
+        BUT_END_TRY;
+        but_next(&g_suite_context_);
+    }
+}
+
+static void bench_run_range(u64 iterations) {
+    BUT_UNUSED(iterations);
+    but_run_range(&g_suite_context_, 0, g_suite_.count, NULL);
+}
+
+// The cost of a log statement that is filtered out, as in but_get_exception_context.
+static void bench_log_filtered(u64 iterations) {
+    for (u64 i = 0; i < iterations; i++) {
+        LOG_TRACE("bench", "iteration %" PRIu64, i);
+    }
+}
+
+static void bench_log_write(u64 iterations) {
+    logger_set_output_by_filename("but_bench.log");
+    for (u64 i = 0; i < iterations; i++) {
+        LOG_INFO("bench", "iteration %" PRIu64, i);
+    }
+    logger_close();
+    logger_set_output(NULL);
+}
+
+static Benchmark g_benchmarks_[] = {
+    {"try_no_throw", bench_try_no_throw, BENCH_ITERATIONS},
+    {"throw_catch", bench_throw_catch, BENCH_ITERATIONS},
+    {"get_exception_context", bench_get_exception_context, BENCH_ITERATIONS},
+    {"assert_true_pass", bench_assert_true, BENCH_ITERATIONS},
+    {"assert_eq_int_pass", bench_assert_eq_int, BENCH_ITERATIONS},
+    {"assert_streq_pass", bench_assert_streq, BENCH_ITERATIONS},
+    {"driver_test_only_case", bench_driver, BENCH_CASES, set_up_test_only_suite,
+     tear_down_empty_suite},
+    {"driver_setup_test_cleanup_case", bench_driver, BENCH_CASES, set_up_full_case_suite,
+     tear_down_empty_suite},
+    {"run_range_test_only_case", bench_run_range, BENCH_CASES, set_up_test_only_suite,
+     tear_down_empty_suite},
+    {"log_write_filtered", bench_log_filtered, BENCH_ITERATIONS},
+    {"log_write", bench_log_write, BENCH_LOG_ITERATIONS},
+};
+
+/**
+ * @brief run a benchmark once, between its setup and teardown, and return the time the
+ * benchmark itself took.
+ *
+ * @param bench the benchmark to run.
+ * @param iterations the number of operations to run.
+ * @return the elapsed time in nanoseconds.
+ */
+static u64 time_benchmark(Benchmark *bench, u64 iterations) {
+    u64 start;
+    u64 elapsed;
+
+    if (bench->setup != NULL) {
+        bench->setup(iterations);
+    }
+
+    start   = but_timer_now();
+    bench->fn(iterations);
+    elapsed = but_timer_ticks_to_ns(but_timer_now() - start);
+
+    if (bench->teardown != NULL) {
+        bench->teardown();
+    }
+
+    return elapsed;
+}
+
+/**
+ * @brief time a benchmark and write the best and mean cost per operation as JSON.
+ *
+ * @param out the stream to which the result is written.
+ * @param bench the benchmark to run.
+ */
+static void run_benchmark(FILE *out, Benchmark *bench) {
+    u64 best_ns  = UINT64_MAX;
+    u64 total_ns = 0;
+
+    // Warm up caches, branch predictors, and lazily initialized state.
+    time_benchmark(bench, bench->iterations / 100 + 1);
+
+    for (int i = 0; i < BENCH_REPETITIONS; i++) {
+        u64 elapsed = time_benchmark(bench, bench->iterations);
+
+        total_ns += elapsed;
+        if (elapsed < best_ns) {
+            best_ns = elapsed;
+        }
+    }
+
+    fprintf(out,
+            "{\"benchmark\": \"%s\", \"iterations\": %" PRIu64
+            ", \"repetitions\": %d, \"best_ns\": %" PRIu64 ", \"mean_ns\": %" PRIu64
+            ", \"best_ns_per_op\": %.3f, \"mean_ns_per_op\": %.3f}\n",
+            bench->name, bench->iterations, BENCH_REPETITIONS, best_ns,
+            total_ns / BENCH_REPETITIONS, (double)best_ns / (double)bench->iterations,
+            (double)total_ns / BENCH_REPETITIONS / (double)bench->iterations);
+    fflush(out);
+}
+
+/**
+ * @brief the entry point for the framework's benchmarks.
+ *
+ * Usage: but_bench [output file]. Results are written to stdout when no output file is
+ * given.
+ *
+ * @param argc
+ * @param argv
+ * @return zero on success, and non-zero if the output file couldn't be opened.
+ */
+int main(int argc, char **argv) {
+    FILE *out    = stdout;
+    int   result = 0;
+
+    if (argc > 1) {
+        if (fopen_s(&out, argv[1], "w") != 0) {
+            fprintf(stderr, "Error: failed to open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    logger_init();
+    logger_set_level(LOG_INFO);
+
+    BUT_TRY {
+        for (size_t i = 0; i < BUT_ARRAY_COUNT(g_benchmarks_); i++) {
+            run_benchmark(out, &g_benchmarks_[i]);
+        }
+    }
+    BUT_CATCH_ALL {
+        fprintf(stderr, "Error: benchmark failed: %s @%s:%u\n", BUT_REASON, BUT_FILE,
+                BUT_LINE);
+        result = 1;
+    }
+    BUT_END_TRY;
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    return result;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file but_results_windows.c
+ * @author Douglas Cuthbertson
+ * @brief Summarize, filter, and compare the binary result logs written by but --results.
+ * @version 0.1
+ * @date 2025-09-25
+ *
+ *     but_results summary LOG...
+ *     but_results filter [--status STATUS] [--suite SUITE] [--reason TEXT] LOG...
+ *     but_results diff BASE_LOG LOG
+ *     but_results merge LOG...
+ *
+ * The commands are in but_results_tool.c.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "../../src/but_results.c"
+#include "../../src/but_results_tool.c"
+
+#include <stdio.h>  // printf
+#include <string.h> // strcmp
+
+static void display_usage(char const *program) {
+    printf("Usage: %s COMMAND ARGS\n", program);
+    printf("  summary LOG...             count the results by status, suite, reason\n");
+    printf("  filter [OPTIONS] LOG...    list the results that match every option\n");
+    printf("      --status STATUS        passed, failed, setup, cleanup, or not run\n");
+    printf("      --suite SUITE          results from the suite named SUITE\n");
+    printf("      --reason TEXT          results whose reason contains TEXT\n");
+    printf("  diff BASE_LOG LOG          list the cases whose status differs\n");
+    printf("  merge LOG...               total the shards of a run, and list their\n");
+    printf("                             failures and duplicate or missing cases\n");
+    printf("A command exits with 1 if it found failures, regressions, or gaps.\n");
+}
+
+int main(int argc, char **argv) {
+    int result = 2;
+
+    if (argc >= 3 && strcmp(argv[1], "summary") == 0) {
+        result = but_results_summary(stdout, &argv[2], argc - 2);
+    } else if (argc >= 3 && strcmp(argv[1], "filter") == 0) {
+        result = but_results_filter(stdout, &argv[2], argc - 2);
+    } else if (argc == 4 && strcmp(argv[1], "diff") == 0) {
+        result = but_results_diff(stdout, &argv[2]);
+    } else if (argc >= 3 && strcmp(argv[1], "merge") == 0) {
+        result = but_results_merge(stdout, &argv[2], argc - 2);
+    } else {
+        display_usage(argv[0]);
+    }
+
+    return result;
+}
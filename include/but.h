@@ -10,12 +10,10 @@
  *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
-#include <exception.h>         // but_expected_failure
+#include <exception.h>         // but_reason_id, BUT_REASON_ID_EXPECTED_FAILURE
 #include <abbreviated_types.h> // u32
 #include <but_macros.h>        // BUT_UNUSED
 
-#include <string.h> // strcmp
-
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -23,12 +21,14 @@ extern "C" {
 /**
  * @brief produce a non-zero value for any exception except but_expected_failure.
  *
- * We use strcmp(), because the exception library is statically linked to both
- * executables (like a test driver) and shared libraries (like a test suite).
- * That means the address of an exception thrown by a shared library and caught
- * by a test driver won't be the same, but their string-values will be.
+ * We compare reason numbers, because the exception library is statically linked to both
+ * executables (like a test driver) and shared libraries (like a test suite). That means
+ * the address of an exception thrown by a shared library and caught by a test driver
+ * won't be the same, but their numbers will be. In a catch block, comparing
+ * BUT_REASON_ID to BUT_REASON_ID_EXPECTED_FAILURE does the same without a lookup.
  */
-#define BUT_UNEXPECTED_EXCEPTION(e) strcmp((e), but_expected_failure)
+#define BUT_UNEXPECTED_EXCEPTION(e) \
+    (but_reason_id(BUT_CURRENT_CONTEXT, (e)) != BUT_REASON_ID_EXPECTED_FAILURE)
 
 // Forward declaration to suppress "warning C4115: 'BUTTestCase': named type
 // definition in parentheses"
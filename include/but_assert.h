@@ -14,6 +14,7 @@
 
 #include <inttypes.h> // PRIu32, PRId64, etc.
 #include <math.h>     // fabs
+#include <stdint.h>   // uint64_t
 #include <string.h>   // strcmp, memcmp
 #include <stddef.h>   // size_t, NULL
 
@@ -296,6 +297,100 @@ extern "C" {
         }                                                                           \
     } while (0)
 
+// Allocation budgets
+//
+// The first allocation budget a test suite uses interposes on the HeapAlloc and
+// HeapReAlloc imports of the suite's own module, which the C runtime's malloc, calloc,
+// and realloc are built on when the suite links the C runtime statically. Only that
+// module's import table is patched, so allocations made by other DLLs, including a
+// C runtime DLL the suite links against, aren't counted. Each counted allocation on a
+// thread increments a per-thread counter. A budget compares the
+// counter before and after a block of code and throws but_unexpected_failure when the
+// block allocated more than its limit. The details include the number of allocations and
+// the call site of the first one.
+
+/// the number of return addresses captured for the first allocation in a budget
+#define BUT_ALLOC_BUDGET_FRAMES 8
+
+/**
+ * @brief The state of an allocation budget. Budgets may be nested.
+ */
+typedef struct BUTAllocBudget {
+    uint64_t start;                                 ///< allocation count at the start
+    uint64_t outer_watch;                           ///< the enclosing budget's watch
+    uint64_t outer_site;                            ///< the allocation in outer_frames
+    void    *outer_frames[BUT_ALLOC_BUDGET_FRAMES]; ///< the call stack of outer_site
+    uint16_t outer_frame_count;                     ///< the number of outer_frames
+} BUTAllocBudget;
+
+/**
+ * @brief start counting the allocations made by the calling thread.
+ *
+ * @param budget the budget's state.
+ * @param file the path to the file in which the budget begins.
+ * @param line the line on which the budget begins.
+ */
+void but_alloc_budget_begin(BUTAllocBudget *budget, char const *file, int line);
+
+/**
+ * @brief stop counting the allocations made by the calling thread, and throw
+ * but_unexpected_failure if there were more than max_allocs of them.
+ *
+ * @param budget the budget's state.
+ * @param max_allocs the number of allocations allowed since but_alloc_budget_begin.
+ * @param file the path to the file in which the budget ends.
+ * @param line the line on which the budget ends.
+ */
+void but_alloc_budget_end(BUTAllocBudget *budget, uint64_t max_allocs, char const *file,
+                          int line);
+
+/**
+ * @brief stop counting the allocations made by the calling thread without checking
+ * them, and restore the enclosing budget. The budget macros call this when the code
+ * they guard throws.
+ *
+ * @param budget the budget's state.
+ */
+void but_alloc_budget_cancel(BUTAllocBudget *budget);
+
+// Assert that the code between BUT_ASSERT_NO_ALLOC_BEGIN and BUT_ASSERT_NO_ALLOC_END
+// doesn't allocate. The two must be used in the same scope. The code between them runs
+// in a BUT_TRY block, so if it throws, the budget is cancelled before the exception
+// propagates; don't return from it.
+#define BUT_ASSERT_NO_ALLOC_BEGIN                                       \
+    do {                                                                \
+        BUTAllocBudget _but_alloc_budget;                               \
+        but_alloc_budget_begin(&_but_alloc_budget, __FILE__, __LINE__); \
+        BUT_TRY {
+
+#define BUT_ASSERT_NO_ALLOC_END                                      \
+    }                                                                \
+    BUT_CATCH_ALL {                                                  \
+        but_alloc_budget_cancel(&_but_alloc_budget);                 \
+        BUT_RETHROW;                                                 \
+    }                                                                \
+    BUT_END_TRY;                                                     \
+    but_alloc_budget_end(&_but_alloc_budget, 0, __FILE__, __LINE__); \
+    }                                                                \
+    while (0)
+
+// Assert that a block of code makes at most MAX_ALLOCS allocations. If the block throws,
+// the budget is cancelled before the exception propagates.
+#define BUT_ASSERT_MAX_ALLOCS(MAX_ALLOCS, ...)                                      \
+    do {                                                                            \
+        BUTAllocBudget _but_alloc_budget;                                           \
+        but_alloc_budget_begin(&_but_alloc_budget, __FILE__, __LINE__);             \
+        BUT_TRY {                                                                   \
+            __VA_ARGS__;                                                            \
+        }                                                                           \
+        BUT_CATCH_ALL {                                                             \
+            but_alloc_budget_cancel(&_but_alloc_budget);                            \
+            BUT_RETHROW;                                                            \
+        }                                                                           \
+        BUT_END_TRY;                                                                \
+        but_alloc_budget_end(&_but_alloc_budget, (MAX_ALLOCS), __FILE__, __LINE__); \
+    } while (0)
+
 // Generic macros (type-agnostic), but requires C11 or later for _Generic support
 // Customize the fallback behavior of the generic assertions. Override with:
 //  #define BUT_ASSERT_EQ_CUSTOM MyCustomType: MY_ASSERT_EQ
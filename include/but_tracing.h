@@ -0,0 +1,96 @@
+#ifndef BUT_TRACING_H_
+#define BUT_TRACING_H_
+
+/**
+ * @file but_tracing.h
+ * @author Douglas Cuthbertson
+ * @brief Trace spans and counters that test suites can add to the code they exercise.
+ * @version 0.1
+ * @date 2025-09-23
+ *
+ * The driver records the events when it runs with --trace: each span and counter is
+ * summarized with the results of the test case that recorded it and is written to the
+ * timeline. Otherwise there's no tracer, and a span costs a couple of predictable
+ * branches and no clock reads.
+ *
+ *     BUT_TRACE_SCOPE("parse") {
+ *         parse(input);
+ *     }
+ *     BUT_TRACE_COUNTER("queue depth", queue_length(queue));
+ *
+ * Events are recorded only on threads that share the driver's exception context, which
+ * includes the thread that runs the test functions.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // i64, u64
+
+#include <stdbool.h> // bool
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief the functions a driver provides to record the events of a test suite. The
+ * driver installs it in its BUTExceptionContext.
+ */
+typedef struct BUTTracer {
+    u64 (*now)(void); ///< read the tracer's clock
+    void (*span)(char const *name, u64 begin, u64 end); ///< record a span
+    void (*counter)(char const *name, i64 value);       ///< record a counter's value
+} BUTTracer;
+
+/**
+ * @brief the state of an open span.
+ */
+typedef struct BUTTraceScope {
+    BUTTracer const *tracer; ///< the tracer that records the span, or NULL
+    char const      *name;   ///< the name of the span
+    u64              begin;  ///< the time the span started, from tracer->now
+    bool             open;   ///< true until the span ends
+} BUTTraceScope;
+
+/**
+ * @brief start a span.
+ *
+ * @param name the name of the span. It's copied when the span ends.
+ * @return the state of the span, to be passed to but_trace_scope_end.
+ */
+BUTTraceScope but_trace_scope_begin(char const *name);
+
+/**
+ * @brief end a span and record it.
+ *
+ * @param scope a span started by but_trace_scope_begin.
+ */
+void but_trace_scope_end(BUTTraceScope *scope);
+
+/**
+ * @brief record the value of a counter.
+ *
+ * @param name the name of the counter.
+ * @param value its current value.
+ */
+void but_trace_counter(char const *name, i64 value);
+
+#define BUT_TRACE_CONCAT_(a, b) a##b
+#define BUT_TRACE_CONCAT(a, b)  BUT_TRACE_CONCAT_(a, b)
+
+// Record the statement or block that follows as a span named NAME. Leaving the block
+// with break, goto, return, or an exception skips the end of the span, so the span
+// isn't recorded. Use at most one per line.
+#define BUT_TRACE_SCOPE(NAME)                                                        \
+    for (BUTTraceScope BUT_TRACE_CONCAT(_but_trace_scope_, __LINE__)                 \
+         = but_trace_scope_begin(NAME);                                              \
+         BUT_TRACE_CONCAT(_but_trace_scope_, __LINE__).open;                         \
+         but_trace_scope_end(&BUT_TRACE_CONCAT(_but_trace_scope_, __LINE__)))
+
+// Record VALUE as the current value of the counter named NAME.
+#define BUT_TRACE_COUNTER(NAME, VALUE) but_trace_counter((NAME), (i64)(VALUE))
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_TRACING_H_
@@ -15,7 +15,7 @@
 #include <abbreviated_types.h> // u64
 #include <but_macros.h>        // THREAD_LOCAL
 
-#include <stdio.h> // snprintf
+#include <stdbool.h> // bool
 
 // This implementation of exception handling is inspired by and patterned after
 // Hanson D. R. (1996). C Interfaces And Implementations: Techniques For
@@ -70,6 +70,35 @@ extern BUTExceptionReason but_internal_error;
  */
 extern BUTExceptionReason but_invalid_address;
 
+/**
+ * @brief the numbers of the reasons above. Every registry numbers them the same way, in
+ * the order they're declared, before any other reason.
+ */
+typedef enum BUTReasonIds {
+    BUT_REASON_ID_NONE,               ///< no reason
+    BUT_REASON_ID_EXPECTED_FAILURE,   ///< but_expected_failure
+    BUT_REASON_ID_UNEXPECTED_FAILURE, ///< but_unexpected_failure
+    BUT_REASON_ID_TEST_EXCEPTION,     ///< but_test_exception
+    BUT_REASON_ID_NOT_IMPLEMENTED,    ///< but_not_implemented
+    BUT_REASON_ID_INVALID_VALUE,      ///< but_invalid_value
+    BUT_REASON_ID_INTERNAL_ERROR,     ///< but_internal_error
+    BUT_REASON_ID_INVALID_ADDRESS,    ///< but_invalid_address
+} BUTReasonIds;
+
+/**
+ * @brief categories of reasons, which BUT_CATCH_CATEGORY catches together. A reason can
+ * belong to several. The library's own reasons belong to the categories below, and the
+ * lower eight bits are reserved for it; use BUT_CATEGORY_USER for others.
+ */
+typedef enum BUTCategories {
+    BUT_CATEGORY_TEST     = 1 << 0, ///< a test's outcome, like but_expected_failure
+    BUT_CATEGORY_ARGUMENT = 1 << 1, ///< a bad argument, like but_invalid_value
+    BUT_CATEGORY_BUG      = 1 << 2, ///< a defect, like but_internal_error
+} BUTCategories;
+
+///< a category for an application, numbered from 0 to 23
+#define BUT_CATEGORY_USER(n) ((flag32)1 << (8 + (n)))
+
 //
 // Exported macros for exception handling
 //
@@ -84,27 +113,23 @@ extern BUTExceptionReason but_invalid_address;
 /**
  * @brief BUT_THROW_DETAILS throws reason with details.
  *
- * There is a limit of BUT_MAX_DETAILS_LENGTH bytes in the buffer used for formatting the
- * reason.
+ * The details are formatted into the next of BUT_DETAILS_RING buffers the calling thread
+ * shares with every other throw site (see but_format_details), each limited to
+ * BUT_MAX_DETAILS_LENGTH bytes.
  *
  * @param reason is the BUTExceptionReason string that briefly describes the exception.
  * @param details a string that adds details to the reason why the exception was thrown.
  * If there are arguments passed after details, then the details string is a format
  * string.
  */
-#define BUT_THROW_DETAILS(reason, details, ...)                      \
-    do {                                                             \
-        static THREAD_LOCAL char _details[BUT_MAX_DETAILS_LENGTH];   \
-        snprintf(_details, sizeof _details, details, ##__VA_ARGS__); \
-        but_throw((reason), _details, __FILE__, __LINE__);           \
-    } while (0)
+#define BUT_THROW_DETAILS(reason, details, ...) \
+    but_throw((reason), but_format_details(details, ##__VA_ARGS__), __FILE__, __LINE__)
 
 /**
  * @brief throw an exception where the details is a format string with optional format
  * specifiers.
  *
- * There is a limit of BUT_MAX_DETAILS_LENGTH bytes in the buffer used for formatting the
- * reason.
+ * The details are formatted like those of BUT_THROW_DETAILS.
  *
  * @param reason is the BUTExceptionReason string that briefly describes the exception.
  * @param details  a string that adds details to the reason why the exception was thrown.
@@ -114,11 +139,7 @@ extern BUTExceptionReason but_invalid_address;
  * @param line is the line number in the source file where the exception was thrown.
  */
 #define BUT_THROW_DETAILS_FILE_LINE(reason, details, file, line, ...) \
-    do {                                                              \
-        static THREAD_LOCAL char _details[BUT_MAX_DETAILS_LENGTH];    \
-        snprintf(_details, sizeof _details, details, ##__VA_ARGS__);  \
-        but_throw((reason), _details, file, line);                    \
-    } while (0)
+    but_throw((reason), but_format_details(details, ##__VA_ARGS__), file, line)
 
 /**
  * @brief BUT_RETHROW throws the last exception caught in an BUT_CATCH or
@@ -127,10 +148,28 @@ extern BUTExceptionReason but_invalid_address;
 #define BUT_RETHROW \
     but_throw(but_env_.reason, but_env_.details, but_env_.file, but_env_.line)
 
-#define BUT_REASON  (but_env_.reason)
-#define BUT_DETAILS (but_env_.details)
-#define BUT_FILE    (but_env_.file)
-#define BUT_LINE    (but_env_.line)
+#define BUT_REASON     (but_env_.reason)
+#define BUT_REASON_ID  (but_env_.reason_id)
+#define BUT_CATEGORIES (but_env_.categories)
+#define BUT_DETAILS    (but_env_.details)
+#define BUT_FILE       (but_env_.file)
+#define BUT_LINE       (but_env_.line)
+
+/**
+ * @brief the calling thread's exception context in this module, or NULL until the thread
+ * first needs one. Each module that links the library has its own. BUT_TRY reads it
+ * directly, so entering a try block doesn't call into the library. Read it with
+ * BUT_CURRENT_CONTEXT or but_get_exception_context, and change it only with
+ * but_set_exception_context.
+ */
+extern THREAD_LOCAL BUTExceptionContext *but_thread_context;
+
+/**
+ * @brief the calling thread's exception context, read without a call once it's set.
+ */
+#define BUT_CURRENT_CONTEXT                          \
+    (but_thread_context != NULL ? but_thread_context \
+                                : but_get_exception_context(__FILE__, __LINE__))
 
 /**
  * @brief Start a new try/catch section.
@@ -146,37 +185,99 @@ extern BUTExceptionReason but_invalid_address;
  * but_throw in exceptions.c). In this case, if any BUT_CATCH blocks are
  * executed and match the thrown exception, or if an BUT_CATCH_ALL block
  * exists, then but_ctx_->state is set to BUT_HANDLED, the handle-code is run.
+ *
+ * With BUT_EXCEPTIONS_SEH, the section is the body of a __try instead, and nothing is
+ * saved on entry. but_throw raises an exception that the section's __except filter
+ * accepts, which unwinds the frames in between and marks the section BUT_THROWN. The
+ * section then runs a second pass, and this time the catch blocks see the exception.
+ *
+ * With either backend, the section is inside a loop of its own, so a break or continue
+ * in a BUT_TRY, BUT_CATCH, or BUT_FINALLY block can't reach an enclosing loop. Instead
+ * of leaving the section silently, with it still on the exception stack, BUT_END_TRY
+ * throws but_internal_error. Use a flag and test it after BUT_END_TRY.
  */
-#define BUT_TRY                                                                           \
-    do {                                                                                  \
-        BUTExceptionEnvironment but_env_ = {0};                                           \
-        but_env_.reason                  = but_not_implemented;                           \
-        but_env_.try_file                = __FILE__;                                      \
-        but_env_.try_line                = __LINE__;                                      \
-        BUTExceptionContext *but_ctx_    = but_get_exception_context(__FILE__, __LINE__); \
-        but_env_.next                    = but_ctx_->stack;                               \
-        but_ctx_->stack                  = &but_env_;                                     \
-        but_env_.state                   = setjmp(but_env_.jmp);                          \
-        but_env_.h                       = GetModuleHandle(NULL);                         \
-        if (but_env_.state == BUT_ENTERED) {
+#if defined(BUT_EXCEPTIONS_SEH)
+#define BUT_TRY                                                    \
+    do {                                                           \
+        BUTExceptionEnvironment but_env_;                          \
+        BUTExceptionContext    *but_ctx_    = BUT_CURRENT_CONTEXT; \
+        int                     but_passes_ = 0;                   \
+        int                     but_done_   = 0;                   \
+        but_env_.reason                     = but_not_implemented; \
+        but_env_.reason_id                  = BUT_REASON_ID_NONE;  \
+        but_env_.categories                 = 0;                   \
+        but_env_.details                    = NULL;                \
+        but_env_.file                       = NULL;                \
+        but_env_.line                       = 0;                   \
+        but_env_.h                          = NULL;                \
+        but_env_.try_file                   = __FILE__;            \
+        but_env_.try_line                   = __LINE__;            \
+        but_env_.next                       = but_ctx_->stack;     \
+        but_ctx_->stack                     = &but_env_;           \
+        but_env_.state                      = BUT_ENTERED;         \
+        do {                                                       \
+            but_passes_++;                                         \
+            __try {                                                \
+                if (but_env_.state == BUT_ENTERED) {
+#else
+#define BUT_TRY                                                  \
+    do {                                                         \
+        BUTExceptionEnvironment but_env_;                        \
+        BUTExceptionContext    *but_ctx_  = BUT_CURRENT_CONTEXT; \
+        int                     but_done_ = 0;                   \
+        but_env_.reason                   = but_not_implemented; \
+        but_env_.reason_id                = BUT_REASON_ID_NONE;  \
+        but_env_.categories               = 0;                   \
+        but_env_.details                  = NULL;                \
+        but_env_.file                     = NULL;                \
+        but_env_.line                     = 0;                   \
+        but_env_.h                        = NULL;                \
+        but_env_.try_file                 = __FILE__;            \
+        but_env_.try_line                 = __LINE__;            \
+        but_env_.next                     = but_ctx_->stack;     \
+        but_ctx_->stack                   = &but_env_;           \
+        do {                                                     \
+            but_env_.state = BUT_SETJMP(but_env_.jmp);           \
+            if (but_env_.state == BUT_ENTERED) {
+#endif
 /**
  * @brief BUT_CATCH will catch an exception that matches its argument.
  *
  * If an exception was thrown, the value of but_env_.state will be BUT_THROWN, so a catch
  * block will test to see if the reason in the local frame matches the given reason. If
  * they match, the exception is handled and the code for the catch block is executed.
+ * Reasons match by their numbers, so a reason thrown by one module is caught by another
+ * module's copy of it. The same copy matches by its address, without a call. Otherwise
+ * the number of the given reason is looked up, and if either reason has no number, their
+ * text is compared instead. The argument is evaluated more than once.
  *
  * If the reason doesn't match, then execution continues on to the next catch, catch all,
  * finally block(s) until either the exception is handled or the end-try block is
  * executed (where upon the exception will be rethrown to the next exception frame up the
  * exception stack).
  */
-#define BUT_CATCH(exception)                     \
-    if (but_env_.state == BUT_ENTERED) {         \
-        but_ctx_->stack = but_ctx_->stack->next; \
-    }                                            \
-    }                                            \
-    else if (but_env_.reason == (exception)) {   \
+#define BUT_CATCH(exception)                                            \
+    if (but_env_.state == BUT_ENTERED) {                                \
+        but_ctx_->stack = but_ctx_->stack->next;                        \
+    }                                                                   \
+    }                                                                   \
+    else if (but_env_.reason == (exception)                             \
+             || but_reason_matches(but_ctx_, &but_env_, (exception))) { \
+        but_env_.state = BUT_HANDLED;
+
+/**
+ * @brief BUT_CATCH_CATEGORY catches an exception whose reason belongs to any of the
+ * given categories.
+ *
+ * The categories of the reason are looked up once, when it's thrown, so matching is a
+ * single AND however many reasons the categories hold. See but_declare_reason.
+ */
+#define BUT_CATCH_CATEGORY(mask)                    \
+    if (but_env_.state == BUT_ENTERED) {            \
+        but_ctx_->stack = but_ctx_->stack->next;    \
+    }                                               \
+    }                                               \
+    else if ((but_env_.categories & (mask)) != 0) { \
         but_env_.state = BUT_HANDLED;
 
 /**
@@ -214,16 +315,45 @@ extern BUTExceptionReason but_invalid_address;
  * If an exception was thrown and it wasn't caught, it will rethrow it, passing
  * it to the next frame in the stack.
  */
+#if defined(BUT_EXCEPTIONS_SEH)
+#define BUT_END_TRY                                                   \
+    if (but_env_.state == BUT_ENTERED) {                              \
+        but_ctx_->stack = but_ctx_->stack->next;                      \
+    }                                                                 \
+    }                                                                 \
+    }                                                                 \
+    __except (but_seh_filter(GetExceptionInformation(), &but_env_)) { \
+        but_ctx_->stack = but_env_.next;                              \
+    }                                                                 \
+    but_done_++;                                                      \
+    }                                                                 \
+    while (but_env_.state == BUT_THROWN && but_passes_ == 1);         \
+    if (but_done_ != but_passes_) {                                   \
+        but_left_section(but_ctx_, &but_env_);                        \
+    }                                                                 \
+    if (but_env_.state == BUT_THROWN) {                               \
+        BUT_RETHROW;                                                  \
+    }                                                                 \
+    }                                                                 \
+    while (0)
+#else
 #define BUT_END_TRY                              \
     if (but_env_.state == BUT_ENTERED) {         \
         but_ctx_->stack = but_ctx_->stack->next; \
     }                                            \
     }                                            \
+    but_done_ = 1;                               \
+    }                                            \
+    while (0);                                   \
+    if (!but_done_) {                            \
+        but_left_section(but_ctx_, &but_env_);   \
+    }                                            \
     if (but_env_.state == BUT_THROWN) {          \
         BUT_RETHROW;                             \
     }                                            \
     }                                            \
     while (0)
+#endif
 
 /**
  * @brief Use the BUT_RETURN macro inside BUT_TRY blocks instead of "return".
@@ -241,10 +371,27 @@ extern BUTExceptionReason but_invalid_address;
  * It prevents compilers from issuing the "unreachable code" warning that
  * BUT_END_TRY causes.
  */
+#if defined(BUT_EXCEPTIONS_SEH)
+#define BUT_END_TRY_RETURN                                            \
+    }                                                                 \
+    }                                                                 \
+    __except (but_seh_filter(GetExceptionInformation(), &but_env_)) { \
+        but_ctx_->stack = but_env_.next;                              \
+    }                                                                 \
+    but_done_++;                                                      \
+    }                                                                 \
+    while (but_env_.state == BUT_THROWN && but_passes_ == 1);         \
+    }                                                                 \
+    while (0)
+#else
 #define BUT_END_TRY_RETURN \
     }                      \
+    but_done_ = 1;         \
+    }                      \
+    while (0);             \
     }                      \
     while (0)
+#endif
 
 #define BUT_INIT_FN(name) void name(BUTExceptionContext *ctx, but_handler_fn *handler)
 typedef BUT_INIT_FN(but_init_fn);
@@ -263,9 +410,104 @@ typedef BUT_THROW_FN(but_throw_fn);
 extern BUT_THROW_FN(but_throw);
 extern BUT_HANDLER_FN(but_default_handler);
 
+/**
+ * @brief this module's reason registry. A driver puts its own in the exception contexts
+ * it installs, so the suites it runs number reasons the same way it does.
+ *
+ * @return the registry.
+ */
+BUTReasonRegistry *but_reason_registry(void);
+
+/**
+ * @brief format the details of an exception into the calling thread's next details
+ * buffer. The buffers are used in turn, so the details stay valid until BUT_DETAILS_RING
+ * more exceptions with details are thrown on the thread; a driver that keeps them longer
+ * copies them. Every throw site shares the buffers, so a thread holds BUT_DETAILS_RING
+ * of them however many sites a module has.
+ *
+ * @param format a format string, or the details themselves.
+ * @return the formatted details, truncated to BUT_MAX_DETAILS_LENGTH - 1 characters.
+ */
+char const *but_format_details(char const *format, ...);
+
+/**
+ * @brief find the number of a reason. Only throwing or declaring a reason numbers it,
+ * so looking one up never changes the registry, and it doesn't take the registry's lock.
+ *
+ * @param ctx the exception context whose registry to use; if it has none, this module's.
+ * @param reason the reason.
+ * @return the number of the reason, or BUT_REASON_ID_NONE if it hasn't been thrown or
+ * declared, or the registry had no room for it.
+ */
+BUTReasonId but_reason_id(BUTExceptionContext const *ctx, BUTExceptionReason reason);
+
+/**
+ * @brief decide whether a catch block for a reason handles a section's exception. The
+ * numbers of the reasons are compared, unless either has none, and then their text is.
+ *
+ * @param ctx the exception context whose registry to use; if it has none, this module's.
+ * @param env the environment of the section that caught the exception.
+ * @param reason the reason of the catch block.
+ * @return true if the exception's reason is the same as the catch block's.
+ */
+bool but_reason_matches(BUTExceptionContext const *ctx,
+                        BUTExceptionEnvironment const *env, BUTExceptionReason reason);
+
+/**
+ * @brief add a reason to categories. A reason's categories accumulate, and they apply
+ * in every module that shares the registry. An exception takes the categories its reason
+ * has when it's thrown, so declare a reason before throwing it.
+ *
+ * @param ctx the exception context whose registry to use; if it has none, this module's.
+ * @param reason the reason.
+ * @param categories a combination of BUTCategories and BUT_CATEGORY_USER values.
+ * @return the number of the reason, or BUT_REASON_ID_NONE if the registry has no room
+ * for it.
+ */
+BUTReasonId but_declare_reason(BUTExceptionContext const *ctx, BUTExceptionReason reason,
+                               flag32 categories);
+
+/**
+ * @brief pop a section that a break or continue left, and throw but_internal_error.
+ * BUT_END_TRY calls it when a section ends without reaching its last block.
+ *
+ * @param ctx the exception context.
+ * @param env the section's environment.
+ */
+void but_left_section(BUTExceptionContext *ctx, BUTExceptionEnvironment *env);
+
+#if defined(BUT_EXCEPTIONS_SEH)
+/**
+ * @brief the __except filter of a BUT_TRY section. It accepts only an exception that
+ * but_throw raised for this section, and copies the reason, details, file, line, and
+ * module into the section's environment.
+ *
+ * @param info the exception, from GetExceptionInformation.
+ * @param env the section's environment.
+ * @return EXCEPTION_EXECUTE_HANDLER if the exception is for env, and
+ * EXCEPTION_CONTINUE_SEARCH otherwise.
+ */
+int but_seh_filter(EXCEPTION_POINTERS const *info, BUTExceptionEnvironment *env);
+#endif
+
 extern DLL_SPEC_EXPORT BUT_GET_EXCEPTION_CONTEXT(but_get_exception_context);
 extern DLL_SPEC_EXPORT BUT_SET_EXCEPTION_CONTEXT(but_set_exception_context);
 
+/**
+ * @brief flush the standard output and error streams of the calling module's C runtime.
+ * Each test suite links its own copy of the runtime, so a driver that captures a suite's
+ * output finds the suite's copy of this function with GetProcAddress.
+ */
+extern DLL_SPEC_EXPORT BUT_FLUSH_OUTPUT(but_flush_output);
+
+/**
+ * @brief retrieve the calling thread's exception context without initializing it or
+ * logging, for code that runs often and only needs what a driver installed.
+ *
+ * @return the context, or NULL if the thread hasn't used one yet.
+ */
+BUTExceptionContext *but_peek_exception_context(void);
+
 #if defined(__cplusplus)
 }
 #endif
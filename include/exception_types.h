@@ -10,13 +10,13 @@
  *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
-#include <abbreviated_types.h> // u32
-#include <setjmp.h>            // jmp_buf
+#include <abbreviated_types.h> // u32, flag32
+#include <setjmp.h>            // jmp_buf, setjmp, longjmp
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
-#include <Windows.h> // GetModuleHandle()
+#include <Windows.h> // HMODULE
 
 #if defined(__cplusplus)
 extern "C" {
@@ -27,6 +27,44 @@ extern "C" {
 #define BUT_MAX_DETAILS_LENGTH 512
 #endif
 
+#ifndef BUT_DETAILS_RING
+///< the number of details buffers each thread uses in turn
+#define BUT_DETAILS_RING 4
+#endif
+
+#ifndef BUT_MAX_REASONS
+///< the number of distinct reasons a BUTReasonRegistry can number
+#define BUT_MAX_REASONS 1024
+#endif
+
+#ifndef BUT_REASON_TEXT_SIZE
+///< the bytes a BUTReasonRegistry has for copies of the text of its reasons
+#define BUT_REASON_TEXT_SIZE (32 * BUT_MAX_REASONS)
+#endif
+
+/*
+ * Define BUT_EXCEPTIONS_SEH to build BUT_TRY and but_throw on structured exception
+ * handling instead of setjmp/longjmp. The unwinder works from tables the compiler emits,
+ * so entering a try block saves no registers, and a throw runs the __finally blocks of
+ * the frames it unwinds. Every module that shares exceptions must use the same backend.
+ */
+#if defined(BUT_EXCEPTIONS_SEH)
+#define BUT_SEH_CODE      0xE0425554u ///< the exception code but_throw raises; "BUT"
+#define BUT_SEH_ARGUMENTS 8           ///< the number of arguments it raises with
+#endif
+
+/*
+ * The cheapest way to save and restore the registers for a BUT_TRY. Microsoft's setjmp
+ * doesn't save the signal mask. Where the C library's setjmp might, _setjmp doesn't.
+ */
+#if defined(_WIN32)
+#define BUT_SETJMP(env)         setjmp(env)
+#define BUT_LONGJMP(env, value) longjmp((env), (value))
+#else
+#define BUT_SETJMP(env)         _setjmp(env)
+#define BUT_LONGJMP(env, value) _longjmp((env), (value))
+#endif
+
 // The four states within an BUT_TRY block used to track whether a try-block
 // was enter, an exception was thrown and not handled, caught and handled, and
 // whether a final block was entered.
@@ -43,21 +81,38 @@ typedef enum BUTExceptionState {
  */
 typedef char const *BUTExceptionReason;
 
+/**
+ * @brief the number a BUTReasonRegistry gives a reason. Reasons with the same text have
+ * the same number, whichever module defines them, so comparing numbers works across
+ * modules where comparing addresses doesn't. Zero is no reason.
+ */
+typedef u32 BUTReasonId;
+
+/**
+ * @brief gives each distinct reason a BUTReasonId. A driver shares its registry with the
+ * suites it runs through the exception contexts it installs in them.
+ */
+typedef struct BUTReasonRegistry BUTReasonRegistry;
+
 typedef struct BUTExceptionEnvironment {
+#if !defined(BUT_EXCEPTIONS_SEH)
     jmp_buf jmp; ///< the jump buffer for setjmp/longjmp. Note that the offset of jmp_buf
                  ///< must be 16-byte aligned on some systems.
+#endif
     struct BUTExceptionEnvironment
         *next; ///< a pointer to a parent context from an enclosing BUT_TRY block.
     BUTExceptionReason
-                reason;   ///< a constant string describing the reason for the exception.
-    char const *details;  ///< extra details about the exception
-    char const *try_file; ///< the file where the last setjmp was set.
-    char const *file;     ///< the file where the exception was thrown.
-    u32         try_line; ///< the line where the last setjmp was set.
-    u32         line;     ///< the line where the exception was thrown.
+                reason;     ///< a constant string describing why it was thrown.
+    BUTReasonId reason_id;  ///< the number of the reason, once an exception is thrown
+    flag32      categories; ///< the categories of the reason, once it's thrown
+    char const *details;    ///< extra details about the exception
+    char const *try_file;   ///< the file where the last setjmp was set.
+    char const *file;       ///< the file where the exception was thrown.
+    u32         try_line;   ///< the line where the last setjmp was set.
+    u32         line;       ///< the line where the exception was thrown.
     BUTExceptionState volatile state; ///< a try block is entered, thrown, handled, or
                                       ///< finalized.
-    HMODULE h;                        ///< a handle to the current module
+    HMODULE h;                        ///< the module that threw the exception
 } BUTExceptionEnvironment;
 
 /*
@@ -68,6 +123,7 @@ typedef struct BUTExceptionEnvironment {
  */
 
 typedef struct BUTExceptionContext BUTExceptionContext;
+struct BUTTracer;
 
 /**
  * @brief a pointer to an exception handling function.
@@ -95,8 +151,11 @@ typedef but_handler_fn *but_handler;
  * BUTExceptionEnvironment. That triggers but_throw() to call the handler function.
  */
 struct BUTExceptionContext {
-    but_handler_fn          *handler; ///< exception handler
-    BUTExceptionEnvironment *stack;   ///< top of a stack of exception environments
+    but_handler_fn          *handler;  ///< exception handler
+    BUTExceptionEnvironment *stack;    ///< top of a stack of exception environments
+    but_handler_fn          *on_throw; ///< observes every exception thrown, or NULL
+    struct BUTTracer const  *tracer;   ///< records trace spans and counters, or NULL
+    BUTReasonRegistry       *reasons;  ///< numbers reasons, or NULL for the module's own
 };
 
 #define BUT_GET_EXCEPTION_CONTEXT(name) \
@@ -107,6 +166,9 @@ typedef BUT_GET_EXCEPTION_CONTEXT(but_get_exception_context_fn);
     BUTExceptionContext *name(BUTExceptionContext *ctx, char const *file, int line)
 typedef BUT_SET_EXCEPTION_CONTEXT(but_set_exception_context_fn);
 
+#define BUT_FLUSH_OUTPUT(name) void name(void)
+typedef BUT_FLUSH_OUTPUT(but_flush_output_fn);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,446 @@
+/**
+ * @file but_alloc.c
+ * @author Douglas Cuthbertson
+ * @brief Per-test heap accounting and leak detection.
+ * @version 0.1
+ * @date 2025-09-18
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_alloc.h"
+#include "log.h" // logger_get_filename
+
+#include <abbreviated_types.h> // u16, u32, u64
+#include <but_macros.h>        // BUT_ARRAY_COUNT, BUT_GLOBAL
+
+#include <inttypes.h> // PRIu64
+#include <stdbool.h>  // bool, true, false
+#include <stdint.h>   // uintptr_t
+#include <stdio.h>    // fprintf
+#include <stdlib.h>   // calloc, free
+#include <string.h>   // memcpy, memset
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HeapAlloc, VirtualProtect, CaptureStackBackTrace, etc.
+#include <DbgHelp.h> // SymInitialize, SymFromAddr, SymGetLineFromAddr64
+
+/**
+ * @brief A live allocation made by a module that's being tracked.
+ */
+typedef struct AllocEntry {
+    void *address;                  ///< the allocation's address; NULL for an empty slot
+    u64   size;                     ///< the number of bytes requested
+    u64   generation;               ///< the case that made the allocation
+    void *frames[BUT_ALLOC_FRAMES]; ///< the return addresses of the allocation's callers
+    u16   frame_count;              ///< the number of valid frames
+} AllocEntry;
+
+/**
+ * @brief An import that the tracker replaces with one of its own functions.
+ */
+typedef struct AllocHook {
+    char const *name; ///< the name of the function exported by kernel32
+    ULONG_PTR   real; ///< the address the loader binds the import to
+    ULONG_PTR   hook; ///< the tracker's replacement
+} AllocHook;
+
+/**
+ * @brief The allocations made by the current test case are kept in an open-addressed
+ * hash table keyed by address. The table is allocated with the driver's heap functions,
+ * which aren't tracked, so recording an allocation never recurses.
+ */
+typedef struct AllocTracker {
+    SRWLOCK       lock;            ///< serializes access by the suite's threads
+    AllocEntry   *entries;         ///< the hash table
+    size_t        capacity;        ///< the number of slots; always a power of two
+    size_t        count;           ///< the number of occupied slots
+    u64           generation;      ///< the current case, or zero between cases
+    u64           next_generation; ///< the number of cases begun
+    u64           last_generation; ///< the most recently ended case
+    u64           live_bytes;      ///< bytes allocated by the current case still live
+    u32           live_count;      ///< allocations made by the current case still live
+    BUTAllocStats stats;           ///< statistics for the current case
+} AllocTracker;
+
+BUT_GLOBAL AllocTracker g_tracker_ = {.lock = SRWLOCK_INIT};
+BUT_GLOBAL AllocHook    g_hooks_[3];
+BUT_GLOBAL bool         g_hooks_resolved_;
+BUT_GLOBAL bool         g_symbols_initialized_;
+
+static size_t hash_address(void const *address, size_t capacity) {
+    // Heap blocks are at least 8-byte aligned, so discard the low bits first.
+    u64 key = (u64)(uintptr_t)address >> 3;
+
+    return (size_t)(key * 0x9E3779B97F4A7C15ull) & (capacity - 1);
+}
+
+// Double the capacity of the table. Call with the lock held.
+static bool grow_table(void) {
+    size_t      capacity = g_tracker_.capacity ? g_tracker_.capacity * 2 : 1024;
+    AllocEntry *entries  = calloc(capacity, sizeof *entries);
+
+    if (entries == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < g_tracker_.capacity; i++) {
+        AllocEntry *entry = &g_tracker_.entries[i];
+
+        if (entry->address != NULL) {
+            size_t j = hash_address(entry->address, capacity);
+
+            while (entries[j].address != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            entries[j] = *entry;
+        }
+    }
+
+    free(g_tracker_.entries);
+    g_tracker_.entries  = entries;
+    g_tracker_.capacity = capacity;
+    return true;
+}
+
+// Claim an empty slot for an address, growing the table if it's half full. Call with the
+// lock held.
+static AllocEntry *claim_entry(void *address) {
+    AllocEntry *entry = NULL;
+
+    if ((g_tracker_.count + 1) * 2 <= g_tracker_.capacity || grow_table()) {
+        size_t i = hash_address(address, g_tracker_.capacity);
+
+        while (g_tracker_.entries[i].address != NULL) {
+            i = (i + 1) & (g_tracker_.capacity - 1);
+        }
+
+        entry          = &g_tracker_.entries[i];
+        entry->address = address;
+        g_tracker_.count++;
+    }
+
+    return entry;
+}
+
+// Record an allocation made by the current case. Call with the lock held.
+static void insert_entry(void *address, u64 size, void **frames, u16 frame_count) {
+    AllocEntry *entry = claim_entry(address);
+
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->size        = size;
+    entry->generation  = g_tracker_.generation;
+    entry->frame_count = frame_count;
+    memcpy(entry->frames, frames, frame_count * sizeof frames[0]);
+
+    g_tracker_.stats.allocations++;
+    g_tracker_.stats.bytes += size;
+    g_tracker_.live_bytes  += size;
+    g_tracker_.live_count++;
+    if (g_tracker_.live_bytes > g_tracker_.stats.peak_bytes) {
+        g_tracker_.stats.peak_bytes = g_tracker_.live_bytes;
+    }
+}
+
+// Forget an allocation that's being freed. Call with the lock held.
+//
+// Returns false if the allocation wasn't tracked. Otherwise a copy of its entry is
+// stored in removed, if that isn't NULL.
+static bool remove_entry(void *address, AllocEntry *removed) {
+    size_t mask = g_tracker_.capacity - 1;
+    size_t i;
+
+    if (address == NULL || g_tracker_.count == 0) {
+        return false;
+    }
+
+    i = hash_address(address, g_tracker_.capacity);
+    while (g_tracker_.entries[i].address != address) {
+        if (g_tracker_.entries[i].address == NULL) {
+            return false; // allocated before tracking started or between cases
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (removed != NULL) {
+        *removed = g_tracker_.entries[i];
+    }
+
+    if (g_tracker_.entries[i].generation == g_tracker_.generation
+        && g_tracker_.generation != 0) {
+        g_tracker_.live_bytes -= g_tracker_.entries[i].size;
+        g_tracker_.live_count--;
+    }
+
+    // Shift later entries in the probe sequence back so lookups never need tombstones.
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (g_tracker_.entries[j].address == NULL) {
+            break;
+        }
+
+        size_t k = hash_address(g_tracker_.entries[j].address, g_tracker_.capacity);
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            g_tracker_.entries[i] = g_tracker_.entries[j];
+            i                     = j;
+        }
+    }
+
+    g_tracker_.entries[i].address = NULL;
+    g_tracker_.count--;
+    return true;
+}
+
+static void record_alloc(void *address, SIZE_T size) {
+    void *frames[BUT_ALLOC_FRAMES];
+    u16   frame_count;
+
+    // Skip this function and the hook that called it.
+    frame_count = CaptureStackBackTrace(2, BUT_ALLOC_FRAMES, frames, NULL);
+
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    if (g_tracker_.generation != 0) {
+        insert_entry(address, size, frames, frame_count);
+    }
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
+
+static void record_free(void *address) {
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    remove_entry(address, NULL);
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
+
+static LPVOID WINAPI tracked_heap_alloc(HANDLE heap, DWORD flags, SIZE_T bytes) {
+    LPVOID address = HeapAlloc(heap, flags, bytes);
+
+    if (address != NULL && g_tracker_.generation != 0) {
+        record_alloc(address, bytes);
+    }
+
+    return address;
+}
+
+static LPVOID WINAPI tracked_heap_realloc(HANDLE heap, DWORD flags, LPVOID memory,
+                                          SIZE_T bytes) {
+    void      *frames[BUT_ALLOC_FRAMES];
+    u16        frame_count = 0;
+    AllocEntry previous;
+    LPVOID     address;
+
+    if (g_tracker_.generation != 0) {
+        // Skip this function.
+        frame_count = CaptureStackBackTrace(1, BUT_ALLOC_FRAMES, frames, NULL);
+    }
+
+    // Hold the lock across the reallocation, as HeapFree's hook forgets a block before
+    // it's freed: once HeapReAlloc moves the block another thread may be given the old
+    // address, and its allocation must not be recorded until the old entry is gone.
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    address = HeapReAlloc(heap, flags, memory, bytes);
+    if (address != NULL && remove_entry(memory, &previous)) {
+        if (previous.generation != 0 && previous.generation == g_tracker_.generation) {
+            insert_entry(address, bytes, frames, frame_count);
+        } else {
+            // A block from an earlier case still belongs to that case, so resizing it
+            // isn't an allocation of this one.
+            AllocEntry *entry = claim_entry(address);
+
+            if (entry != NULL) {
+                previous.address = address;
+                previous.size    = bytes;
+                *entry           = previous;
+            }
+        }
+    }
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+
+    return address;
+}
+
+static BOOL WINAPI tracked_heap_free(HANDLE heap, DWORD flags, LPVOID memory) {
+    // Forget the block first; once it's freed another thread may be given its address.
+    record_free(memory);
+    return HeapFree(heap, flags, memory);
+}
+
+static void resolve_hooks(void) {
+    if (!g_hooks_resolved_) {
+        HMODULE kernel32 = GetModuleHandleA("kernel32.dll");
+
+        g_hooks_[0].name = "HeapAlloc";
+        g_hooks_[0].hook = (ULONG_PTR)tracked_heap_alloc;
+        g_hooks_[1].name = "HeapReAlloc";
+        g_hooks_[1].hook = (ULONG_PTR)tracked_heap_realloc;
+        g_hooks_[2].name = "HeapFree";
+        g_hooks_[2].hook = (ULONG_PTR)tracked_heap_free;
+
+        // The exports are forwarded to ntdll, so compare import slots with the addresses
+        // the loader resolves them to rather than by name. That also catches imports
+        // through API sets such as api-ms-win-core-heap-l1-1-0.dll.
+        for (size_t i = 0; i < BUT_ARRAY_COUNT(g_hooks_); i++) {
+            g_hooks_[i].real = (ULONG_PTR)GetProcAddress(kernel32, g_hooks_[i].name);
+        }
+        g_hooks_resolved_ = true;
+    }
+}
+
+/**
+ * @brief replace or restore the heap functions in a module's import address table.
+ *
+ * @param module the module to patch.
+ * @param install true to install the hooks and false to restore the original imports.
+ * @return the number of import slots that were changed.
+ */
+static u32 patch_imports(HMODULE module, bool install) {
+    BYTE                     *base = (BYTE *)module;
+    IMAGE_DOS_HEADER         *dos  = (IMAGE_DOS_HEADER *)base;
+    IMAGE_NT_HEADERS         *nt   = (IMAGE_NT_HEADERS *)(base + dos->e_lfanew);
+    IMAGE_DATA_DIRECTORY     *directory;
+    IMAGE_IMPORT_DESCRIPTOR  *descriptor;
+    u32                       patched = 0;
+
+    directory = &nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+    if (directory->Size == 0) {
+        return 0;
+    }
+
+    descriptor = (IMAGE_IMPORT_DESCRIPTOR *)(base + directory->VirtualAddress);
+    for (; descriptor->Name != 0; descriptor++) {
+        IMAGE_THUNK_DATA *thunk = (IMAGE_THUNK_DATA *)(base + descriptor->FirstThunk);
+
+        for (; thunk->u1.Function != 0; thunk++) {
+            ULONG_PTR *slot = (ULONG_PTR *)&thunk->u1.Function;
+
+            for (size_t i = 0; i < BUT_ARRAY_COUNT(g_hooks_); i++) {
+                ULONG_PTR from = install ? g_hooks_[i].real : g_hooks_[i].hook;
+                ULONG_PTR to   = install ? g_hooks_[i].hook : g_hooks_[i].real;
+                DWORD     protection;
+
+                if (from != 0 && *slot == from
+                    && VirtualProtect(slot, sizeof *slot, PAGE_READWRITE, &protection)) {
+                    *slot = to;
+                    VirtualProtect(slot, sizeof *slot, protection, &protection);
+                    patched++;
+                    break;
+                }
+            }
+        }
+    }
+
+    return patched;
+}
+
+bool but_alloc_attach(HMODULE module) {
+    resolve_hooks();
+    return patch_imports(module, true) > 0;
+}
+
+void but_alloc_detach(HMODULE module) {
+    patch_imports(module, false);
+
+    // Whatever the module still holds can't be attributed to a case anymore.
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    free(g_tracker_.entries);
+    g_tracker_.entries  = NULL;
+    g_tracker_.capacity = 0;
+    g_tracker_.count    = 0;
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
+
+void but_alloc_begin_case(void) {
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    memset(&g_tracker_.stats, 0, sizeof g_tracker_.stats);
+    g_tracker_.live_bytes = 0;
+    g_tracker_.live_count = 0;
+    g_tracker_.generation = ++g_tracker_.next_generation;
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
+
+void but_alloc_end_case(BUTAllocStats *stats) {
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    g_tracker_.stats.leaks        = g_tracker_.live_count;
+    g_tracker_.stats.leaked_bytes = g_tracker_.live_bytes;
+    g_tracker_.last_generation    = g_tracker_.generation;
+    g_tracker_.generation         = 0;
+    *stats                        = g_tracker_.stats;
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
+
+// Write "module!symbol+offset (file:line)" for a return address. Symbols are only
+// looked up here, when a leak is reported, so tracking allocations stays cheap.
+static void describe_address(FILE *out, void *address) {
+    HANDLE  process = GetCurrentProcess();
+    HMODULE module  = NULL;
+    char    path[MAX_PATH] = "?";
+    struct {
+        SYMBOL_INFO info;
+        char        name[256];
+    } symbol;
+    DWORD64         displacement;
+    DWORD           line_displacement;
+    IMAGEHLP_LINE64 line;
+
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                               | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCSTR)address, &module)) {
+        GetModuleFileNameA(module, path, sizeof path);
+    }
+    fprintf(out, "%s!", logger_get_filename(path));
+
+    memset(&symbol, 0, sizeof symbol);
+    symbol.info.SizeOfStruct = sizeof symbol.info;
+    symbol.info.MaxNameLen   = sizeof symbol.name;
+    if (SymFromAddr(process, (DWORD64)(uintptr_t)address, &displacement, &symbol.info)) {
+        fprintf(out, "%s+0x%llx", symbol.info.Name, (unsigned long long)displacement);
+    } else {
+        fprintf(out, "0x%llx",
+                (unsigned long long)((BYTE *)address - (BYTE *)module));
+    }
+
+    memset(&line, 0, sizeof line);
+    line.SizeOfStruct = sizeof line;
+    if (SymGetLineFromAddr64(process, (DWORD64)(uintptr_t)address, &line_displacement,
+                             &line)) {
+        fprintf(out, " (%s:%lu)", line.FileName, (unsigned long)line.LineNumber);
+    }
+}
+
+void but_alloc_report_leaks(FILE *out, char const *indent) {
+    HANDLE process = GetCurrentProcess();
+
+    if (!g_symbols_initialized_) {
+        SymSetOptions(SymGetOptions() | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+        // This fails if a test suite already initialized symbols, which is fine.
+        SymInitialize(process, NULL, TRUE);
+        g_symbols_initialized_ = true;
+    }
+
+    // Pick up test suites loaded since the symbols were initialized.
+    SymRefreshModuleList(process);
+
+    AcquireSRWLockExclusive(&g_tracker_.lock);
+    for (size_t i = 0; i < g_tracker_.capacity; i++) {
+        AllocEntry *entry = &g_tracker_.entries[i];
+
+        if (entry->address != NULL && entry->generation != 0
+            && entry->generation == g_tracker_.last_generation) {
+            fprintf(out, "%sleaked %" PRIu64 " bytes at 0x%p\n", indent, entry->size,
+                    entry->address);
+            for (u16 f = 0; f < entry->frame_count; f++) {
+                fprintf(out, "%s    at ", indent);
+                describe_address(out, entry->frames[f]);
+                fprintf(out, "\n");
+            }
+
+            // Report each leak once.
+            entry->generation = 0;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_tracker_.lock);
+}
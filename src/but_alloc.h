@@ -0,0 +1,98 @@
+#ifndef BUT_ALLOC_H_
+#define BUT_ALLOC_H_
+
+/**
+ * @file but_alloc.h
+ * @author Douglas Cuthbertson
+ * @brief Per-test heap accounting and leak detection.
+ * @version 0.1
+ * @date 2025-09-18
+ *
+ * Test suites statically link the C runtime, so each one has its own malloc, calloc,
+ * realloc, and free. All of them are built on HeapAlloc, HeapReAlloc, and HeapFree,
+ * which the suite imports from the system. The tracker interposes on those imports by
+ * patching the suite's import address table when the driver loads it, so it sees every
+ * heap allocation the suite makes, in release and debug builds alike. Modules that
+ * aren't attached aren't affected, so when tracking is disabled there's no overhead at
+ * all.
+ *
+ * Resizing a block that was allocated before a case began isn't counted as an allocation
+ * of that case.
+ *
+ * In debug builds the C runtime adds a small header and guard bytes to each block, so
+ * the byte counts include them.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u32, u64
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HMODULE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/// the number of return addresses captured for each allocation
+#define BUT_ALLOC_FRAMES 6
+
+/**
+ * @brief Allocation statistics for one test case, from the start of its setup through
+ * the end of its cleanup.
+ */
+typedef struct BUTAllocStats {
+    u64 allocations;  ///< the number of allocations and reallocations
+    u64 bytes;        ///< the total number of bytes requested
+    u64 peak_bytes;   ///< the largest number of bytes allocated by the case at once
+    u64 leaked_bytes; ///< bytes allocated by the case that were still live at its end
+    u32 leaks;        ///< allocations made by the case that were still live at its end
+} BUTAllocStats;
+
+/**
+ * @brief start tracking the heap allocations of a module.
+ *
+ * @param module a test suite loaded by LoadLibrary.
+ * @return true if at least one heap function was interposed, and false otherwise.
+ */
+bool but_alloc_attach(HMODULE module);
+
+/**
+ * @brief stop tracking the heap allocations of a module and restore its imports. Call
+ * this before FreeLibrary.
+ *
+ * @param module a module passed to but_alloc_attach.
+ */
+void but_alloc_detach(HMODULE module);
+
+/**
+ * @brief attribute all subsequent allocations to a new test case.
+ */
+void but_alloc_begin_case(void);
+
+/**
+ * @brief stop attributing allocations to the current test case and collect its
+ * statistics.
+ *
+ * @param stats receives the statistics for the case.
+ */
+void but_alloc_end_case(BUTAllocStats *stats);
+
+/**
+ * @brief write the call sites of the allocations leaked by the most recent case. Each
+ * leak is reported once.
+ *
+ * @param out the stream to which the leaks are written.
+ * @param indent a string written at the start of each line.
+ */
+void but_alloc_report_leaks(FILE *out, char const *indent);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_ALLOC_H_
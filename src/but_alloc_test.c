@@ -0,0 +1,237 @@
+/**
+ * @file but_alloc_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the per-test allocation tracker and of allocation budgets.
+ * @version 0.1
+ * @date 2025-10-01
+ *
+ * The tests call the tracker's heap hooks directly, as a suite's patched imports would,
+ * so they don't depend on the driver tracking this suite. The hooks are static, so this
+ * file is included after but_alloc.c. The budget tests read the budget state in
+ * but_assert.c, so it's included after that, too.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_alloc.h" // but_alloc_begin_case, but_alloc_end_case, BUTAllocStats
+
+#include <abbreviated_types.h> // u64
+#include <but.h>               // BUT_TEST
+#include <but_assert.h>        // BUT_ASSERT_EQ_SIZE_T, BUT_ASSERT_MAX_ALLOCS, etc.
+#include <but_macros.h>        // BUT_ARRAY_COUNT
+#include <exception.h>         // BUT_TRY, BUT_CATCH, BUT_THROW, etc.
+
+#include <stdbool.h> // bool, true, false
+#include <stddef.h>  // size_t
+#include <stdlib.h>  // malloc, free
+#include <string.h>  // strstr
+#include <threads.h> // thrd_t, thrd_create, thrd_join
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetProcessHeap
+
+// Verify the counts, bytes, peak, and leaks of a case that allocates, frees, and grows
+// blocks.
+BUT_TEST("Allocation Counts", alloc_counts) {
+    HANDLE        heap = GetProcessHeap();
+    BUTAllocStats stats;
+    void         *a;
+    void         *b;
+
+    but_alloc_begin_case();
+    a = tracked_heap_alloc(heap, 0, 100);
+    b = tracked_heap_alloc(heap, 0, 200);
+    tracked_heap_free(heap, 0, a);
+    b = tracked_heap_realloc(heap, 0, b, 400);
+    but_alloc_end_case(&stats);
+    BUT_ASSERT_NOT_NULL(b);
+    tracked_heap_free(heap, 0, b);
+
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.allocations, (size_t)3);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.bytes, (size_t)700);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.peak_bytes, (size_t)400);
+    BUT_ASSERT_EQ_UINT32(stats.leaks, 1);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.leaked_bytes, (size_t)400);
+}
+
+// Verify a case that frees everything it allocates has no leaks, and its peak is the
+// most it held at once.
+BUT_TEST("No Leaks", alloc_no_leaks) {
+    HANDLE        heap = GetProcessHeap();
+    BUTAllocStats stats;
+    void         *blocks[4];
+
+    but_alloc_begin_case();
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(blocks); i++) {
+        blocks[i] = tracked_heap_alloc(heap, 0, 32);
+    }
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(blocks); i++) {
+        tracked_heap_free(heap, 0, blocks[i]);
+    }
+    but_alloc_end_case(&stats);
+
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.allocations, (size_t)4);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.peak_bytes, (size_t)128);
+    BUT_ASSERT_EQ_UINT32(stats.leaks, 0);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.leaked_bytes, (size_t)0);
+}
+
+// Verify resizing a block allocated before a case, or by an earlier case, isn't charged
+// to the case that resizes it.
+BUT_TEST("Reallocate Earlier Blocks", alloc_realloc_earlier) {
+    HANDLE        heap = GetProcessHeap();
+    BUTAllocStats first;
+    BUTAllocStats second;
+    void         *before;
+    void         *earlier;
+
+    before = tracked_heap_alloc(heap, 0, 64);
+    but_alloc_begin_case();
+    earlier = tracked_heap_alloc(heap, 0, 64);
+    but_alloc_end_case(&first);
+
+    but_alloc_begin_case();
+    before  = tracked_heap_realloc(heap, 0, before, 4096);
+    earlier = tracked_heap_realloc(heap, 0, earlier, 4096);
+    but_alloc_end_case(&second);
+    BUT_ASSERT_NOT_NULL(before);
+    BUT_ASSERT_NOT_NULL(earlier);
+    tracked_heap_free(heap, 0, before);
+    tracked_heap_free(heap, 0, earlier);
+
+    BUT_ASSERT_EQ_UINT32(first.leaks, 1);
+    BUT_ASSERT_EQ_SIZE_T((size_t)second.allocations, (size_t)0);
+    BUT_ASSERT_EQ_SIZE_T((size_t)second.bytes, (size_t)0);
+    BUT_ASSERT_EQ_UINT32(second.leaks, 0);
+}
+
+#define ALLOC_THREADS     4   ///< the number of threads that allocate at once
+#define ALLOCS_PER_THREAD 256 ///< the blocks each thread allocates, grows, and frees
+
+// Allocate, grow, and free blocks, and keep one last block.
+static int allocate_on_thread(void *arg) {
+    HANDLE heap  = GetProcessHeap();
+    void **kept  = arg;
+    void  *block = NULL;
+
+    for (int i = 0; i < ALLOCS_PER_THREAD; i++) {
+        block = tracked_heap_alloc(heap, 0, 16);
+        block = tracked_heap_realloc(heap, 0, block, 32);
+        tracked_heap_free(heap, 0, block);
+    }
+    *kept = tracked_heap_alloc(heap, 0, 8);
+    return 0;
+}
+
+// Verify the tracker counts every allocation made by several threads at once, and
+// finds the blocks they didn't free.
+BUT_TEST("Allocate on Several Threads", alloc_threads) {
+    HANDLE        heap = GetProcessHeap();
+    BUTAllocStats stats;
+    thrd_t        workers[ALLOC_THREADS];
+    bool          created[ALLOC_THREADS];
+    void         *kept[ALLOC_THREADS] = {0};
+
+    but_alloc_begin_case();
+    for (size_t i = 0; i < ALLOC_THREADS; i++) {
+        created[i]
+            = thrd_create(&workers[i], allocate_on_thread, &kept[i]) == thrd_success;
+    }
+    for (size_t i = 0; i < ALLOC_THREADS; i++) {
+        if (created[i]) {
+            thrd_join(workers[i], NULL);
+        }
+    }
+    but_alloc_end_case(&stats);
+    for (size_t i = 0; i < ALLOC_THREADS; i++) {
+        tracked_heap_free(heap, 0, kept[i]);
+    }
+
+    for (size_t i = 0; i < ALLOC_THREADS; i++) {
+        BUT_ASSERT_TRUE(created[i]);
+        BUT_ASSERT_NOT_NULL(kept[i]);
+    }
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.allocations,
+                         (size_t)ALLOC_THREADS * (2 * ALLOCS_PER_THREAD + 1));
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.bytes,
+                         (size_t)ALLOC_THREADS * (ALLOCS_PER_THREAD * (16 + 32) + 8));
+    BUT_ASSERT_EQ_UINT32(stats.leaks, ALLOC_THREADS);
+    BUT_ASSERT_EQ_SIZE_T((size_t)stats.leaked_bytes, (size_t)ALLOC_THREADS * 8);
+}
+
+// Keep the compiler from eliding an allocation that's freed right away.
+static void *volatile g_budget_sink_;
+
+static void allocate_and_free(void) {
+    g_budget_sink_ = malloc(16);
+    free(g_budget_sink_);
+}
+
+static void throw_test_exception(void) {
+    BUT_THROW(but_test_exception);
+}
+
+// Verify budgets that aren't exceeded pass and leave no budget watching the thread.
+BUT_TEST("Under Budget", budget_under) {
+    u64 watch = g_watch_;
+
+    BUT_ASSERT_NO_ALLOC_BEGIN;
+    g_budget_sink_ = NULL;
+    BUT_ASSERT_NO_ALLOC_END;
+
+    BUT_ASSERT_MAX_ALLOCS(2, allocate_and_free(); allocate_and_free());
+    BUT_ASSERT_TRUE(g_watch_ == watch);
+}
+
+// Verify a budget that's exceeded throws with the number of allocations it made.
+BUT_TEST("Over Budget", budget_over) {
+    u64  watch  = g_watch_;
+    bool thrown = false;
+    bool actual = false;
+
+    BUT_TRY {
+        BUT_ASSERT_MAX_ALLOCS(1, allocate_and_free(); allocate_and_free());
+    }
+    BUT_CATCH(but_unexpected_failure) {
+        thrown = true;
+        actual = BUT_DETAILS != NULL && strstr(BUT_DETAILS, "Actual: 2.") != NULL;
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT_TRUE(thrown);
+    BUT_ASSERT_TRUE(actual);
+    BUT_ASSERT_TRUE(g_watch_ == watch);
+}
+
+// Verify an exception thrown inside a budget propagates unchanged and cancels the
+// budget, so it doesn't watch the thread's later allocations.
+BUT_TEST("Throw Inside a Budget", budget_throw_inside) {
+    u64  watch  = g_watch_;
+    bool caught = false;
+
+    BUT_TRY {
+        BUT_ASSERT_NO_ALLOC_BEGIN;
+        throw_test_exception();
+        BUT_ASSERT_NO_ALLOC_END;
+    }
+    BUT_CATCH(but_test_exception) {
+        caught = true;
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT_TRUE(caught);
+    BUT_ASSERT_TRUE(g_watch_ == watch);
+
+    // An enclosing budget still counts only its own allocations.
+    BUT_ASSERT_MAX_ALLOCS(1, {
+        BUT_TRY {
+            BUT_ASSERT_MAX_ALLOCS(0, throw_test_exception());
+        }
+        BUT_CATCH(but_test_exception) {
+            allocate_and_free();
+        }
+        BUT_END_TRY;
+    });
+    BUT_ASSERT_TRUE(g_watch_ == watch);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file but_arena.c
+ * @author Douglas Cuthbertson
+ * @brief A region of memory whose allocations are all released together.
+ * @version 0.1
+ * @date 2025-09-29
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_arena.h"
+
+#include <stddef.h> // size_t, NULL
+#include <stdlib.h> // malloc, free
+#include <string.h> // strlen, memcpy
+
+/**
+ * @brief the header of a block. The memory it holds follows it.
+ */
+struct BUTArenaBlock {
+    BUTArenaBlock *next; ///< the next older block, or NULL
+    size_t         size; ///< the bytes the block can hold
+};
+
+// Round a size up to a multiple of 8.
+#define ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+// The offset of a block's memory from its start.
+#define ARENA_HEADER ARENA_ALIGN(sizeof(BUTArenaBlock))
+
+void *but_arena_alloc(BUTArena *arena, size_t size) {
+    void *memory = NULL;
+
+    size = ARENA_ALIGN(size);
+    if (arena->blocks == NULL || arena->size - arena->used < size) {
+        size_t         block_size = arena->size * 2;
+        BUTArenaBlock *block;
+
+        if (block_size < BUT_ARENA_BLOCK_SIZE) {
+            block_size = BUT_ARENA_BLOCK_SIZE;
+        }
+        while (block_size < size) {
+            block_size *= 2;
+        }
+
+        block = malloc(ARENA_HEADER + block_size);
+        if (block != NULL) {
+            block->next   = arena->blocks;
+            block->size   = block_size;
+            arena->blocks = block;
+            arena->used   = 0;
+            arena->size   = block_size;
+        }
+    }
+
+    if (arena->blocks != NULL && arena->size - arena->used >= size) {
+        memory = (char *)arena->blocks + ARENA_HEADER + arena->used;
+        arena->used += size;
+    }
+
+    return memory;
+}
+
+char *but_arena_copy(BUTArena *arena, char const *text) {
+    char *copy = NULL;
+
+    if (text != NULL) {
+        size_t size = strlen(text) + 1;
+
+        copy = but_arena_alloc(arena, size);
+        if (copy != NULL) {
+            memcpy(copy, text, size);
+        }
+    }
+
+    return copy;
+}
+
+void but_arena_free(BUTArena *arena) {
+    BUTArenaBlock *block = arena->blocks;
+
+    while (block != NULL) {
+        BUTArenaBlock *next = block->next;
+
+        free(block);
+        block = next;
+    }
+
+    arena->blocks = NULL;
+    arena->used   = 0;
+    arena->size   = 0;
+}
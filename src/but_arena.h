@@ -0,0 +1,65 @@
+#ifndef BUT_ARENA_H_
+#define BUT_ARENA_H_
+
+/**
+ * @file but_arena.h
+ * @author Douglas Cuthbertson
+ * @brief A region of memory whose allocations are all released together.
+ * @version 0.1
+ * @date 2025-09-29
+ *
+ * An arena hands out memory from a chain of blocks, each twice the size of the one
+ * before it, so storing n bytes takes O(log n) calls to malloc. Nothing allocated from
+ * an arena moves or is released until the arena is freed.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <stddef.h> // size_t
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_ARENA_BLOCK_SIZE 4096 ///< the size of an arena's first block
+
+typedef struct BUTArenaBlock BUTArenaBlock;
+
+/**
+ * @brief an arena. A zeroed arena is empty and ready for use.
+ */
+typedef struct BUTArena {
+    BUTArenaBlock *blocks; ///< the newest block, which links to the older ones, or NULL
+    size_t         used;   ///< the bytes allocated from the newest block
+    size_t         size;   ///< the bytes the newest block can hold
+} BUTArena;
+
+/**
+ * @brief allocate memory from an arena.
+ *
+ * @param arena the arena.
+ * @param size the number of bytes.
+ * @return memory aligned to 8 bytes, or NULL if a block couldn't be allocated.
+ */
+void *but_arena_alloc(BUTArena *arena, size_t size);
+
+/**
+ * @brief copy a string into an arena.
+ *
+ * @param arena the arena.
+ * @param text a null-terminated string, or NULL.
+ * @return the copy, or NULL if text is NULL or there wasn't enough memory.
+ */
+char *but_arena_copy(BUTArena *arena, char const *text);
+
+/**
+ * @brief release everything allocated from an arena, leaving it empty.
+ *
+ * @param arena the arena.
+ */
+void but_arena_free(BUTArena *arena);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_ARENA_H_
@@ -0,0 +1,339 @@
+/**
+ * @file but_assert.c
+ * @author Douglas Cuthbertson
+ * @brief Allocation budgets for the assertion macros in but_assert.h.
+ * @version 0.1
+ * @date 2025-09-19
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <but_assert.h>        // BUTAllocBudget, BUT_ALLOC_BUDGET_FRAMES
+#include <abbreviated_types.h> // u16, u64
+#include <but_macros.h>        // THREAD_LOCAL, BUT_GLOBAL
+#include <exception.h>         // BUT_THROW_DETAILS_FILE_LINE, but_internal_error
+
+#include <inttypes.h> // PRIu64
+#include <stdbool.h>  // bool, true, false
+#include <stdint.h>   // uintptr_t
+#include <stdio.h>    // snprintf
+#include <string.h>   // memcpy, memset, strcmp, strstr
+#include <threads.h>  // call_once, once_flag
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HeapAlloc, VirtualProtect, CaptureStackBackTrace, etc.
+#include <DbgHelp.h> // SYMBOL_INFO, IMAGEHLP_LINE64
+
+#define BUT_ALLOC_SITE_LENGTH 512 ///< the size of the buffer for a call site
+
+typedef LPVOID WINAPI heap_alloc_fn(HANDLE heap, DWORD flags, SIZE_T bytes);
+typedef LPVOID WINAPI heap_realloc_fn(HANDLE heap, DWORD flags, LPVOID memory,
+                                      SIZE_T bytes);
+
+// DbgHelp is loaded only when a budget is exceeded, so suites don't need to link it.
+typedef DWORD WINAPI sym_get_options_fn(void);
+typedef DWORD WINAPI sym_set_options_fn(DWORD options);
+typedef BOOL WINAPI  sym_initialize_fn(HANDLE process, PCSTR search_path, BOOL invade);
+typedef BOOL WINAPI  sym_refresh_module_list_fn(HANDLE process);
+typedef BOOL WINAPI  sym_from_addr_fn(HANDLE process, DWORD64 address,
+                                      DWORD64 *displacement, SYMBOL_INFO *symbol);
+typedef BOOL WINAPI  sym_get_line_from_addr64_fn(HANDLE process, DWORD64 address,
+                                                 DWORD           *displacement,
+                                                 IMAGEHLP_LINE64 *line);
+
+// The functions each hook calls. If the driver already interposed on the suite's imports
+// to track allocations, these are the driver's hooks, so both see every allocation.
+BUT_GLOBAL heap_alloc_fn   *g_next_heap_alloc_;
+BUT_GLOBAL heap_realloc_fn *g_next_heap_realloc_;
+BUT_GLOBAL bool             g_budget_hooks_installed_;
+BUT_GLOBAL once_flag        g_budget_hooks_once_ = ONCE_FLAG_INIT;
+
+BUT_GLOBAL sym_from_addr_fn            *g_sym_from_addr_;
+BUT_GLOBAL sym_get_line_from_addr64_fn *g_sym_get_line_from_addr64_;
+BUT_GLOBAL sym_refresh_module_list_fn  *g_sym_refresh_module_list_;
+BUT_GLOBAL once_flag                    g_symbols_once_ = ONCE_FLAG_INIT;
+
+// The number of allocations made by this thread since the hooks were installed, the
+// allocation whose call site the innermost budget wants, and the last call site
+// captured.
+BUT_GLOBAL THREAD_LOCAL u64   g_thread_allocs_;
+BUT_GLOBAL THREAD_LOCAL u64   g_watch_;
+BUT_GLOBAL THREAD_LOCAL u64   g_site_;
+BUT_GLOBAL THREAD_LOCAL void *g_site_frames_[BUT_ALLOC_BUDGET_FRAMES];
+BUT_GLOBAL THREAD_LOCAL u16   g_site_frame_count_;
+
+static void count_allocation(void) {
+    u64 serial = ++g_thread_allocs_;
+
+    if (serial == g_watch_) {
+        // Skip this function and the hook that called it.
+        g_site_frame_count_
+            = CaptureStackBackTrace(2, BUT_ALLOC_BUDGET_FRAMES, g_site_frames_, NULL);
+        g_site_ = serial;
+    }
+}
+
+static LPVOID WINAPI budget_heap_alloc(HANDLE heap, DWORD flags, SIZE_T bytes) {
+    LPVOID address = g_next_heap_alloc_(heap, flags, bytes);
+
+    if (address != NULL) {
+        count_allocation();
+    }
+
+    return address;
+}
+
+static LPVOID WINAPI budget_heap_realloc(HANDLE heap, DWORD flags, LPVOID memory,
+                                         SIZE_T bytes) {
+    LPVOID address = g_next_heap_realloc_(heap, flags, memory, bytes);
+
+    if (address != NULL) {
+        count_allocation();
+    }
+
+    return address;
+}
+
+/**
+ * @brief replace one import, by name, in every import descriptor of a module.
+ *
+ * Imports are matched by name rather than by address because the driver may already
+ * have replaced them with its own hooks. The first slot found determines the function
+ * the hook calls, and only slots with that same value are replaced.
+ *
+ * @param module the module to patch.
+ * @param name the name of the imported function.
+ * @param hook the replacement.
+ * @param next receives the function that was imported.
+ * @return true if at least one slot was replaced.
+ */
+static bool patch_import(HMODULE module, char const *name, ULONG_PTR hook,
+                         ULONG_PTR *next) {
+    BYTE                    *base = (BYTE *)module;
+    IMAGE_DOS_HEADER        *dos  = (IMAGE_DOS_HEADER *)base;
+    IMAGE_NT_HEADERS        *nt   = (IMAGE_NT_HEADERS *)(base + dos->e_lfanew);
+    IMAGE_DATA_DIRECTORY    *directory;
+    IMAGE_IMPORT_DESCRIPTOR *descriptor;
+    bool                     patched = false;
+
+    directory = &nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+    if (directory->Size == 0) {
+        return false;
+    }
+
+    descriptor = (IMAGE_IMPORT_DESCRIPTOR *)(base + directory->VirtualAddress);
+    for (; descriptor->Name != 0; descriptor++) {
+        IMAGE_THUNK_DATA *names, *thunk;
+
+        if (descriptor->OriginalFirstThunk == 0) {
+            continue; // there are no names to match
+        }
+
+        names = (IMAGE_THUNK_DATA *)(base + descriptor->OriginalFirstThunk);
+        thunk = (IMAGE_THUNK_DATA *)(base + descriptor->FirstThunk);
+        for (; names->u1.AddressOfData != 0; names++, thunk++) {
+            IMAGE_IMPORT_BY_NAME *import;
+            ULONG_PTR            *slot = (ULONG_PTR *)&thunk->u1.Function;
+            DWORD                 protection;
+
+            if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal)) {
+                continue;
+            }
+
+            import = (IMAGE_IMPORT_BY_NAME *)(base + names->u1.AddressOfData);
+            if (strcmp((char const *)import->Name, name) != 0) {
+                continue;
+            }
+
+            if (*next == 0) {
+                *next = *slot;
+            }
+
+            if (*slot == *next
+                && VirtualProtect(slot, sizeof *slot, PAGE_READWRITE, &protection)) {
+                *slot = hook;
+                VirtualProtect(slot, sizeof *slot, protection, &protection);
+                patched = true;
+            }
+        }
+    }
+
+    return patched;
+}
+
+// Interpose on the imports of the module that contains this code: the test suite, when
+// it's linked with but.lib.
+static void install_budget_hooks(void) {
+    HMODULE   module = NULL;
+    ULONG_PTR next_alloc = 0, next_realloc = 0;
+    bool      patched_alloc;
+
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                                | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            (LPCSTR)(uintptr_t)install_budget_hooks, &module)) {
+        return;
+    }
+
+    // Set the next functions before a hook can be called.
+    g_next_heap_alloc_   = HeapAlloc;
+    g_next_heap_realloc_ = HeapReAlloc;
+    patched_alloc
+        = patch_import(module, "HeapAlloc", (ULONG_PTR)budget_heap_alloc, &next_alloc);
+    if (patched_alloc) {
+        g_next_heap_alloc_ = (heap_alloc_fn *)next_alloc;
+    }
+    if (patch_import(module, "HeapReAlloc", (ULONG_PTR)budget_heap_realloc,
+                     &next_realloc)) {
+        g_next_heap_realloc_ = (heap_realloc_fn *)next_realloc;
+    }
+
+    // Finding the import isn't enough; allocations count only if its slot was written.
+    g_budget_hooks_installed_ = patched_alloc;
+}
+
+static void load_symbols(void) {
+    HMODULE dbghelp = LoadLibraryA("dbghelp.dll");
+
+    if (dbghelp != NULL) {
+        HANDLE              process = GetCurrentProcess();
+        sym_get_options_fn *get_options
+            = (sym_get_options_fn *)GetProcAddress(dbghelp, "SymGetOptions");
+        sym_set_options_fn *set_options
+            = (sym_set_options_fn *)GetProcAddress(dbghelp, "SymSetOptions");
+        sym_initialize_fn *initialize
+            = (sym_initialize_fn *)GetProcAddress(dbghelp, "SymInitialize");
+
+        g_sym_from_addr_ = (sym_from_addr_fn *)GetProcAddress(dbghelp, "SymFromAddr");
+        g_sym_get_line_from_addr64_ = (sym_get_line_from_addr64_fn *)GetProcAddress(
+            dbghelp, "SymGetLineFromAddr64");
+        g_sym_refresh_module_list_ = (sym_refresh_module_list_fn *)GetProcAddress(
+            dbghelp, "SymRefreshModuleList");
+
+        if (get_options != NULL && set_options != NULL && initialize != NULL) {
+            set_options(get_options() | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+            // This fails if the driver already initialized symbols, which is fine.
+            initialize(process, NULL, TRUE);
+        }
+    }
+}
+
+// Return true if a source file belongs to the C runtime rather than the test suite.
+static bool is_runtime_source(char const *file) {
+    return strstr(file, "\\crts\\") != NULL || strstr(file, "\\crt\\") != NULL;
+}
+
+/**
+ * @brief describe the first frame of a call stack that's outside the C runtime's
+ * allocation functions, as "symbol+offset (file:line)", or "module+offset" when there
+ * are no symbols.
+ *
+ * @param frames the return addresses captured for an allocation.
+ * @param frame_count the number of frames.
+ * @param site receives the description.
+ * @param size the size of the site buffer.
+ */
+static void describe_site(void *const *frames, u16 frame_count, char *site,
+                          size_t size) {
+    HANDLE process = GetCurrentProcess();
+
+    call_once(&g_symbols_once_, load_symbols);
+    if (g_sym_refresh_module_list_ != NULL) {
+        g_sym_refresh_module_list_(process);
+    }
+
+    for (u16 i = 0; i < frame_count; i++) {
+        DWORD64 address = (DWORD64)(uintptr_t)frames[i];
+        DWORD64 displacement;
+        DWORD   line_displacement;
+        struct {
+            SYMBOL_INFO info;
+            char        name[256];
+        } symbol;
+        IMAGEHLP_LINE64 line;
+
+        if (g_sym_from_addr_ == NULL || g_sym_get_line_from_addr64_ == NULL) {
+            break;
+        }
+
+        memset(&symbol, 0, sizeof symbol);
+        symbol.info.SizeOfStruct = sizeof symbol.info;
+        symbol.info.MaxNameLen   = sizeof symbol.name;
+        memset(&line, 0, sizeof line);
+        line.SizeOfStruct = sizeof line;
+        if (g_sym_from_addr_(process, address, &displacement, &symbol.info)
+            && g_sym_get_line_from_addr64_(process, address, &line_displacement, &line)
+            && !is_runtime_source(line.FileName)) {
+            snprintf(site, size, "%s+0x%llx (%s:%lu)", symbol.info.Name,
+                     (unsigned long long)displacement, line.FileName,
+                     (unsigned long)line.LineNumber);
+            return;
+        }
+    }
+
+    if (frame_count > 0) {
+        HMODULE module = NULL;
+        char    path[MAX_PATH] = "?";
+
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                                   | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               (LPCSTR)frames[0], &module)) {
+            GetModuleFileNameA(module, path, sizeof path);
+        }
+        snprintf(site, size, "%s+0x%llx", path,
+                 (unsigned long long)((BYTE *)frames[0] - (BYTE *)module));
+    } else {
+        snprintf(site, size, "unknown");
+    }
+}
+
+void but_alloc_budget_begin(BUTAllocBudget *budget, char const *file, int line) {
+    call_once(&g_budget_hooks_once_, install_budget_hooks);
+    if (!g_budget_hooks_installed_) {
+        BUT_THROW_DETAILS_FILE_LINE(but_internal_error,
+                                    "allocation budgets are unavailable because the "
+                                    "heap functions couldn't be interposed",
+                                    file, line);
+    }
+
+    // Save the enclosing budget's state and watch for this budget's first allocation.
+    budget->start             = g_thread_allocs_;
+    budget->outer_watch       = g_watch_;
+    budget->outer_site        = g_site_;
+    budget->outer_frame_count = g_site_frame_count_;
+    memcpy(budget->outer_frames, g_site_frames_, sizeof budget->outer_frames);
+    g_watch_ = budget->start + 1;
+}
+
+void but_alloc_budget_cancel(BUTAllocBudget *budget) {
+    // Restore the enclosing budget's state, unless its first allocation was this one's.
+    g_watch_ = budget->outer_watch;
+    if (g_site_ != budget->outer_watch) {
+        g_site_             = budget->outer_site;
+        g_site_frame_count_ = budget->outer_frame_count;
+        memcpy(g_site_frames_, budget->outer_frames, sizeof g_site_frames_);
+    }
+}
+
+void but_alloc_budget_end(BUTAllocBudget *budget, uint64_t max_allocs, char const *file,
+                          int line) {
+    u64  allocations = g_thread_allocs_ - budget->start;
+    char site[BUT_ALLOC_SITE_LENGTH];
+
+    if (allocations > max_allocs) {
+        if (g_site_ == budget->start + 1) {
+            describe_site(g_site_frames_, g_site_frame_count_, site, sizeof site);
+        } else {
+            snprintf(site, sizeof site, "unknown");
+        }
+    }
+
+    but_alloc_budget_cancel(budget);
+    if (allocations > max_allocs) {
+        BUT_THROW_DETAILS_FILE_LINE(but_unexpected_failure,
+                                    "Expected: at most %" PRIu64
+                                    " allocations. Actual: %" PRIu64
+                                    ". First allocation: %s",
+                                    file, line, max_allocs, allocations, site);
+    }
+}
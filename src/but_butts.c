@@ -7,9 +7,41 @@
  *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
+#include "but_alloc.c"
+#include "but_arena.c"
+#include "but_assert.c"
+#include "but_capture.c"
+#include "but_case_table.c"
 #include "but_driver.c"
+#include "but_events.c"
+#include "but_junit.c"
+#include "but_perf.c"
+#include "but_profile.c"
+#include "but_progress.c"
+#include "but_report.c"
 #include "but_result_context.c"
+#include "but_results.c"
+#include "but_results_tool.c"
+#include "but_timer.c"
+#include "but_trace.c"
+#include "but_tracing.c"
+#include "but_usage.c"
+#include "but_alloc_test.c"
+#include "but_capture_test.c"
+#include "but_driver_test.c"
+#include "but_events_test.c"
+#include "but_junit_test.c"
+#include "but_perf_test.c"
+#include "but_profile_test.c"
+#include "but_progress_test.c"
 #include "but_test.c"
+#include "but_reason_test.c"
+#include "but_report_test.c"
+#include "but_results_test.c"
+#include "but_results_tool_test.c"
+#include "but_thread_test.c"
+#include "but_tracing_test.c"
+#include "but_usage_test.c"
 #include "exception_assert.c"
 #include "exception.c"
 #include "log.c"
@@ -23,6 +55,40 @@ BUT_SUITE_ADD_EMBEDDED(case_name)
 BUT_SUITE_ADD_EMBEDDED(case_index)
 BUT_SUITE_ADD_EMBEDDED(test)
 BUT_SUITE_ADD_EMBEDDED(results)
+BUT_SUITE_ADD(alloc_counts)
+BUT_SUITE_ADD(alloc_no_leaks)
+BUT_SUITE_ADD(alloc_realloc_earlier)
+BUT_SUITE_ADD(alloc_threads)
+BUT_SUITE_ADD(budget_under)
+BUT_SUITE_ADD(budget_over)
+BUT_SUITE_ADD(budget_throw_inside)
+BUT_SUITE_ADD(case_names)
+BUT_SUITE_ADD(mixed_results)
+BUT_SUITE_ADD(run_ranges)
+BUT_SUITE_ADD(arena_results)
+BUT_SUITE_ADD_EMBEDDED(thread_suite)
+BUT_SUITE_ADD(thread_log)
+BUT_SUITE_ADD(thread_trace)
+BUT_SUITE_ADD_EMBEDDED(reason_modules)
+BUT_SUITE_ADD(results_round_trip)
+BUT_SUITE_ADD(results_concatenated)
+BUT_SUITE_ADD(results_damaged)
+BUT_SUITE_ADD(results_skipped)
+BUT_SUITE_ADD(merge_complete)
+BUT_SUITE_ADD(merge_gaps)
+BUT_SUITE_ADD(junit_report)
+BUT_SUITE_ADD(events_stream)
+BUT_SUITE_ADD(report_slowest)
+BUT_SUITE_ADD(report_fixture_heavy)
+BUT_SUITE_ADD(progress_quiet)
+BUT_SUITE_ADD(progress_width)
+BUT_SUITE_ADD(capture_round_trip)
+BUT_SUITE_ADD(capture_limit)
+BUT_SUITE_ADD(perf_session)
+BUT_SUITE_ADD(usage_readings)
+BUT_SUITE_ADD(profile_open_close)
+BUT_SUITE_ADD(tracing_off)
+BUT_SUITE_ADD(tracing_summary)
 BUT_SUITE_END;
 BUT_GET_TEST_SUITE("BUT Driver", driver)
 
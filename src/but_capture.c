@@ -0,0 +1,151 @@
+/**
+ * @file but_capture.c
+ * @author Douglas Cuthbertson
+ * @brief Capture what each test case writes to standard output and error.
+ * @version 0.1
+ * @date 2025-09-27
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_capture.h"
+
+#include <abbreviated_types.h> // u64
+
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h>  // free, realloc
+#include <string.h>  // memset
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // CreateFileA, SetStdHandle, ReadFile, SetFilePointerEx, etc.
+
+bool but_capture_open(BUTCapture *capture) {
+    char directory[MAX_PATH];
+    char path[MAX_PATH];
+
+    memset(capture, 0, sizeof *capture);
+    if (GetTempPathA(sizeof directory, directory) == 0
+        || GetTempFileNameA(directory, "but", 0, path) == 0) {
+        return false;
+    }
+
+    // A temporary file stays in the file cache, and it's deleted when it's closed.
+    capture->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                                NULL);
+    if (capture->file == INVALID_HANDLE_VALUE) {
+        capture->file = NULL;
+        DeleteFileA(path);
+        return false;
+    }
+
+    return true;
+}
+
+void but_capture_close(BUTCapture *capture) {
+    but_capture_restore(capture);
+    if (capture->file != NULL) {
+        CloseHandle(capture->file);
+    }
+    free(capture->text);
+    memset(capture, 0, sizeof *capture);
+}
+
+void but_capture_redirect(BUTCapture *capture) {
+    HANDLE process = GetCurrentProcess();
+
+    if (capture->file == NULL || capture->out != NULL) {
+        return;
+    }
+
+    // Both handles share the file's position, so the output of the two streams is
+    // interleaved in the order it was written.
+    if (!DuplicateHandle(process, capture->file, process, &capture->out, 0, FALSE,
+                         DUPLICATE_SAME_ACCESS)
+        || !DuplicateHandle(process, capture->file, process, &capture->err, 0, FALSE,
+                            DUPLICATE_SAME_ACCESS)) {
+        if (capture->out != NULL) {
+            CloseHandle(capture->out);
+        }
+        capture->out = NULL;
+        capture->err = NULL;
+        return;
+    }
+
+    capture->console = GetStdHandle(STD_OUTPUT_HANDLE);
+    capture->errors  = GetStdHandle(STD_ERROR_HANDLE);
+    SetStdHandle(STD_OUTPUT_HANDLE, capture->out);
+    SetStdHandle(STD_ERROR_HANDLE, capture->err);
+}
+
+void but_capture_restore(BUTCapture *capture) {
+    if (capture->out != NULL) {
+        SetStdHandle(STD_OUTPUT_HANDLE, capture->console);
+        SetStdHandle(STD_ERROR_HANDLE, capture->errors);
+        CloseHandle(capture->out);
+        CloseHandle(capture->err);
+        capture->out = NULL;
+        capture->err = NULL;
+    }
+    capture->flush = NULL;
+}
+
+void but_capture_begin(BUTCapture *capture) {
+    // Only a case that wrote something costs a rewind.
+    if (capture->written > 0) {
+        LARGE_INTEGER start = {0};
+
+        SetFilePointerEx(capture->file, start, NULL, FILE_BEGIN);
+        SetEndOfFile(capture->file);
+        capture->written = 0;
+    }
+}
+
+void but_capture_end(BUTCapture *capture) {
+    LARGE_INTEGER zero = {0};
+    LARGE_INTEGER end;
+
+    if (capture->file == NULL) {
+        return;
+    }
+
+    if (capture->flush != NULL) {
+        capture->flush();
+    }
+    if (SetFilePointerEx(capture->file, zero, &end, FILE_CURRENT)) {
+        capture->written = (u64)end.QuadPart;
+    }
+}
+
+char const *but_capture_read(BUTCapture *capture) {
+    LARGE_INTEGER start = {0};
+    DWORD         size;
+    DWORD         read;
+
+    if (capture->written == 0) {
+        return NULL;
+    }
+
+    size = capture->written < BUT_CAPTURE_LIMIT ? (DWORD)capture->written
+                                                : BUT_CAPTURE_LIMIT;
+    if (capture->capacity < (size_t)size + 1) {
+        char *text = realloc(capture->text, (size_t)size + 1);
+
+        if (text == NULL) {
+            return NULL;
+        }
+        capture->text     = text;
+        capture->capacity = (size_t)size + 1;
+    }
+
+    if (!SetFilePointerEx(capture->file, start, NULL, FILE_BEGIN)
+        || !ReadFile(capture->file, capture->text, size, &read, NULL) || read == 0) {
+        return NULL;
+    }
+    capture->text[read] = '\0';
+
+    return capture->text;
+}
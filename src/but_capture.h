@@ -0,0 +1,110 @@
+#ifndef BUT_CAPTURE_H_
+#define BUT_CAPTURE_H_
+
+/**
+ * @file but_capture.h
+ * @author Douglas Cuthbertson
+ * @brief Capture what each test case writes to standard output and error.
+ * @version 0.1
+ * @date 2025-09-27
+ *
+ * Each test suite links its own copy of the C runtime, which binds its standard streams
+ * to the process's standard handles when the suite is loaded. So the driver points the
+ * standard handles at a temporary file while it loads and runs a suite, and the suite's
+ * output, and its child processes', goes there instead of the console. The file is
+ * marked temporary, so it stays in the file cache the way an in-memory file would, and
+ * it's rewound before each test case, so it only ever holds one case's output. Nothing
+ * is read back unless the case failed.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u64
+#include <exception.h>         // but_flush_output_fn
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HANDLE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_CAPTURE_LIMIT (1 << 20) ///< the most output read back from one test case
+
+/**
+ * @brief the output of the test cases of a suite, being captured.
+ */
+typedef struct BUTCapture {
+    HANDLE               file;     ///< the temporary file that receives the output
+    HANDLE               out;      ///< the standard output handle while redirected
+    HANDLE               err;      ///< the standard error handle while redirected
+    HANDLE               console;  ///< the original standard output handle
+    HANDLE               errors;   ///< the original standard error handle
+    but_flush_output_fn *flush;    ///< flushes the suite's streams, or NULL
+    u64                  written;  ///< the bytes written by the last test case
+    char                *text;     ///< the output read back by but_capture_read
+    size_t               capacity; ///< the size of text in bytes
+} BUTCapture;
+
+/**
+ * @brief create the temporary file that receives the output.
+ *
+ * @param capture the capture.
+ * @return true if the file was created, and false otherwise.
+ */
+bool but_capture_open(BUTCapture *capture);
+
+/**
+ * @brief delete the temporary file, and release the capture's resources.
+ *
+ * @param capture a capture created by but_capture_open.
+ */
+void but_capture_close(BUTCapture *capture);
+
+/**
+ * @brief point the standard handles at the temporary file. Call it before loading a test
+ * suite, so the suite's C runtime writes there.
+ *
+ * @param capture a capture created by but_capture_open.
+ */
+void but_capture_redirect(BUTCapture *capture);
+
+/**
+ * @brief restore the standard handles, after the suite has been unloaded.
+ *
+ * @param capture a capture created by but_capture_open.
+ */
+void but_capture_restore(BUTCapture *capture);
+
+/**
+ * @brief discard the output of the previous test case.
+ *
+ * @param capture a capture created by but_capture_open.
+ */
+void but_capture_begin(BUTCapture *capture);
+
+/**
+ * @brief flush the suite's streams and note how much the test case wrote.
+ *
+ * @param capture a capture created by but_capture_open.
+ */
+void but_capture_end(BUTCapture *capture);
+
+/**
+ * @brief read back the output of the last test case.
+ *
+ * @param capture a capture created by but_capture_open.
+ * @return the output, null-terminated and truncated to BUT_CAPTURE_LIMIT bytes, or NULL
+ * if there was none. It's valid until the next call.
+ */
+char const *but_capture_read(BUTCapture *capture);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_CAPTURE_H_
@@ -0,0 +1,112 @@
+/**
+ * @file but_capture_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of capturing the output of test cases.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The tests write to the capture's temporary file, or to the standard handles while
+ * they're redirected to it, the way a test suite's C runtime would, and read the output
+ * back.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_capture.h" // BUTCapture, but_capture_open, but_capture_read, etc.
+
+#include <but.h>             // BUT_TEST
+#include <but_assert.h>      // BUT_ASSERT_TRUE, BUT_ASSERT_STREQ, BUT_ASSERT_NULL, etc.
+#include <exception_types.h> // BUT_FLUSH_OUTPUT
+
+#include <stdbool.h> // bool, true, false
+#include <string.h>  // memset, strlen
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // WriteFile, GetFileSizeEx, GetStdHandle, HANDLE, etc.
+
+static bool g_capture_flushed_;
+
+static BUT_FLUSH_OUTPUT(note_flush) {
+    g_capture_flushed_ = true;
+}
+
+// Write text to a file handle.
+static void write_capture(HANDLE file, char const *text, DWORD size) {
+    DWORD written = 0;
+
+    BUT_ASSERT_TRUE(WriteFile(file, text, size, &written, NULL));
+    BUT_ASSERT_TRUE(written == size);
+}
+
+// Capture the output of one test case.
+static char const *capture_case(BUTCapture *capture, HANDLE file, char const *text) {
+    but_capture_begin(capture);
+    if (text != NULL) {
+        write_capture(file, text, (DWORD)strlen(text));
+    }
+    but_capture_end(capture);
+
+    return but_capture_read(capture);
+}
+
+// Verify each case reads back only its own output, a case with none reads nothing, the
+// suite's streams are flushed first, and output from both standard handles is kept in
+// the order it was written while they're redirected.
+BUT_TEST("Capture Round Trip", capture_round_trip) {
+    BUTCapture    capture;
+    LARGE_INTEGER size;
+    HANDLE        console = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    BUT_ASSERT_TRUE(but_capture_open(&capture));
+    BUT_ASSERT_NOT_NULL(capture.file);
+
+    capture.flush      = note_flush;
+    g_capture_flushed_ = false;
+    BUT_ASSERT_STREQ(capture_case(&capture, capture.file, "hello\n"), "hello\n");
+    BUT_ASSERT_TRUE(g_capture_flushed_);
+
+    // A shorter output doesn't leave the end of the longer one behind.
+    BUT_ASSERT_STREQ(capture_case(&capture, capture.file, "bye"), "bye");
+    BUT_ASSERT_TRUE(GetFileSizeEx(capture.file, &size));
+    BUT_ASSERT_TRUE(size.QuadPart == 3);
+    BUT_ASSERT_NULL(capture_case(&capture, capture.file, NULL));
+
+    but_capture_redirect(&capture);
+    BUT_ASSERT_TRUE(GetStdHandle(STD_OUTPUT_HANDLE) == capture.out);
+    BUT_ASSERT_TRUE(GetStdHandle(STD_ERROR_HANDLE) == capture.err);
+    but_capture_begin(&capture);
+    write_capture(GetStdHandle(STD_OUTPUT_HANDLE), "out ", 4);
+    write_capture(GetStdHandle(STD_ERROR_HANDLE), "err ", 4);
+    write_capture(GetStdHandle(STD_OUTPUT_HANDLE), "out", 3);
+    but_capture_end(&capture);
+    BUT_ASSERT_STREQ(but_capture_read(&capture), "out err out");
+
+    but_capture_restore(&capture);
+    BUT_ASSERT_TRUE(GetStdHandle(STD_OUTPUT_HANDLE) == console);
+    BUT_ASSERT_NULL(capture.flush);
+    but_capture_close(&capture);
+}
+
+// Verify no more than the limit is read back from a case that wrote more.
+BUT_TEST("Capture Limit", capture_limit) {
+    static char chunk[1 << 16];
+    BUTCapture  capture;
+    char const *text;
+
+    BUT_ASSERT_TRUE(but_capture_open(&capture));
+    memset(chunk, 'x', sizeof chunk);
+
+    but_capture_begin(&capture);
+    for (int i = 0; i < BUT_CAPTURE_LIMIT / (int)sizeof chunk; i++) {
+        write_capture(capture.file, chunk, sizeof chunk);
+    }
+    write_capture(capture.file, chunk, 100);
+    but_capture_end(&capture);
+    BUT_ASSERT_TRUE(capture.written == BUT_CAPTURE_LIMIT + 100);
+
+    text = but_capture_read(&capture);
+    BUT_ASSERT_NOT_NULL(text);
+    BUT_ASSERT_EQ_INT((int)strlen(text), BUT_CAPTURE_LIMIT);
+    but_capture_close(&capture);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file but_case_table.c
+ * @author Douglas Cuthbertson
+ * @brief A compact table of the test cases of a suite, built when the suite is loaded.
+ * @version 0.1
+ * @date 2025-09-30
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_case_table.h"
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestCase, BUTTestSuite
+
+#include <stdbool.h> // bool, true, false
+#include <stddef.h>  // size_t, NULL
+#include <stdlib.h>  // malloc, calloc, free
+#include <string.h>  // memset, memcpy, strlen, strcmp
+
+// FNV-1a
+static u64 hash_name(char const *name) {
+    u64 hash = 0xcbf29ce484222325ull;
+
+    for (; *name != '\0'; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+// Index a case by its name, unless an earlier case has the same name.
+static void index_case(BUTCaseTable *table, u32 index) {
+    u32         slot = (u32)table->hashes[index] & table->slot_mask;
+    char const *name = table->names + table->name_offsets[index];
+
+    while (table->slots[slot] != 0) {
+        u32 other = table->slots[slot] - 1;
+
+        if (table->hashes[other] == table->hashes[index]
+            && strcmp(table->names + table->name_offsets[other], name) == 0) {
+            return;
+        }
+        slot = (slot + 1) & table->slot_mask;
+    }
+    table->slots[slot] = index + 1;
+}
+
+bool but_case_table_build(BUTCaseTable *table, BUTTestSuite const *bts) {
+    size_t names_size = 0;
+    u32    slot_count = 16;
+
+    memset(table, 0, sizeof *table);
+    if (bts->count == 0) {
+        return true;
+    }
+
+    for (u32 i = 0; i < bts->count; i++) {
+        BUTTestCase const *tc = bts->test_cases[i];
+
+        names_size += (tc != NULL && tc->name != NULL ? strlen(tc->name) : 0) + 1;
+    }
+
+    // Keep the index at most half full so probe sequences stay short.
+    while (slot_count < 2 * (u64)bts->count) {
+        slot_count *= 2;
+    }
+
+    table->hashes       = malloc(bts->count * sizeof *table->hashes);
+    table->name_offsets = malloc(bts->count * sizeof *table->name_offsets);
+    table->names        = malloc(names_size);
+    table->slots        = calloc(slot_count, sizeof *table->slots);
+    if (table->hashes == NULL || table->name_offsets == NULL || table->names == NULL
+        || table->slots == NULL) {
+        but_case_table_free(table);
+        return false;
+    }
+
+    table->count     = bts->count;
+    table->slot_mask = slot_count - 1;
+    names_size       = 0;
+    for (u32 i = 0; i < bts->count; i++) {
+        BUTTestCase const *tc   = bts->test_cases[i];
+        char const        *name = tc != NULL && tc->name != NULL ? tc->name : "";
+        size_t             size = strlen(name) + 1;
+
+        memcpy(table->names + names_size, name, size);
+        table->name_offsets[i] = (u32)names_size;
+        table->hashes[i]       = hash_name(name);
+        names_size += size;
+        index_case(table, i);
+    }
+
+    return true;
+}
+
+void but_case_table_free(BUTCaseTable *table) {
+    free(table->hashes);
+    free(table->name_offsets);
+    free(table->names);
+    free(table->slots);
+    memset(table, 0, sizeof *table);
+}
+
+u32 but_case_table_find(BUTCaseTable const *table, char const *name) {
+    u64 hash;
+    u32 slot;
+
+    if (table->slots == NULL) {
+        return BUT_CASE_NOT_FOUND;
+    }
+
+    hash = hash_name(name);
+    slot = (u32)hash & table->slot_mask;
+    while (table->slots[slot] != 0) {
+        u32 index = table->slots[slot] - 1;
+
+        if (table->hashes[index] == hash
+            && strcmp(table->names + table->name_offsets[index], name) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & table->slot_mask;
+    }
+
+    return BUT_CASE_NOT_FOUND;
+}
+
+char const *but_case_table_name(BUTCaseTable const *table, u32 index) {
+    return index < table->count ? table->names + table->name_offsets[index] : NULL;
+}
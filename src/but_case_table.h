@@ -0,0 +1,82 @@
+#ifndef BUT_CASE_TABLE_H_
+#define BUT_CASE_TABLE_H_
+
+/**
+ * @file but_case_table.h
+ * @author Douglas Cuthbertson
+ * @brief A compact table of the test cases of a suite, built when the suite is loaded.
+ * @version 0.1
+ * @date 2025-09-30
+ *
+ * A suite's test cases are scattered through its library's data, each with a pointer to
+ * a name elsewhere. The table copies what the driver scans by name into a few parallel
+ * arrays: the hash of each name and its offset in one block holding every name. Listing,
+ * matching, or counting cases then reads memory sequentially instead of following two
+ * pointers per case, and a hash index finds a case by its exact name in constant time.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdbool.h> // bool
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_CASE_NOT_FOUND 0xffffffffu ///< the index of a case that isn't in the table
+
+/**
+ * @brief the test cases of a suite, an array for each field. A zeroed table is empty.
+ */
+typedef struct BUTCaseTable {
+    u32   count;        ///< the number of test cases
+    u64  *hashes;       ///< the hash of each case's name
+    u32  *name_offsets; ///< the offset of each case's name in names
+    char *names;        ///< every name, each followed by a null
+    u32  *slots;        ///< a hash index of case numbers, 1-based; 0 is empty
+    u32   slot_mask;    ///< the number of slots less one; a power of 2 less 1
+} BUTCaseTable;
+
+/**
+ * @brief build the table of a test suite's cases.
+ *
+ * @param table the table.
+ * @param bts the test suite.
+ * @return true if the table was built, and false if there wasn't enough memory, in which
+ * case the table is empty.
+ */
+bool but_case_table_build(BUTCaseTable *table, BUTTestSuite const *bts);
+
+/**
+ * @brief release a table's memory, leaving it empty.
+ *
+ * @param table a table built by but_case_table_build.
+ */
+void but_case_table_free(BUTCaseTable *table);
+
+/**
+ * @brief find a test case by its exact name.
+ *
+ * @param table a table built by but_case_table_build.
+ * @param name the name of a test case.
+ * @return the index of the first case with the name, or BUT_CASE_NOT_FOUND.
+ */
+u32 but_case_table_find(BUTCaseTable const *table, char const *name);
+
+/**
+ * @brief retrieve the name of a test case.
+ *
+ * @param table a table built by but_case_table_build.
+ * @param index the index of a test case.
+ * @return the name, or NULL if the index is out of range.
+ */
+char const *but_case_table_name(BUTCaseTable const *table, u32 index);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_CASE_TABLE_H_
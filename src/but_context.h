@@ -11,9 +11,17 @@
  * See LICENSE.txt for copyright and licensing information about this file.
  *
  */
+#include "but_alloc.h"      // BUTAllocStats
+#include "but_arena.h"      // BUTArena
+#include "but_case_table.h" // BUTCaseTable
+#include "but_perf.h"       // BUTPerfCounters, BUTPerfSession
+#include "but_profile.h"    // BUTProfiler
+#include "but_trace.h"      // BUTTraceSummary
+#include "but_usage.h"      // BUTUsage
+
 #include <but.h>               // BUTTestCase and BUTTestSuite
-#include <exception_types.h>   // BUTExceptionContext
-#include <abbreviated_types.h> // u32
+#include <exception_types.h>   // BUTExceptionContext, but_set_exception_context_fn
+#include <abbreviated_types.h> // u32, flag32
 
 #include <stdbool.h> // bool
 #include <stdint.h>  // uintptr_t
@@ -32,6 +40,40 @@ typedef enum BUTResultCode {
 
 typedef struct ResultContext ResultContext;
 
+/**
+ * @brief Options that enable optional per-case measurements in but_driver. Combine them
+ * with bitwise-or and pass them to but_set_options.
+ */
+typedef enum BUTOption {
+    BUT_OPTION_PERF_COUNTERS = 1 << 0, ///< collect hardware performance counters
+    BUT_OPTION_TRACK_ALLOCS  = 1 << 1, ///< count each case's heap allocations
+    BUT_OPTION_LEAKS_FAIL    = 1 << 2, ///< fail a test case that leaks heap memory
+    BUT_OPTION_USAGE         = 1 << 3, ///< measure each case's OS resource usage
+    BUT_OPTION_PROFILE       = 1 << 4, ///< sample the call stacks of test functions
+    BUT_OPTION_TRACE         = 1 << 5, ///< record each case's phases on a timeline
+} BUTOption;
+
+/**
+ * @brief The measurements collected for one test case. Unlike a ResultContext, every
+ * test case has one, but only when at least one measurement option is enabled.
+ */
+typedef struct BUTCaseMetrics {
+    BUTPerfCounters counters; ///< performance counters for the test function
+    BUTAllocStats   allocs;   ///< heap allocations from setup through cleanup
+    BUTUsage        usage;    ///< OS resource usage from setup through cleanup
+    BUTTraceSummary trace;    ///< the suite's trace spans and counters
+} BUTCaseMetrics;
+
+/**
+ * @brief How long each phase of a test case took, measured with the monotonic
+ * performance counter. A phase that didn't run took zero.
+ */
+typedef struct BUTCaseTimes {
+    u64 setup_ns;   ///< the setup function
+    u64 test_ns;    ///< the test function
+    u64 cleanup_ns; ///< the cleanup function
+} BUTCaseTimes;
+
 /**
  * @brief A BUTEnvironment is used to iterate through the test cases in a test suite,
  * keep track of the tests that have been exercised, which tests remain, and the results
@@ -48,6 +90,15 @@ typedef struct BUTEnvironment {
     u32                  results_count;    ///< number of test results
     u32                  results_capacity; ///< number of results that can be stored
     ResultContext       *results;          ///< a resizable array of test results.
+    u08                 *statuses;         ///< a BUTResultCode per case, 4 to a byte
+    u32                 *first_results;    ///< per case, 1 + its first result, or 0
+    BUTArena             arena;            ///< the strings the results refer to
+    BUTCaseTable         cases;            ///< the suite's cases, laid out for scanning
+    BUTCaseMetrics      *metrics;          ///< per-case measurements, or NULL
+    BUTCaseTimes        *times;            ///< per-case phase durations, or NULL
+    BUTPerfSession       perf;             ///< this thread's performance counters
+    BUTProfiler          profiler;         ///< samples this thread's test functions
+    flag32               options;          ///< a combination of BUTOption flags
     bool                 initialized;      ///< indicates a valid context
 } BUTEnvironment;
 
@@ -55,8 +106,13 @@ typedef struct BUTEnvironment {
  * @brief A test context combines an exception context and a test environment.
  */
 typedef struct BUTContext {
-    BUTExceptionContext exception_context;
-    BUTEnvironment      env;
+    BUTExceptionContext           exception_context;
+    BUTEnvironment                env;
+    but_set_exception_context_fn *set_suite_context; ///< see but_register_suite, or NULL
+    BUTExceptionContext          *driver_previous;   ///< the driver's, before attaching
+    BUTExceptionContext          *suite_previous;    ///< the suite's, before attaching
+    bool                          driver_attached;   ///< driver_previous is to restore
+    bool                          suite_attached;    ///< suite_previous is to restore
 } BUTContext;
 
 #if defined(__cplusplus)
@@ -8,7 +8,15 @@
  * See LICENSE.txt for copyright and licensing information about this file.
  */
 #include "but_driver.h"
+#include "but_alloc.h"          // but_alloc_begin_case, but_alloc_end_case
+#include "but_arena.h"          // but_arena_copy, but_arena_free
+#include "but_case_table.h"     // but_case_table_build, but_case_table_find, etc.
+#include "but_perf.h"           // but_perf_open, but_perf_read, etc.
+#include "but_profile.h"        // but_profile_open, but_profile_start, etc.
 #include "but_result_context.h" // new_result
+#include "but_timer.h"          // but_timer_now, but_timer_ticks_to_ns
+#include "but_trace.h"          // but_trace_span, but_trace_now, but_trace_tracer, etc.
+#include "but_usage.h"          // but_usage_read, but_usage_delta
 #include "intrinsics_win32.h"
 #include "log.h" // LOG_ERROR
 
@@ -16,9 +24,11 @@
 
 #include <stdbool.h> // bool, true, false
 #include <stdint.h>  // uintptr_t
-#include <stdlib.h>  // free
+#include <stdlib.h>  // calloc, free
+#include <string.h>  // memset, strcmp
 
 static BUTExceptionReason invalid_test_case = "invalid test case";
+static BUTExceptionReason but_memory_leak   = "memory leak";
 
 // Check the validity of the test context
 BUT_IS_VALID(but_is_valid) {
@@ -58,19 +68,98 @@ BUT_LOG_ERROR(but_log_error) {
 // initialize the test context
 BUT_INITIALIZE(but_initialize) {
     memset(bctx, 0, sizeof *bctx);
+    bctx->exception_context.reasons = but_reason_registry();
     if (handler != NULL) {
         bctx->exception_context.handler = handler;
-        but_set_exception_context(&bctx->exception_context, __FILE__, __LINE__);
+        bctx->driver_previous
+            = but_set_exception_context(&bctx->exception_context, __FILE__, __LINE__);
+        bctx->driver_attached = true;
     } else {
         bctx->exception_context.handler = but_default_handler;
     }
     bctx->env.initialized = true;
 }
 
+// enable optional measurements
+BUT_SET_OPTIONS(but_set_options) {
+    bctx->env.options = options;
+}
+
+// remember how to install an exception context in the suite's library
+BUT_REGISTER_SUITE(but_register_suite) {
+    bctx->set_suite_context = set_context;
+}
+
+// install the context's exception context for the calling thread
+BUT_ATTACH_THREAD(but_attach_thread) {
+    BUTExceptionContext *previous
+        = but_set_exception_context(&bctx->exception_context, __FILE__, __LINE__);
+
+    // but_initialize may have installed it already, and recorded what it replaced.
+    if (!bctx->driver_attached) {
+        bctx->driver_previous = previous;
+        bctx->driver_attached = true;
+    }
+    if (bctx->set_suite_context != NULL && !bctx->suite_attached) {
+        bctx->suite_previous
+            = bctx->set_suite_context(&bctx->exception_context, __FILE__, __LINE__);
+        bctx->suite_attached = true;
+    }
+}
+
+// restore the calling thread's previous exception contexts, even if they were NULL
+BUT_DETACH_THREAD(but_detach_thread) {
+    if (bctx->suite_attached) {
+        bctx->set_suite_context(bctx->suite_previous, __FILE__, __LINE__);
+        bctx->suite_previous = NULL;
+        bctx->suite_attached = false;
+    }
+    if (bctx->driver_attached) {
+        but_set_exception_context(bctx->driver_previous, __FILE__, __LINE__);
+        bctx->driver_previous = NULL;
+        bctx->driver_attached = false;
+    }
+}
+
 // assign a test suite to a test context
 BUT_BEGIN(but_begin) {
     bctx->env.bts             = bts;
     bctx->env.test_case_count = bts->count;
+
+    if (!but_case_table_build(&bctx->env.cases, bts)) {
+        LOG_ERROR("Case Table", "not enough memory for a table of %u test cases",
+                  bts->count);
+    }
+
+    if (bts->count > 0) {
+        bctx->env.times    = calloc(bts->count, sizeof *bctx->env.times);
+        bctx->env.statuses = calloc(((size_t)bts->count + 3) / 4, 1);
+    }
+
+    if (bctx->env.options != 0 && bts->count > 0) {
+        bctx->env.metrics = calloc(bts->count, sizeof *bctx->env.metrics);
+    }
+
+    // Context switches for BUT_OPTION_USAGE come from the performance counters, too.
+    if (bctx->env.options & (BUT_OPTION_PERF_COUNTERS | BUT_OPTION_USAGE)) {
+        if (!but_perf_open(&bctx->env.perf)
+            && (bctx->env.options & BUT_OPTION_PERF_COUNTERS)) {
+            LOG_INFO("Perf Counters",
+                     "hardware counters are unavailable; collecting cycles only");
+        }
+    }
+
+    if (bctx->env.options & BUT_OPTION_TRACE) {
+        bctx->exception_context.on_throw = but_trace_on_throw;
+        bctx->exception_context.tracer   = but_trace_tracer();
+    }
+
+    if (bctx->env.options & BUT_OPTION_PROFILE) {
+        if (!but_profile_open(&bctx->env.profiler)) {
+            LOG_ERROR("Profile", "failed to start the sampling thread: %lu",
+                      GetLastError());
+        }
+    }
 }
 
 // release the memory resources allocated during testing
@@ -79,6 +168,23 @@ BUT_END(but_end) {
         free(bctx->env.results);
         bctx->env.results = 0;
     }
+
+    if (bctx->env.metrics) {
+        free(bctx->env.metrics);
+        bctx->env.metrics = 0;
+    }
+
+    free(bctx->env.times);
+    bctx->env.times = NULL;
+    free(bctx->env.statuses);
+    bctx->env.statuses = NULL;
+    free(bctx->env.first_results);
+    bctx->env.first_results = NULL;
+    but_arena_free(&bctx->env.arena);
+    but_case_table_free(&bctx->env.cases);
+
+    but_perf_close(&bctx->env.perf);
+    but_profile_close(&bctx->env.profiler);
 }
 
 // Move to the next test case
@@ -95,88 +201,287 @@ BUT_HAS_MORE(but_has_more) {
 
 // Get the name of the current test case
 BUT_GET_TEST_CASE_NAME(but_get_test_case_name) {
-    char const   *name;
-    BUTTestSuite *bts = bctx->env.bts;
+    char const *name = but_get_case_name(bctx, bctx->env.index);
 
-    if (bctx->env.index >= 0 && bctx->env.index < bctx->env.test_case_count) {
-        name = bts->test_cases[bctx->env.index]->name;
-    } else {
+    if (name == NULL) {
         name = "test case index out of range";
     }
 
     return name;
 }
 
+// Get the name of any test case
+BUT_GET_CASE_NAME(but_get_case_name) {
+    char const *name = NULL;
+
+    if (index < bctx->env.cases.count) {
+        name = but_case_table_name(&bctx->env.cases, index);
+    } else if (index < bctx->env.test_case_count) {
+        // The table couldn't be built, so read the suite.
+        name = bctx->env.bts->test_cases[index]->name;
+    }
+
+    return name;
+}
+
+// Find a test case by name
+BUT_FIND_TEST_CASE(but_find_test_case) {
+    u32 index = but_case_table_find(&bctx->env.cases, case_name);
+
+    // If the table couldn't be built, search the suite.
+    for (u32 i = bctx->env.cases.count;
+         index == BUT_CASE_NOT_FOUND && i < bctx->env.test_case_count; i++) {
+        if (strcmp(bctx->env.bts->test_cases[i]->name, case_name) == 0) {
+            index = i;
+        }
+    }
+
+    return index;
+}
+
 // Get the index of the current test case
 BUT_GET_INDEX(but_get_index) {
     return bctx->env.index;
 }
 
+/**
+ * @brief collect the measurements that span a whole test case, from the start of its
+ * setup through the end of its cleanup.
+ *
+ * @param bctx the test context.
+ * @param metrics the current case's measurements.
+ * @param usage_begin the resource usage read before the case's setup.
+ * @param trace_begin the position of the case's first trace event.
+ */
+static void end_case_metrics(BUTContext *bctx, BUTCaseMetrics *metrics,
+                             BUTUsage const *usage_begin,
+                             BUTTraceMark const *trace_begin) {
+    if (bctx->env.options & BUT_OPTION_USAGE) {
+        BUTUsage usage_end;
+
+        but_usage_read(&bctx->env.perf, &usage_end);
+        but_usage_delta(usage_begin, &usage_end, &metrics->usage);
+    }
+
+    if (bctx->env.options & BUT_OPTION_TRACK_ALLOCS) {
+        but_alloc_end_case(&metrics->allocs);
+    }
+
+    if (bctx->env.options & BUT_OPTION_TRACE) {
+        but_trace_summarize(trace_begin, &metrics->trace);
+    }
+}
+
+// Read the timer if the run is being traced, so untraced runs don't pay for it.
+static u64 trace_now(BUTContext *bctx) {
+    return (bctx->env.options & BUT_OPTION_TRACE) ? but_trace_now() : 0;
+}
+
+// Record a span that started at begin and ends now, if the run is being traced.
+static void trace_span(BUTContext *bctx, char const *category, char const *name,
+                       u64 begin) {
+    if (bctx->env.options & BUT_OPTION_TRACE) {
+        but_trace_span(category, name, begin, but_trace_now());
+    }
+}
+
+// Record how long a phase took, from begin until now.
+static void end_phase(u64 *phase_ns, u64 begin) {
+    *phase_ns = but_timer_ticks_to_ns(but_timer_now() - begin);
+}
+
 // Execute the current test case
 BUT_DRIVER(but_driver) {
-    BUTResultCode result = BUT_PASSED;
-    BUTTestCase  *tc     = bctx->env.bts->test_cases[bctx->env.index];
+    BUTResultCode   result      = BUT_PASSED;
+    BUTTestCase    *tc          = bctx->env.bts->test_cases[bctx->env.index];
+    BUTCaseMetrics *metrics     = NULL;
+    BUTUsage        usage_begin = {0};
+    BUTTraceMark    trace_begin = {0};
+    BUTCaseTimes    scratch     = {0};
+    BUTCaseTimes   *times       = &scratch;
+    u64             case_begin;
+    u64             phase_begin;
+    u64             ticks;
 
     if (tc == NULL) {
         result = BUT_FAILED;
-        new_result(bctx, BUT_FAILED, invalid_test_case, __FILE__, __LINE__);
+        new_result(bctx, BUT_FAILED, invalid_test_case, NULL, __FILE__, __LINE__);
         bctx->env.test_failures++;
         BUT_THROW_DETAILS(invalid_test_case, "test case %u does not exist",
                           bctx->env.index);
     }
 
+    if (bctx->env.metrics != NULL) {
+        metrics = &bctx->env.metrics[bctx->env.index];
+        if (bctx->env.options & BUT_OPTION_TRACK_ALLOCS) {
+            but_alloc_begin_case();
+        }
+        if (bctx->env.options & BUT_OPTION_USAGE) {
+            but_usage_read(&bctx->env.perf, &usage_begin);
+        }
+        if (bctx->env.options & BUT_OPTION_TRACE) {
+            but_trace_mark(&trace_begin);
+        }
+    }
+
+    if (bctx->env.times != NULL) {
+        times = &bctx->env.times[bctx->env.index];
+    }
+
+    case_begin = trace_now(bctx);
     if (tc->setup != NULL) {
+        ticks = but_timer_now();
         BUT_TRY {
             tc->setup(tc);
         }
         BUT_CATCH_ALL {
-            if (BUT_UNEXPECTED_EXCEPTION(BUT_REASON)) {
+            end_phase(&times->setup_ns, ticks);
+            trace_span(bctx, "phase", "setup", case_begin);
+            trace_span(bctx, "case", tc->name, case_begin);
+            if (metrics != NULL) {
+                end_case_metrics(bctx, metrics, &usage_begin, &trace_begin);
+            }
+            if (BUT_REASON_ID != BUT_REASON_ID_EXPECTED_FAILURE) {
                 result = BUT_FAILED_SETUP;
-                new_result(bctx, BUT_FAILED_SETUP, BUT_REASON, BUT_FILE, BUT_LINE);
+                new_result(bctx, BUT_FAILED_SETUP, BUT_REASON, BUT_DETAILS, BUT_FILE,
+                           BUT_LINE);
                 bctx->env.setup_failures++;
             }
             bctx->env.run_count++;
             BUT_RETHROW;
         }
         BUT_END_TRY;
+        end_phase(&times->setup_ns, ticks);
+        trace_span(bctx, "phase", "setup", case_begin);
     }
 
     if (result == BUT_PASSED) {
         if (tc->test != NULL) {
+            BUTPerfCounters counters_begin = {0};
+
+            if (metrics != NULL && (bctx->env.options & BUT_OPTION_PERF_COUNTERS)) {
+                but_perf_read(&bctx->env.perf, &counters_begin);
+            }
+
+            if (metrics != NULL && (bctx->env.options & BUT_OPTION_PROFILE)) {
+                but_profile_start(&bctx->env.profiler);
+            }
+
+            phase_begin = trace_now(bctx);
+            ticks       = but_timer_now();
             BUT_TRY {
                 tc->test(tc);
             }
             BUT_CATCH_ALL {
-                if (BUT_UNEXPECTED_EXCEPTION(BUT_REASON)) {
+                if (BUT_REASON_ID != BUT_REASON_ID_EXPECTED_FAILURE) {
                     BUTExceptionReason reason  = BUT_REASON;
                     char const        *details = BUT_DETAILS;
                     char const        *file    = BUT_FILE;
                     int                line    = BUT_LINE;
-                    new_result(bctx, BUT_FAILED, reason, file, line);
+                    result = BUT_FAILED;
+                    new_result(bctx, BUT_FAILED, reason, details, file, line);
                     bctx->env.test_failures++;
                     but_log_error(tc->name, reason, details, file, line);
                 }
             }
             BUT_END_TRY;
+            end_phase(&times->test_ns, ticks);
+            trace_span(bctx, "phase", "test", phase_begin);
+
+            if (metrics != NULL && (bctx->env.options & BUT_OPTION_PROFILE)) {
+                but_profile_stop(&bctx->env.profiler);
+            }
+
+            if (metrics != NULL && (bctx->env.options & BUT_OPTION_PERF_COUNTERS)) {
+                BUTPerfCounters counters_end;
+
+                but_perf_read(&bctx->env.perf, &counters_end);
+                but_perf_delta(&counters_begin, &counters_end, &metrics->counters);
+            }
         }
         bctx->env.run_count++;
     }
 
     if (tc->cleanup != NULL) {
+        phase_begin = trace_now(bctx);
+        ticks       = but_timer_now();
         BUT_TRY {
             tc->cleanup(tc);
         }
         BUT_CATCH_ALL {
-            if (BUT_UNEXPECTED_EXCEPTION(BUT_REASON)) {
-                new_result(bctx, BUT_FAILED_CLEANUP, BUT_REASON, BUT_FILE, BUT_LINE);
+            end_phase(&times->cleanup_ns, ticks);
+            trace_span(bctx, "phase", "cleanup", phase_begin);
+            trace_span(bctx, "case", tc->name, case_begin);
+            if (metrics != NULL) {
+                end_case_metrics(bctx, metrics, &usage_begin, &trace_begin);
+            }
+            if (BUT_REASON_ID != BUT_REASON_ID_EXPECTED_FAILURE) {
+                new_result(bctx, BUT_FAILED_CLEANUP, BUT_REASON, BUT_DETAILS, BUT_FILE,
+                           BUT_LINE);
                 bctx->env.cleanup_failures++;
             }
             BUT_RETHROW;
         }
         BUT_END_TRY;
+        end_phase(&times->cleanup_ns, ticks);
+        trace_span(bctx, "phase", "cleanup", phase_begin);
+    }
+    trace_span(bctx, "case", tc->name, case_begin);
+
+    if (metrics != NULL) {
+        end_case_metrics(bctx, metrics, &usage_begin, &trace_begin);
+
+        // A leak only fails a case that would otherwise have passed.
+        if (result == BUT_PASSED && metrics->allocs.leaks > 0
+            && (bctx->env.options & BUT_OPTION_LEAKS_FAIL)) {
+            new_result(bctx, BUT_FAILED, but_memory_leak, NULL, __FILE__, __LINE__);
+            bctx->env.test_failures++;
+            LOG_ERROR("Test Failure", "%s: %s of %u allocations (%llu bytes)", tc->name,
+                      but_memory_leak, metrics->allocs.leaks,
+                      (unsigned long long)metrics->allocs.leaked_bytes);
+        }
     }
 }
 
+// Execute a span of test cases in one try block
+BUT_RUN_RANGE(but_run_range) {
+    static BUTRunCallbacks const none = {0};
+
+    if (callbacks == NULL) {
+        callbacks = &none;
+    }
+    if (end > bctx->env.test_case_count) {
+        end = bctx->env.test_case_count;
+    }
+    // Leave the index at the end of the suite, not past it, for a range that starts past
+    // the last case.
+    if (first > bctx->env.test_case_count) {
+        first = bctx->env.test_case_count;
+    }
+
+    bctx->env.index = first;
+    BUT_TRY {
+        while (bctx->env.index < end) {
+            if (callbacks->case_started != NULL) {
+                callbacks->case_started(bctx, callbacks->data);
+            }
+            but_driver(bctx);
+            if (callbacks->case_finished != NULL) {
+                callbacks->case_finished(bctx, callbacks->data);
+            }
+            bctx->env.index++;
+        }
+    }
+    BUT_CATCH_ALL {
+        // but_driver already recorded the failure; report the case before rethrowing.
+        if (callbacks->case_finished != NULL) {
+            callbacks->case_finished(bctx, callbacks->data);
+        }
+        BUT_RETHROW;
+    }
+    BUT_END_TRY;
+}
+
 // Get the number of test cases executed
 BUT_GET_RUN_COUNT(but_get_run_count) {
     return bctx->env.run_count;
@@ -209,29 +514,107 @@ BUT_GET_RESULTS_COUNT(but_get_results_count) {
     return bctx->env.results_count;
 }
 
-// Get the result code from the result context of a test case
-BUT_GET_RESULT(but_get_result) {
-    BUTResultCode but_result;
-    u32           i;
+// Find the first result of a test case. Each case's first result is indexed when it's
+// recorded; if the index couldn't be allocated, search the results, which are appended
+// as the cases run, so they're sorted by index. Return results_count if there's none.
+static u32 find_first_result(BUTContext *bctx, u32 index) {
+    u32 low  = 0;
+    u32 high = bctx->env.results_count;
 
-    if (bctx->env.results_count == 0) {
-        // No results were generated, so all tests passed
-        but_result = BUT_PASSED;
+    if (bctx->env.first_results != NULL && index < bctx->env.test_case_count) {
+        low = bctx->env.first_results[index];
+        low = low != 0 ? low - 1 : bctx->env.results_count;
     } else {
-        // Search the results and see if there's one matching the index
-        i = 0;
-        while (i < bctx->env.results_count && bctx->env.results[i].index < index) {
-            i++;
+        while (low < high) {
+            u32 middle = low + (high - low) / 2;
+
+            if (bctx->env.results[middle].index < index) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < bctx->env.results_count && bctx->env.results[low].index != index) {
+            low = bctx->env.results_count;
         }
+    }
 
-        if (i < bctx->env.results_count && bctx->env.results[i].index == index) {
-            // We have a match
+    return low;
+}
+
+// Get the result code from the result context of a test case
+BUT_GET_RESULT(but_get_result) {
+    BUTResultCode but_result = BUT_PASSED;
+    u32           i;
+
+    if (bctx->env.statuses != NULL && index < bctx->env.test_case_count) {
+        but_result = BUT_CASE_STATUS(bctx->env.statuses, index);
+    } else if (bctx->env.results_count != 0) {
+        // There's no status table, so look up the results.
+        i = find_first_result(bctx, index);
+        if (i < bctx->env.results_count) {
             but_result = bctx->env.results[i].status;
-        } else {
-            // There's no result, so if it ran it passed
-            but_result = BUT_PASSED;
         }
     }
 
+    // If there's no result and it ran, it passed
     return but_result;
 }
+
+// Get the results of a test case that didn't pass
+BUT_GET_CASE_RESULTS(but_get_case_results) {
+    ResultContext const *first = NULL;
+    u32                  i;
+
+    *count = 0;
+    // A case whose status is BUT_PASSED has no results, so there's nothing to find.
+    if (bctx->env.statuses == NULL || index >= bctx->env.test_case_count
+        || BUT_CASE_STATUS(bctx->env.statuses, index) != BUT_PASSED) {
+        // A case's results are recorded while it runs, so they're contiguous.
+        i = find_first_result(bctx, index);
+        if (i < bctx->env.results_count) {
+            first = &bctx->env.results[i];
+            while (i < bctx->env.results_count && bctx->env.results[i].index == index) {
+                (*count)++;
+                i++;
+            }
+        }
+    }
+
+    return first;
+}
+
+// Keep the output of the current test case with its first result
+BUT_KEEP_CASE_OUTPUT(but_keep_case_output) {
+    char const *copy = NULL;
+    u32         i    = find_first_result(bctx, bctx->env.index);
+
+    if (i < bctx->env.results_count) {
+        copy                        = but_arena_copy(&bctx->env.arena, output);
+        bctx->env.results[i].output = copy;
+    }
+
+    return copy;
+}
+
+// Get the measurements collected for a test case
+BUT_GET_CASE_METRICS(but_get_case_metrics) {
+    BUTCaseMetrics const *metrics = NULL;
+
+    if (bctx->env.metrics != NULL && index < bctx->env.test_case_count) {
+        metrics = &bctx->env.metrics[index];
+    }
+
+    return metrics;
+}
+
+// Get the durations of a test case's phases
+BUT_GET_CASE_TIMES(but_get_case_times) {
+    BUTCaseTimes const *times = NULL;
+
+    if (bctx->env.times != NULL && index < bctx->env.test_case_count) {
+        times = &bctx->env.times[index];
+    }
+
+    return times;
+}
@@ -8,13 +8,32 @@
  * @version 0.1
  * @date 2023-12-09
  *
+ * A context holds all the state of one run of a test suite, so several contexts can run
+ * at once, one per thread. Each statically linked copy of the exception library, the
+ * driver's and the suite's, keeps its own per-thread pointer to the exception context
+ * that a throw unwinds, so a thread has to install its context in both before it runs a
+ * test case. To run a suite on N threads:
+ *
+ * 1. load the suite once, and on each worker thread,
+ * 2. call but_initialize, but_register_suite with the suite's but_set_exception_context,
+ *    and but_attach_thread,
+ * 3. call but_begin, and then but_run_range with the span of cases the worker owns,
+ * 4. call but_end and but_detach_thread.
+ *
+ * A context must be used by one thread at a time, and but_begin through but_end must run
+ * on the same thread, because the performance counters, usage and profiler it opens
+ * measure the thread that opened them. The trace buffers and the log are shared safely
+ * between threads. The heap-allocation tracker is safe too, but it counts one test case
+ * at a time for the whole process, so BUT_OPTION_TRACK_ALLOCS is only meaningful when
+ * one context runs at a time.
+ *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
 #include "but_context.h" // BUTContext
 
 #include <but.h>               // BUTTestCase and BUTTestSuite
 #include <exception_types.h>   // BUTExceptionContext
-#include <abbreviated_types.h> // u32
+#include <abbreviated_types.h> // u32, flag32
 
 #include <stdbool.h> // bool
 
@@ -55,11 +74,62 @@ BUT_LOG_ERROR(but_log_error);
  * @brief initialize a test context.
  *
  * @param bctx the test context to be initialized.
+ * @param handler the handler for exceptions that no test case catches, or NULL for the
+ * default. If it isn't NULL, the context is installed as the calling thread's exception
+ * context in the driver, as but_attach_thread would, and but_detach_thread restores the
+ * one it replaced.
  */
 #define BUT_INITIALIZE(name) void name(BUTContext *bctx, but_handler handler)
 typedef BUT_INITIALIZE(but_initialize_fn);
 BUT_INITIALIZE(but_initialize);
 
+/**
+ * @brief but_set_options enables optional measurements. Call it after but_initialize and
+ * before but_begin.
+ *
+ * @param bctx a test context.
+ * @param options a combination of BUTOption flags.
+ */
+#define BUT_SET_OPTIONS(name) void name(BUTContext *bctx, flag32 options)
+typedef BUT_SET_OPTIONS(but_set_options_fn);
+BUT_SET_OPTIONS(but_set_options);
+
+/**
+ * @brief remember how to install an exception context in the library of the test
+ * suite a context runs, so but_attach_thread can install it on each thread that runs
+ * the suite.
+ *
+ * @param bctx a test context.
+ * @param set_context the but_set_exception_context that the suite's library exports.
+ */
+#define BUT_REGISTER_SUITE(name) \
+    void name(BUTContext *bctx, but_set_exception_context_fn *set_context)
+typedef BUT_REGISTER_SUITE(but_register_suite_fn);
+BUT_REGISTER_SUITE(but_register_suite);
+
+/**
+ * @brief make a context's exception context the calling thread's, both in the driver
+ * and in the library of the suite registered with but_register_suite, so exceptions
+ * thrown by the suite's test cases on this thread reach the driver's handlers for this
+ * context.
+ *
+ * @param bctx a test context that no other thread is attached to.
+ */
+#define BUT_ATTACH_THREAD(name) void name(BUTContext *bctx)
+typedef BUT_ATTACH_THREAD(but_attach_thread_fn);
+BUT_ATTACH_THREAD(but_attach_thread);
+
+/**
+ * @brief restore the exception contexts the calling thread had before but_initialize or
+ * but_attach_thread installed the context's, even if the thread had none. Call it before
+ * the context goes out of scope, so no thread is left pointing at it.
+ *
+ * @param bctx a test context attached to the calling thread.
+ */
+#define BUT_DETACH_THREAD(name) void name(BUTContext *bctx)
+typedef BUT_DETACH_THREAD(but_detach_thread_fn);
+BUT_DETACH_THREAD(but_detach_thread);
+
 /**
  * @brief but_begin assigns a test suite to a test context.
  *
@@ -114,6 +184,28 @@ BUT_HAS_MORE(but_has_more);
 typedef BUT_GET_TEST_CASE_NAME(but_get_test_case_name_fn);
 BUT_GET_TEST_CASE_NAME(but_get_test_case_name);
 
+/**
+ * @brief retrieve the name of any test case of the suite.
+ *
+ * @param bctx a test context.
+ * @param index the index of a test case.
+ * @return the name of the test case, or NULL if the index is out of range.
+ */
+#define BUT_GET_CASE_NAME(name) char const *name(BUTContext *bctx, u32 index)
+typedef BUT_GET_CASE_NAME(but_get_case_name_fn);
+BUT_GET_CASE_NAME(but_get_case_name);
+
+/**
+ * @brief find a test case of the suite by its exact name, in constant time.
+ *
+ * @param bctx a test context.
+ * @param case_name the name of a test case.
+ * @return the index of the first case with the name, or BUT_CASE_NOT_FOUND.
+ */
+#define BUT_FIND_TEST_CASE(name) u32 name(BUTContext *bctx, char const *case_name)
+typedef BUT_FIND_TEST_CASE(but_find_test_case_fn);
+BUT_FIND_TEST_CASE(but_find_test_case);
+
 /**
  * @brief retrieve the index of the current test case.
  *
@@ -133,6 +225,44 @@ BUT_GET_INDEX(but_get_index);
 typedef BUT_DRIVER(but_driver_fn);
 BUT_DRIVER(but_driver);
 
+/**
+ * @brief a function but_run_range calls for each test case. The case is the context's
+ * current one.
+ *
+ * @param bctx a test context.
+ * @param data the data in the callbacks.
+ */
+#define BUT_CASE_CALLBACK(name) void name(BUTContext *bctx, void *data)
+typedef BUT_CASE_CALLBACK(but_case_callback_fn);
+
+/**
+ * @brief what but_run_range reports as it goes.
+ */
+typedef struct BUTRunCallbacks {
+    but_case_callback_fn *case_started;  ///< called before each case runs, or NULL
+    but_case_callback_fn *case_finished; ///< called after each case runs, or NULL
+    void                 *data;          ///< passed to each callback
+} BUTRunCallbacks;
+
+/**
+ * @brief but_run_range executes a span of test cases, as if by calling but_driver and
+ * but_next for each of them, but inside one try block. If a case's setup or cleanup
+ * fails, its case_finished callback is called and the exception is rethrown with the
+ * failed case still current. The rest of the span isn't run, and those cases have no
+ * results, so they read as passed; the caller can resume after the failed case by
+ * calling but_run_range again with first set to but_get_index plus one.
+ *
+ * @param bctx a test context.
+ * @param first the index of the first case to run. If it isn't less than end, no case
+ * runs.
+ * @param end the index after the last case to run. It's limited to the number of cases.
+ * @param callbacks the callbacks, or NULL.
+ */
+#define BUT_RUN_RANGE(name) \
+    void name(BUTContext *bctx, u32 first, u32 end, BUTRunCallbacks const *callbacks)
+typedef BUT_RUN_RANGE(but_run_range_fn);
+BUT_RUN_RANGE(but_run_range);
+
 /**
  * @brief retrieve the number of test cases executed.
  *
@@ -204,6 +334,57 @@ BUT_GET_RESULTS_COUNT(but_get_results_count);
 typedef BUT_GET_RESULT(but_get_result_fn);
 BUT_GET_RESULT(but_get_result);
 
+/**
+ * @brief retrieve the results recorded for a test case. A case that passed has none, and
+ * one that failed in more than one phase has a result for each.
+ *
+ * @param bctx a test context.
+ * @param index the index of a test case.
+ * @param count receives the number of results.
+ * @return the first of the case's results, or NULL if it has none.
+ */
+#define BUT_GET_CASE_RESULTS(name) \
+    ResultContext const *name(BUTContext *bctx, u32 index, u32 *count)
+typedef BUT_GET_CASE_RESULTS(but_get_case_results_fn);
+BUT_GET_CASE_RESULTS(but_get_case_results);
+
+/**
+ * @brief keep what the current test case printed with its first result, so it lasts
+ * until but_end. A case that passed has no results to keep it with.
+ *
+ * @param bctx a test context.
+ * @param output the captured output, or NULL.
+ * @return the kept copy of output, or NULL if it wasn't kept.
+ */
+#define BUT_KEEP_CASE_OUTPUT(name) char const *name(BUTContext *bctx, char const *output)
+typedef BUT_KEEP_CASE_OUTPUT(but_keep_case_output_fn);
+BUT_KEEP_CASE_OUTPUT(but_keep_case_output);
+
+/**
+ * @brief retrieve the measurements collected for a test case.
+ *
+ * @param bctx a test context.
+ * @param index the index of a test case.
+ * @return the measurements for the test case, or NULL if no measurement options are
+ * enabled or the index is out of range.
+ */
+#define BUT_GET_CASE_METRICS(name) \
+    BUTCaseMetrics const *name(BUTContext *bctx, u32 index)
+typedef BUT_GET_CASE_METRICS(but_get_case_metrics_fn);
+BUT_GET_CASE_METRICS(but_get_case_metrics);
+
+/**
+ * @brief retrieve how long each phase of a test case took. They're always measured.
+ *
+ * @param bctx a test context.
+ * @param index the index of a test case.
+ * @return the durations of the test case's phases, or NULL if the index is out of range
+ * or there wasn't memory to record them.
+ */
+#define BUT_GET_CASE_TIMES(name) BUTCaseTimes const *name(BUTContext *bctx, u32 index)
+typedef BUT_GET_CASE_TIMES(but_get_case_times_fn);
+BUT_GET_CASE_TIMES(but_get_case_times);
+
 #if defined(__cplusplus)
 }
 #endif
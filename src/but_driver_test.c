@@ -0,0 +1,355 @@
+/**
+ * @file but_driver_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests that run suites with the driver compiled into this library.
+ * @version 0.1
+ * @date 2025-10-01
+ *
+ * The tests in but_test.c drive but_test_data.dll, whose cases throw through this
+ * library's exception context rather than the data library's, so its driver never sees
+ * their failures. These tests run suites with this library's copy of the driver, so the
+ * failures are caught and recorded by but_driver, as they are in the test driver.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_arena.h"          // but_arena_alloc, BUT_ARENA_BLOCK_SIZE
+#include "but_case_table.h"     // but_case_table_free, BUT_CASE_NOT_FOUND
+#include "but_context.h"        // BUTContext
+#include "but_driver.h"         // but_initialize, but_begin, but_driver, etc.
+#include "but_result_context.h" // ResultContext
+#include "log.h"                // logger_get_context, logger_set_level
+
+#include <abbreviated_types.h> // u32
+#include <but.h>               // BUT_TEST, BUT_CASE_NAME, BUT_TEST_SUITE, etc.
+#include <but_assert.h>        // BUT_ASSERT_EQ_UINT32, BUT_ASSERT_NULL, etc.
+#include <but_macros.h>        // BUT_UNUSED
+#include <exception.h>         // BUT_TRY, BUT_CATCH_ALL, BUT_THROW, etc.
+#include <exception_types.h>   // BUT_DETAILS_RING
+
+#include <stdbool.h> // bool, true, false
+#include <stddef.h>  // NULL
+#include <stdlib.h>  // free
+
+static BUT_TEST_FN(driver_pass) {
+    BUT_UNUSED(btc);
+}
+
+static BUT_TEST_FN(driver_fail) {
+    BUT_UNUSED(btc);
+    BUT_THROW(but_test_exception);
+}
+
+static BUT_CLEANUP_FN(driver_fail_cleanup) {
+    BUT_UNUSED(btc);
+    BUT_THROW(but_invalid_value);
+}
+
+BUT_CASE_NAME("Pass", mixed_pass, driver_pass, NULL, NULL);
+BUT_CASE_NAME("Fail", mixed_fail, driver_fail, NULL, NULL);
+BUT_CASE_NAME("Fail Test and Cleanup", mixed_fail_twice, driver_fail, NULL,
+              driver_fail_cleanup);
+BUT_CASE_NAME("Pass Again", mixed_pass_again, driver_pass, NULL, NULL);
+
+BUT_SUITE_BEGIN(mixed)
+BUT_SUITE_ADD(mixed_pass)
+BUT_SUITE_ADD(mixed_fail)
+BUT_SUITE_ADD(mixed_fail_twice)
+BUT_SUITE_ADD(mixed_pass_again)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("Mixed Results", mixed);
+
+static BUT_TEST_FN(driver_fail_details) {
+    BUT_UNUSED(btc);
+    BUT_THROW_DETAILS(but_test_exception, "the details of case %d", 0);
+}
+
+// Throw and catch enough exceptions to reuse every details buffer.
+static BUT_TEST_FN(driver_reuse_details) {
+    BUT_UNUSED(btc);
+    for (int i = 0; i < BUT_DETAILS_RING; i++) {
+        BUT_TRY {
+            BUT_THROW_DETAILS(but_test_exception, "overwritten %d", i);
+        }
+        BUT_CATCH(but_test_exception) {
+            ; // Only the details matter.
+        }
+        BUT_END_TRY;
+    }
+}
+
+BUT_CASE_NAME("Fail With Details", arena_fail_details, driver_fail_details, NULL, NULL);
+BUT_CASE_NAME("Reuse Details", arena_reuse_details, driver_reuse_details, NULL, NULL);
+
+BUT_SUITE_BEGIN(arena)
+BUT_SUITE_ADD(arena_fail_details)
+BUT_SUITE_ADD(arena_reuse_details)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("Arena", arena);
+
+// Two cases share a name, as cases in a suite may.
+BUT_CASE_NAME("Pass", names_pass, driver_pass, NULL, NULL);
+BUT_CASE_NAME("Fail", names_fail, driver_fail, NULL, NULL);
+BUT_CASE_NAME("Pass", names_pass_twice, driver_pass, NULL, NULL);
+BUT_CASE_NAME("Other", names_other, driver_pass, NULL, NULL);
+
+BUT_SUITE_BEGIN(names)
+BUT_SUITE_ADD(names_pass)
+BUT_SUITE_ADD(names_fail)
+BUT_SUITE_ADD(names_pass_twice)
+BUT_SUITE_ADD(names_other)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("Names", names);
+
+// Run each case of a suite, catching the exceptions the driver rethrows after it
+// records a failed setup or cleanup. The driver logs each failure it records, and these
+// are expected, so logging is quieted while they run.
+static void run_each_case(BUTContext *bctx) {
+    log_level_t level = logger_get_context()->logger.min_level;
+
+    logger_set_level(LOG_FATAL);
+    while (but_has_more(bctx)) {
+        BUT_TRY {
+            but_driver(bctx);
+        }
+        BUT_CATCH_ALL {
+            ; // The driver recorded the failure.
+        }
+        BUT_END_TRY;
+        but_next(bctx);
+    }
+    logger_set_level(level);
+}
+
+// Count the cases but_run_range reports.
+typedef struct RangeCounts {
+    u32 started;
+    u32 finished;
+} RangeCounts;
+
+static BUT_CASE_CALLBACK(count_started) {
+    BUT_UNUSED(bctx);
+    ((RangeCounts *)data)->started++;
+}
+
+static BUT_CASE_CALLBACK(count_finished) {
+    BUT_UNUSED(bctx);
+    ((RangeCounts *)data)->finished++;
+}
+
+// Verify but_run_range runs nothing for an empty range and only its own cases for a
+// partial one, and that a failed cleanup stops the range at the failed case, leaving
+// the rest unrun until the range is resumed after it.
+BUT_TEST("Run Ranges", run_ranges) {
+    BUTContext      bctx;
+    RangeCounts     counts    = {0};
+    BUTRunCallbacks callbacks = {
+        .case_started  = count_started,
+        .case_finished = count_finished,
+        .data          = &counts,
+    };
+    log_level_t level   = logger_get_context()->logger.min_level;
+    bool        stopped = false;
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(mixed));
+    logger_set_level(LOG_FATAL);
+    BUT_TRY {
+        // A range that's empty, starts after it ends, or starts past the suite is empty,
+        // and leaves the index no further than the end of the suite.
+        but_run_range(&bctx, 2, 2, &callbacks);
+        but_run_range(&bctx, 3, 1, &callbacks);
+        but_run_range(&bctx, 4, 100, &callbacks);
+        but_run_range(&bctx, 100, 200, &callbacks);
+        BUT_ASSERT_EQ_UINT32(but_get_index(&bctx), bctx.env.test_case_count);
+        BUT_ASSERT_EQ_UINT32(counts.started, 0);
+        BUT_ASSERT_EQ_UINT32(counts.finished, 0);
+        BUT_ASSERT_EQ_UINT32(but_get_run_count(&bctx), 0);
+
+        // A partial range runs only its own cases.
+        but_run_range(&bctx, 0, 2, &callbacks);
+        BUT_ASSERT_EQ_UINT32(counts.started, 2);
+        BUT_ASSERT_EQ_UINT32(counts.finished, 2);
+        BUT_ASSERT_EQ_UINT32(but_get_run_count(&bctx), 2);
+        BUT_ASSERT_EQ_UINT32(but_get_results_count(&bctx), 1);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 1) == BUT_FAILED);
+
+        // The third case's cleanup fails, which stops the range with it current. The
+        // fourth case hasn't run.
+        BUT_TRY {
+            but_run_range(&bctx, 2, 100, &callbacks);
+        }
+        BUT_CATCH(but_invalid_value) {
+            stopped = true;
+        }
+        BUT_END_TRY;
+        BUT_ASSERT_TRUE(stopped);
+        BUT_ASSERT_EQ_UINT32(but_get_index(&bctx), 2);
+        BUT_ASSERT_EQ_UINT32(counts.started, 3);
+        BUT_ASSERT_EQ_UINT32(counts.finished, 3);
+        BUT_ASSERT_EQ_UINT32(but_get_run_count(&bctx), 3);
+        BUT_ASSERT_EQ_UINT32(but_get_results_count(&bctx), 3);
+
+        // Resume after the failed case.
+        but_run_range(&bctx, but_get_index(&bctx) + 1, 100, &callbacks);
+        BUT_ASSERT_EQ_UINT32(counts.started, 4);
+        BUT_ASSERT_EQ_UINT32(counts.finished, 4);
+        BUT_ASSERT_EQ_UINT32(but_get_run_count(&bctx), 4);
+        BUT_ASSERT_EQ_UINT32(but_get_results_count(&bctx), 3);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 3) == BUT_PASSED);
+    }
+    BUT_FINALLY {
+        logger_set_level(level);
+        but_end(&bctx);
+    }
+    BUT_END_TRY;
+}
+
+// Verify cases are found by their exact names, a name shared by two cases finds the
+// first, and names are read by index, both from the case table and, when it couldn't be
+// built, from the suite.
+BUT_TEST("Find Cases by Name", case_names) {
+    BUTContext bctx;
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(names));
+    BUT_TRY {
+        BUT_ASSERT_EQ_UINT32(bctx.env.cases.count, 4);
+        for (int pass = 0; pass < 2; pass++) {
+            BUT_ASSERT_EQ_UINT32(but_find_test_case(&bctx, "Pass"), 0);
+            BUT_ASSERT_EQ_UINT32(but_find_test_case(&bctx, "Fail"), 1);
+            BUT_ASSERT_EQ_UINT32(but_find_test_case(&bctx, "Other"), 3);
+            BUT_ASSERT_TRUE(but_find_test_case(&bctx, "Missing") == BUT_CASE_NOT_FOUND);
+            BUT_ASSERT_TRUE(but_find_test_case(&bctx, "pass") == BUT_CASE_NOT_FOUND);
+            BUT_ASSERT_TRUE(but_find_test_case(&bctx, "") == BUT_CASE_NOT_FOUND);
+
+            BUT_ASSERT_STREQ(but_get_case_name(&bctx, 0), "Pass");
+            BUT_ASSERT_STREQ(but_get_case_name(&bctx, 1), "Fail");
+            BUT_ASSERT_STREQ(but_get_case_name(&bctx, 2), "Pass");
+            BUT_ASSERT_STREQ(but_get_case_name(&bctx, 3), "Other");
+            BUT_ASSERT_NULL(but_get_case_name(&bctx, 4));
+
+            // Repeat without the table, as if it couldn't be built.
+            but_case_table_free(&bctx.env.cases);
+        }
+    }
+    BUT_FINALLY {
+        but_end(&bctx);
+    }
+    BUT_END_TRY;
+}
+
+// Verify the status and results of each case of a suite that mixes passing cases, a
+// failed test, and a case whose test and cleanup both fail.
+BUT_TEST("Mixed Results", mixed_results) {
+    BUTContext           bctx;
+    ResultContext const *results;
+    u32                  count;
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(mixed));
+    BUT_TRY {
+        run_each_case(&bctx);
+        BUT_ASSERT_EQ_UINT32(but_get_results_count(&bctx), 3);
+        BUT_ASSERT_EQ_UINT32(but_get_test_failure_count(&bctx), 2);
+        BUT_ASSERT_EQ_UINT32(but_get_cleanup_failure_count(&bctx), 1);
+
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 0) == BUT_PASSED);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 1) == BUT_FAILED);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 2) == BUT_FAILED);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 3) == BUT_PASSED);
+
+        results = but_get_case_results(&bctx, 0, &count);
+        BUT_ASSERT_NULL(results);
+        BUT_ASSERT_EQ_UINT32(count, 0);
+
+        results = but_get_case_results(&bctx, 1, &count);
+        BUT_ASSERT_NOT_NULL(results);
+        BUT_ASSERT_EQ_UINT32(count, 1);
+        BUT_ASSERT_EQ_UINT32(results[0].index, 1);
+        BUT_ASSERT_STREQ(results[0].reason, but_test_exception);
+
+        results = but_get_case_results(&bctx, 2, &count);
+        BUT_ASSERT_NOT_NULL(results);
+        BUT_ASSERT_EQ_UINT32(count, 2);
+        BUT_ASSERT_TRUE(results[0].status == BUT_FAILED);
+        BUT_ASSERT_STREQ(results[0].reason, but_test_exception);
+        BUT_ASSERT_TRUE(results[1].status == BUT_FAILED_CLEANUP);
+        BUT_ASSERT_STREQ(results[1].reason, but_invalid_value);
+
+        results = but_get_case_results(&bctx, 3, &count);
+        BUT_ASSERT_NULL(results);
+        BUT_ASSERT_EQ_UINT32(count, 0);
+
+        // An index past the end of the suite has no results.
+        results = but_get_case_results(&bctx, 4, &count);
+        BUT_ASSERT_NULL(results);
+        BUT_ASSERT_TRUE(but_get_result(&bctx, 4) == BUT_PASSED);
+
+        // Without the index of first results, the lookups search the results.
+        free(bctx.env.first_results);
+        bctx.env.first_results = NULL;
+        results                = but_get_case_results(&bctx, 2, &count);
+        BUT_ASSERT_NOT_NULL(results);
+        BUT_ASSERT_EQ_UINT32(count, 2);
+        BUT_ASSERT_EQ_UINT32(results[0].index, 2);
+        results = but_get_case_results(&bctx, 3, &count);
+        BUT_ASSERT_NULL(results);
+    }
+    BUT_FINALLY {
+        but_end(&bctx);
+    }
+    BUT_END_TRY;
+}
+
+// Verify a result's details and kept output are copies that outlive the exception
+// buffers and the caller's output, stay put as the arena grows, and are released by
+// but_end.
+BUT_TEST("Details and Output Outlive Exceptions", arena_results) {
+    BUTContext           bctx;
+    ResultContext const *results;
+    u32                  count;
+    char                 output[] = "the output of case 0";
+    char const          *kept;
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(arena));
+    BUT_TRY {
+        run_each_case(&bctx);
+
+        bctx.env.index = 0;
+        kept           = but_keep_case_output(&bctx, output);
+        output[0]      = '\0';
+        BUT_ASSERT_NOT_NULL(kept);
+
+        // The second case reused every details buffer after the first case's throw.
+        results = but_get_case_results(&bctx, 0, &count);
+        BUT_ASSERT_EQ_UINT32(count, 1);
+        BUT_ASSERT_STREQ(results[0].details, "the details of case 0");
+        BUT_ASSERT_STREQ(results[0].output, "the output of case 0");
+
+        // A case without results has nowhere to keep its output.
+        bctx.env.index = 1;
+        BUT_ASSERT_NULL(but_keep_case_output(&bctx, output));
+
+        // Fill several blocks; nothing already in the arena moves.
+        for (int i = 0; i < 64; i++) {
+            BUT_ASSERT_NOT_NULL(but_arena_alloc(&bctx.env.arena, 256));
+        }
+        BUT_ASSERT_NOT_NULL(bctx.env.arena.blocks);
+        BUT_ASSERT_TRUE(bctx.env.arena.size > BUT_ARENA_BLOCK_SIZE);
+        BUT_ASSERT_STREQ(results[0].details, "the details of case 0");
+        BUT_ASSERT_STREQ(results[0].output, "the output of case 0");
+    }
+    BUT_FINALLY {
+        but_end(&bctx);
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT_NULL(bctx.env.arena.blocks);
+    BUT_ASSERT_TRUE(bctx.env.arena.used == 0 && bctx.env.arena.size == 0);
+    BUT_ASSERT_NULL(bctx.env.results);
+    BUT_ASSERT_NULL(bctx.env.first_results);
+}
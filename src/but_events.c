@@ -0,0 +1,236 @@
+/**
+ * @file but_events.c
+ * @author Douglas Cuthbertson
+ * @brief A stream of JSON events, one per line, that tools can follow as a run goes.
+ * @version 0.1
+ * @date 2025-09-28
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_events.h"
+#include "but_driver.h"         // but_get_case_results, but_get_index, etc.
+#include "but_result_context.h" // ResultContext
+#include "but_results.h"        // but_results_status_name
+#include "but_timer.h"          // but_timer_now, but_timer_frequency, etc.
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdarg.h>  // va_list, va_start, va_end
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, _fdopen, fwrite, fclose, setvbuf, vsnprintf
+#include <stdlib.h>  // free, malloc
+#include <string.h>  // memset, strnlen
+
+#define BUT_EVENTS_LINE_MAX 8192 ///< the room an event needs in the buffer
+#define BUT_EVENTS_TEXT_MAX 256  ///< the longest string written in an event
+#define BUT_EVENTS_RATE     10   ///< the most writes each second while cases run
+
+// Take ownership of a stream that was opened.
+static bool start(BUTEvents *events, FILE *out) {
+    events->buffer = malloc(BUT_EVENTS_BUFFER_SIZE);
+    if (events->buffer == NULL) {
+        fclose(out);
+        return false;
+    }
+
+    // The stream has its own buffer, so each write goes straight to the file.
+    setvbuf(out, NULL, _IONBF, 0);
+    events->out        = out;
+    events->used       = 0;
+    events->origin     = but_timer_now();
+    events->flushed_at = events->origin;
+    events->interval   = but_timer_frequency() / BUT_EVENTS_RATE;
+    return true;
+}
+
+bool but_events_open(BUTEvents *events, char const *path) {
+    FILE *out;
+
+    memset(events, 0, sizeof *events);
+    if (fopen_s(&out, path, "wb") != 0) {
+        return false;
+    }
+
+    return start(events, out);
+}
+
+bool but_events_open_fd(BUTEvents *events, int fd) {
+    FILE *out;
+
+    memset(events, 0, sizeof *events);
+    out = _fdopen(fd, "wb");
+    if (out == NULL) {
+        return false;
+    }
+
+    return start(events, out);
+}
+
+// Write the events in the buffer.
+static void flush(BUTEvents *events, u64 now) {
+    if (events->used > 0) {
+        fwrite(events->buffer, 1, events->used, events->out);
+        events->used = 0;
+    }
+    events->flushed_at = now;
+}
+
+void but_events_close(BUTEvents *events) {
+    if (events->out != NULL) {
+        flush(events, but_timer_now());
+        fclose(events->out);
+    }
+    free(events->buffer);
+    memset(events, 0, sizeof *events);
+}
+
+// Append formatted text to the event being written. It's truncated if the line is full.
+static void append(BUTEvents *events, char const *format, ...) {
+    size_t  room = BUT_EVENTS_BUFFER_SIZE - events->used;
+    va_list args;
+    int     length;
+
+    va_start(args, format);
+    length = vsnprintf(events->buffer + events->used, room, format, args);
+    va_end(args);
+    if (length > 0) {
+        events->used += (size_t)length < room ? (size_t)length : room - 1;
+    }
+}
+
+// Append a string member, escaped and truncated to BUT_EVENTS_TEXT_MAX bytes. A NULL
+// string is left out.
+static void append_text(BUTEvents *events, char const *key, char const *text) {
+    char  *out;
+    size_t length;
+
+    if (text == NULL) {
+        return;
+    }
+
+    // Cut before a UTF-8 character that straddles the limit rather than in the middle of
+    // it, which would leave the line invalid UTF-8. A character has at most 3
+    // continuation bytes.
+    length = strnlen(text, BUT_EVENTS_TEXT_MAX + 1);
+    if (length > BUT_EVENTS_TEXT_MAX) {
+        length = BUT_EVENTS_TEXT_MAX;
+        for (int i = 0; i < 3 && ((unsigned char)text[length] & 0xc0) == 0x80; i++) {
+            length--;
+        }
+    }
+
+    append(events, ",\"%s\":\"", key);
+    out = events->buffer + events->used;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+
+        if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = (char)c;
+        } else if (c < 0x20) {
+            out += snprintf(out, 7, "\\u%04x", c);
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    *out++       = '"';
+    events->used = (size_t)(out - events->buffer);
+}
+
+// Start an event, writing the buffer first if there might not be room for it.
+static void begin_event(BUTEvents *events, char const *name, u64 now) {
+    if (events->used + BUT_EVENTS_LINE_MAX > BUT_EVENTS_BUFFER_SIZE) {
+        flush(events, now);
+    }
+    append(events, "{\"event\":\"%s\",\"time_ms\":%.3f", name,
+           (double)but_timer_ticks_to_ns(now - events->origin) / 1e6);
+}
+
+static void end_event(BUTEvents *events) {
+    append(events, "}\n");
+}
+
+void but_events_run_started(BUTEvents *events, int suites) {
+    if (events->out != NULL) {
+        u64 now = but_timer_now();
+
+        begin_event(events, "run_started", now);
+        append(events, ",\"suites\":%d", suites);
+        end_event(events);
+        flush(events, now);
+    }
+}
+
+void but_events_suite_loaded(BUTEvents *events, BUTTestSuite const *bts,
+                             char const *path) {
+    if (events->out != NULL) {
+        begin_event(events, "suite_loaded", but_timer_now());
+        append_text(events, "suite", bts->name);
+        append_text(events, "path", path);
+        append(events, ",\"cases\":%u", bts->count);
+        end_event(events);
+    }
+}
+
+void but_events_case_started(BUTEvents *events, BUTContext *bctx) {
+    if (events->out != NULL) {
+        begin_event(events, "case_started", but_timer_now());
+        append_text(events, "suite", bctx->env.bts->name);
+        append_text(events, "case", but_get_test_case_name(bctx));
+        append(events, ",\"index\":%u", but_get_index(bctx));
+        end_event(events);
+    }
+}
+
+void but_events_case_finished(BUTEvents *events, BUTContext *bctx, u64 duration_ns) {
+    if (events->out != NULL) {
+        u64                  now   = but_timer_now();
+        u32                  index = but_get_index(bctx);
+        u32                  count;
+        ResultContext const *result = but_get_case_results(bctx, index, &count);
+
+        begin_event(events, "case_finished", now);
+        append_text(events, "suite", bctx->env.bts->name);
+        append_text(events, "case", but_get_test_case_name(bctx));
+        append(events, ",\"index\":%u", index);
+        append_text(events, "status",
+                    but_results_status_name(but_get_result(bctx, index)));
+        if (result != NULL) {
+            append_text(events, "reason", result->reason);
+            append_text(events, "file", result->file);
+            append(events, ",\"line\":%d", result->line);
+        }
+        append(events, ",\"duration_ms\":%.3f", (double)duration_ns / 1e6);
+        end_event(events);
+
+        if (now - events->flushed_at >= events->interval) {
+            flush(events, now);
+        }
+    }
+}
+
+void but_events_suite_finished(BUTEvents *events, BUTContext *bctx) {
+    if (events->out != NULL) {
+        u64 now = but_timer_now();
+
+        begin_event(events, "suite_finished", now);
+        append_text(events, "suite", bctx->env.bts->name);
+        append(events, ",\"run\":%u,\"passed\":%u", but_get_run_count(bctx),
+               but_get_pass_count(bctx));
+        end_event(events);
+        flush(events, now);
+    }
+}
+
+void but_events_run_finished(BUTEvents *events, int suites) {
+    if (events->out != NULL) {
+        u64 now = but_timer_now();
+
+        begin_event(events, "run_finished", now);
+        append(events, ",\"suites\":%d", suites);
+        end_event(events);
+        flush(events, now);
+    }
+}
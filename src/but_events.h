@@ -0,0 +1,137 @@
+#ifndef BUT_EVENTS_H_
+#define BUT_EVENTS_H_
+
+/**
+ * @file but_events.h
+ * @author Douglas Cuthbertson
+ * @brief A stream of JSON events, one per line, that tools can follow as a run goes.
+ * @version 0.1
+ * @date 2025-09-28
+ *
+ * Every event is an object with an "event" name and a "time_ms" since the run started:
+ *
+ *     {"event":"run_started","time_ms":0.000,"suites":2}
+ *     {"event":"suite_loaded","time_ms":1.250,"suite":"...","path":"...","cases":12}
+ *     {"event":"case_started","time_ms":1.300,"suite":"...","case":"...","index":0}
+ *     {"event":"case_finished","time_ms":1.420,"suite":"...","case":"...","index":0,
+ *      "status":"failed","reason":"...","file":"...","line":42,"duration_ms":0.120}
+ *     {"event":"suite_finished","time_ms":2.000,"suite":"...","run":12,"passed":11}
+ *     {"event":"run_finished","time_ms":2.100,"suites":2}
+ *
+ * Events are formatted into a buffer owned by the stream and written a buffer at a time,
+ * at most ten times a second while cases are running and at the end of every suite, so
+ * following a run costs a few hundred nanoseconds per case and no lock per event. A
+ * worker that runs cases in parallel with others would own a stream of its own, and
+ * each write of whole lines is a single call.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdio.h>   // FILE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_EVENTS_BUFFER_SIZE (64 * 1024) ///< the size of a stream's buffer
+
+/**
+ * @brief a stream of events.
+ */
+typedef struct BUTEvents {
+    FILE  *out;        ///< where events are written, or NULL if they aren't
+    char  *buffer;     ///< events that haven't been written yet
+    size_t used;       ///< the number of bytes in buffer
+    u64    origin;     ///< when the run started, in ticks
+    u64    flushed_at; ///< when buffer was last written, in ticks
+    u64    interval;   ///< the fewest ticks between writes while cases are running
+} BUTEvents;
+
+/**
+ * @brief start a stream of events on a file.
+ *
+ * @param events the stream.
+ * @param path the file, which may be a named pipe.
+ * @return true if the file was opened, and false otherwise.
+ */
+bool but_events_open(BUTEvents *events, char const *path);
+
+/**
+ * @brief start a stream of events on a file descriptor the driver inherited.
+ *
+ * @param events the stream.
+ * @param fd the file descriptor.
+ * @return true if the descriptor is open, and false otherwise.
+ */
+bool but_events_open_fd(BUTEvents *events, int fd);
+
+/**
+ * @brief write the events that are buffered, and close the stream.
+ *
+ * @param events the stream.
+ */
+void but_events_close(BUTEvents *events);
+
+/**
+ * @brief report the start of a run.
+ *
+ * @param events the stream.
+ * @param suites the number of test suites to be run.
+ */
+void but_events_run_started(BUTEvents *events, int suites);
+
+/**
+ * @brief report a test suite that was loaded.
+ *
+ * @param events the stream.
+ * @param bts the test suite.
+ * @param path the file it was loaded from.
+ */
+void but_events_suite_loaded(BUTEvents *events, BUTTestSuite const *bts,
+                             char const *path);
+
+/**
+ * @brief report the test case a context is about to run.
+ *
+ * @param events the stream.
+ * @param bctx the test context.
+ */
+void but_events_case_started(BUTEvents *events, BUTContext *bctx);
+
+/**
+ * @brief report the result of the test case a context ran.
+ *
+ * @param events the stream.
+ * @param bctx the test context.
+ * @param duration_ns how long the case took.
+ */
+void but_events_case_finished(BUTEvents *events, BUTContext *bctx, u64 duration_ns);
+
+/**
+ * @brief report the end of a test suite, and write the events that are buffered.
+ *
+ * @param events the stream.
+ * @param bctx the test context that ran the suite.
+ */
+void but_events_suite_finished(BUTEvents *events, BUTContext *bctx);
+
+/**
+ * @brief report the end of a run, and write the events that are buffered.
+ *
+ * @param events the stream.
+ * @param suites the number of test suites that were run.
+ */
+void but_events_run_finished(BUTEvents *events, int suites);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_EVENTS_H_
@@ -0,0 +1,140 @@
+/**
+ * @file but_events_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the stream of JSON events.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The test runs a suite with the driver compiled into this library, reports its events
+ * to a file in the current directory, and reads them back. The times in the events vary
+ * from run to run, so it checks what follows them.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext
+#include "but_driver.h"  // but_initialize, but_begin, but_driver, etc.
+#include "but_events.h"  // but_events_open, but_events_case_finished, etc.
+#include "log.h"         // logger_get_context, logger_set_level
+
+#include <but.h>        // BUT_TEST_SETUP_CLEANUP, BUT_CASE_NAME, BUT_TEST_SUITE, etc.
+#include <but_assert.h> // BUT_ASSERT_TRUE, BUT_ASSERT_NOT_NULL
+#include <but_macros.h> // BUT_UNUSED
+#include <exception.h>  // BUT_TRY, BUT_CATCH_ALL, BUT_THROW, etc.
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, fread, fclose, remove, snprintf
+#include <string.h>  // memcpy, memset, strncmp, strstr
+
+#define EVENTS_TEST_PATH "but_butts_events.json"
+
+static BUT_TEST_FN(events_pass) {
+    BUT_UNUSED(btc);
+}
+
+static BUT_TEST_FN(events_fail) {
+    BUT_UNUSED(btc);
+    BUT_THROW(but_test_exception);
+}
+
+BUT_CASE_NAME("Pass", events_passed, events_pass, NULL, NULL);
+BUT_CASE_NAME("Fail", events_failed, events_fail, NULL, NULL);
+// Renamed when the test runs.
+BUT_CASE_NAME("Long", events_long, events_pass, NULL, NULL);
+
+BUT_SUITE_BEGIN(events)
+BUT_SUITE_ADD(events_passed)
+BUT_SUITE_ADD(events_failed)
+BUT_SUITE_ADD(events_long)
+BUT_SUITE_END;
+
+// A quote, a backslash, and a control character, which must be escaped in JSON.
+BUT_TEST_SUITE("Events \"quoted\" \\ \x01", events);
+
+// 255 bytes of ASCII followed by a 2-byte character, which straddles the 256-byte limit.
+static char g_long_name_[300];
+
+static BUT_SETUP_FN(set_up_events) {
+    BUT_UNUSED(btc);
+    remove(EVENTS_TEST_PATH);
+}
+
+static BUT_CLEANUP_FN(cleanup_events) {
+    BUT_UNUSED(btc);
+    remove(EVENTS_TEST_PATH);
+}
+
+// Report a run of the suite.
+static bool write_events(void) {
+    BUTContext  bctx;
+    BUTEvents   events;
+    log_level_t level = logger_get_context()->logger.min_level;
+
+    if (!but_events_open(&events, EVENTS_TEST_PATH)) {
+        return false;
+    }
+
+    but_events_run_started(&events, 1);
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(events));
+    but_events_suite_loaded(&events, &BUT_TEST_SUITE_NAME(events), "events.dll");
+    logger_set_level(LOG_FATAL);
+    while (but_has_more(&bctx)) {
+        but_events_case_started(&events, &bctx);
+        BUT_TRY {
+            but_driver(&bctx);
+        }
+        BUT_CATCH_ALL {
+            ; // The driver recorded the failure.
+        }
+        BUT_END_TRY;
+        but_events_case_finished(&events, &bctx, 2000000);
+        but_next(&bctx);
+    }
+    logger_set_level(level);
+    but_events_suite_finished(&events, &bctx);
+    but_end(&bctx);
+    but_events_run_finished(&events, 1);
+    but_events_close(&events);
+
+    return true;
+}
+
+// Verify each event's line, the escaping of its strings, and that a long string is cut
+// before a character that straddles the limit.
+BUT_TEST_SETUP_CLEANUP("Event Stream", events_stream, set_up_events, cleanup_events) {
+    static char const suite[] = "\"suite\":\"Events \\\"quoted\\\" \\\\ \\u0001\"";
+    char              expected[512];
+    char              report[8192];
+    FILE             *in = NULL;
+    size_t            length;
+
+    memset(g_long_name_, 'a', 255);
+    memcpy(&g_long_name_[255], "\xc3\xa9", 3);
+    events_long_case.name = g_long_name_;
+
+    BUT_ASSERT_TRUE(write_events());
+    BUT_ASSERT_TRUE(fopen_s(&in, EVENTS_TEST_PATH, "rb") == 0);
+    length         = fread(report, 1, sizeof report - 1, in);
+    report[length] = '\0';
+    fclose(in);
+
+    BUT_ASSERT_TRUE(strncmp(report, "{\"event\":\"run_started\",\"time_ms\":", 33) == 0);
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"suites\":1}\n{\"event\":\"suite_loaded\","));
+    BUT_ASSERT_NOT_NULL(strstr(report, suite));
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"path\":\"events.dll\",\"cases\":3}\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"case\":\"Pass\",\"index\":0}\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"case\":\"Pass\",\"index\":0,"
+                                       "\"status\":\"passed\","
+                                       "\"duration_ms\":2.000}\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"case\":\"Fail\",\"index\":1,"
+                                       "\"status\":\"failed\","
+                                       "\"reason\":\"test exception\",\"file\":\""));
+    BUT_ASSERT_NOT_NULL(strstr(report, ",\"run\":3,\"passed\":2}\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "{\"event\":\"run_finished\",\"time_ms\":"));
+    BUT_ASSERT_TRUE(length > 0 && report[length - 1] == '\n');
+
+    // The 2-byte character is left out whole.
+    snprintf(expected, sizeof expected, ",\"case\":\"%.255s\",\"index\":2,",
+             g_long_name_);
+    BUT_ASSERT_NOT_NULL(strstr(report, expected));
+}
@@ -0,0 +1,144 @@
+/**
+ * @file but_junit.c
+ * @author Douglas Cuthbertson
+ * @brief A JUnit XML report of a test run.
+ * @version 0.1
+ * @date 2025-09-24
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_junit.h"
+#include "but_driver.h"         // but_get_case_results, but_get_index, etc.
+#include "but_result_context.h" // ResultContext
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, fprintf, fputs, fputc, fflush, fclose
+
+// Write text with the characters XML reserves escaped. Control characters that XML 1.0
+// doesn't allow are replaced.
+static void write_xml_text(FILE *out, char const *text) {
+    for (; *text != '\0'; text++) {
+        unsigned char c = (unsigned char)*text;
+
+        switch (c) {
+        case '&':
+            fputs("&amp;", out);
+            break;
+        case '<':
+            fputs("&lt;", out);
+            break;
+        case '>':
+            fputs("&gt;", out);
+            break;
+        case '"':
+            fputs("&quot;", out);
+            break;
+        case '\'':
+            fputs("&apos;", out);
+            break;
+        default:
+            fputc(c < 0x20 && c != '\t' && c != '\n' && c != '\r' ? '?' : c, out);
+            break;
+        }
+    }
+}
+
+bool but_junit_open(BUTJUnit *junit, char const *path) {
+    junit->suite_open = false;
+    if (fopen_s(&junit->out, path, "w") != 0) {
+        junit->out = NULL;
+        return false;
+    }
+
+    fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", junit->out);
+    fflush(junit->out);
+    return true;
+}
+
+void but_junit_close(BUTJUnit *junit) {
+    if (junit->out != NULL) {
+        but_junit_end_suite(junit);
+        fputs("</testsuites>\n", junit->out);
+        fclose(junit->out);
+        junit->out = NULL;
+    }
+}
+
+void but_junit_begin_suite(BUTJUnit *junit, BUTTestSuite const *bts) {
+    if (junit->out != NULL) {
+        fputs("  <testsuite name=\"", junit->out);
+        write_xml_text(junit->out, bts->name);
+        fprintf(junit->out, "\" tests=\"%u\">\n", bts->count);
+        fflush(junit->out);
+        junit->suite_open = true;
+    }
+}
+
+// Write one result as a failure, if the test function failed, or an error, if its setup
+// or cleanup did.
+static void write_result(FILE *out, ResultContext const *result) {
+    char const *element = result->status == BUT_FAILED ? "failure" : "error";
+    char const *type    = result->status == BUT_FAILED_SETUP     ? "setup"
+                          : result->status == BUT_FAILED_CLEANUP ? "cleanup"
+                                                                 : "test";
+
+    fprintf(out, "      <%s type=\"%s\" message=\"", element, type);
+    write_xml_text(out, result->reason != NULL ? result->reason : "");
+    fputs("\">", out);
+    if (result->details != NULL) {
+        write_xml_text(out, result->details);
+        fputc('\n', out);
+    }
+    if (result->file != NULL) {
+        fputs("at ", out);
+        write_xml_text(out, result->file);
+        fprintf(out, ":%d", result->line);
+    }
+    fprintf(out, "</%s>\n", element);
+}
+
+void but_junit_write_case(BUTJUnit *junit, BUTContext *bctx, u64 duration_ns,
+                          char const *output) {
+    FILE                *out;
+    ResultContext const *results;
+    u32                  count;
+
+    if (junit->out == NULL) {
+        return;
+    }
+
+    out     = junit->out;
+    results = but_get_case_results(bctx, but_get_index(bctx), &count);
+    fputs("    <testcase classname=\"", out);
+    write_xml_text(out, bctx->env.bts->name);
+    fputs("\" name=\"", out);
+    write_xml_text(out, but_get_test_case_name(bctx));
+    fprintf(out, "\" time=\"%.6f\"", (double)duration_ns / 1e9);
+    if (count == 0 && output == NULL) {
+        fputs("/>\n", out);
+    } else {
+        fputs(">\n", out);
+        for (u32 i = 0; i < count; i++) {
+            write_result(out, &results[i]);
+        }
+        if (output != NULL) {
+            fputs("      <system-out>", out);
+            write_xml_text(out, output);
+            fputs("</system-out>\n", out);
+        }
+        fputs("    </testcase>\n", out);
+    }
+    fflush(out);
+}
+
+void but_junit_end_suite(BUTJUnit *junit) {
+    if (junit->out != NULL && junit->suite_open) {
+        fputs("  </testsuite>\n", junit->out);
+        fflush(junit->out);
+        junit->suite_open = false;
+    }
+}
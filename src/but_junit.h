@@ -0,0 +1,87 @@
+#ifndef BUT_JUNIT_H_
+#define BUT_JUNIT_H_
+
+/**
+ * @file but_junit.h
+ * @author Douglas Cuthbertson
+ * @brief A JUnit XML report of a test run.
+ * @version 0.1
+ * @date 2025-09-24
+ *
+ * The report is written as the run progresses: each test case as soon as it finishes,
+ * and each suite's closing tag when the suite ends. Nothing is kept in memory, and the
+ * stream is flushed after each case, so a run that crashes leaves a report of every case
+ * that finished, missing only its closing tags.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext
+
+#include <abbreviated_types.h> // u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief a JUnit report being written.
+ */
+typedef struct BUTJUnit {
+    FILE *out;        ///< the report, or NULL
+    bool  suite_open; ///< true between the start and end of a suite
+} BUTJUnit;
+
+/**
+ * @brief create a report and write its opening tags.
+ *
+ * @param junit the report.
+ * @param path the file to write.
+ * @return true if the file was created, and false otherwise.
+ */
+bool but_junit_open(BUTJUnit *junit, char const *path);
+
+/**
+ * @brief write the closing tags of a report, including those of a suite that was
+ * interrupted, and close it.
+ *
+ * @param junit a report created by but_junit_open.
+ */
+void but_junit_close(BUTJUnit *junit);
+
+/**
+ * @brief start the test suite a context is about to run.
+ *
+ * @param junit a report created by but_junit_open.
+ * @param bts the test suite.
+ */
+void but_junit_begin_suite(BUTJUnit *junit, BUTTestSuite const *bts);
+
+/**
+ * @brief write the current test case of a context, after but_driver runs it.
+ *
+ * @param junit a report created by but_junit_open.
+ * @param bctx the test context.
+ * @param duration_ns how long the case took from the start of its setup through the end
+ * of its cleanup.
+ * @param output what the case printed, or NULL if it wasn't captured.
+ */
+void but_junit_write_case(BUTJUnit *junit, BUTContext *bctx, u64 duration_ns,
+                          char const *output);
+
+/**
+ * @brief end the current test suite.
+ *
+ * @param junit a report created by but_junit_open.
+ */
+void but_junit_end_suite(BUTJUnit *junit);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_JUNIT_H_
@@ -0,0 +1,140 @@
+/**
+ * @file but_junit_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the JUnit XML report.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The test runs a suite with the driver compiled into this library, writes a report of
+ * it to a file in the current directory, and reads the report back.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext
+#include "but_driver.h"  // but_initialize, but_begin, but_driver, etc.
+#include "but_junit.h"   // but_junit_open, but_junit_write_case, etc.
+#include "log.h"         // logger_get_context, logger_set_level
+
+#include <but.h>        // BUT_TEST_SETUP_CLEANUP, BUT_CASE_NAME, BUT_TEST_SUITE, etc.
+#include <but_assert.h> // BUT_ASSERT_TRUE, BUT_ASSERT_NOT_NULL
+#include <but_macros.h> // BUT_UNUSED
+#include <exception.h>  // BUT_TRY, BUT_CATCH_ALL, BUT_THROW, etc.
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, fread, fclose, remove
+#include <string.h>  // strlen, strncmp, strstr
+
+#define JUNIT_TEST_PATH "but_butts_junit.xml"
+
+static BUT_TEST_FN(junit_pass) {
+    BUT_UNUSED(btc);
+}
+
+// Details with a control character XML 1.0 doesn't allow, and characters it reserves.
+static BUT_TEST_FN(junit_fail) {
+    BUT_UNUSED(btc);
+    BUT_THROW_DETAILS(but_test_exception, "bad\x01value <%d>", 1);
+}
+
+static BUT_SETUP_FN(junit_fail_setup) {
+    BUT_UNUSED(btc);
+    BUT_THROW(but_invalid_value);
+}
+
+BUT_CASE_NAME("Pass & <Escape> \"quoted\" 'single'", junit_escape, junit_pass, NULL,
+              NULL);
+BUT_CASE_NAME("Fail", junit_failure, junit_fail, NULL, NULL);
+BUT_CASE_NAME("Fail Setup", junit_error, junit_pass, junit_fail_setup, NULL);
+BUT_CASE_NAME("Print", junit_output, junit_pass, NULL, NULL);
+
+BUT_SUITE_BEGIN(junit)
+BUT_SUITE_ADD(junit_escape)
+BUT_SUITE_ADD(junit_failure)
+BUT_SUITE_ADD(junit_error)
+BUT_SUITE_ADD(junit_output)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("JUnit & Report", junit);
+
+static BUT_SETUP_FN(set_up_junit) {
+    BUT_UNUSED(btc);
+    remove(JUNIT_TEST_PATH);
+}
+
+static BUT_CLEANUP_FN(cleanup_junit) {
+    BUT_UNUSED(btc);
+    remove(JUNIT_TEST_PATH);
+}
+
+// Run the suite and report each case, taking 1 ms each, the last with some output.
+static bool write_junit_report(void) {
+    static char const output[] = "said \"hi\"\x02\n";
+    BUTContext        bctx;
+    BUTJUnit          junit;
+    log_level_t       level = logger_get_context()->logger.min_level;
+
+    if (!but_junit_open(&junit, JUNIT_TEST_PATH)) {
+        return false;
+    }
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(junit));
+    but_junit_begin_suite(&junit, &BUT_TEST_SUITE_NAME(junit));
+    logger_set_level(LOG_FATAL);
+    while (but_has_more(&bctx)) {
+        BUT_TRY {
+            but_driver(&bctx);
+        }
+        BUT_CATCH_ALL {
+            ; // The driver recorded the failure.
+        }
+        BUT_END_TRY;
+        but_junit_write_case(&junit, &bctx, 1000000,
+                             but_get_index(&bctx) == 3 ? output : NULL);
+        but_next(&bctx);
+    }
+    logger_set_level(level);
+    but_end(&bctx);
+    but_junit_close(&junit);
+
+    return true;
+}
+
+// Verify the report escapes what XML reserves, replaces control characters, reports a
+// failed test as a failure and a failed setup as an error, and includes the output.
+BUT_TEST_SETUP_CLEANUP("JUnit Report", junit_report, set_up_junit, cleanup_junit) {
+    static char const header[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                 "<testsuites>\n"
+                                 "  <testsuite name=\"JUnit &amp; Report\" "
+                                 "tests=\"4\">\n";
+    static char const footer[] = "  </testsuite>\n</testsuites>\n";
+    char              report[4096];
+    FILE             *in = NULL;
+    size_t            length;
+
+    BUT_ASSERT_TRUE(write_junit_report());
+    BUT_ASSERT_TRUE(fopen_s(&in, JUNIT_TEST_PATH, "r") == 0);
+    length         = fread(report, 1, sizeof report - 1, in);
+    report[length] = '\0';
+    fclose(in);
+
+    BUT_ASSERT_TRUE(strncmp(report, header, strlen(header)) == 0);
+    BUT_ASSERT_TRUE(length >= strlen(footer));
+    BUT_ASSERT_STREQ(&report[length - strlen(footer)], footer);
+    BUT_ASSERT_NOT_NULL(strstr(report, "    <testcase classname=\"JUnit &amp; Report\" "
+                                       "name=\"Pass &amp; &lt;Escape&gt; &quot;quoted"
+                                       "&quot; &apos;single&apos;\" "
+                                       "time=\"0.001000\"/>\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "name=\"Fail\" time=\"0.001000\">\n"
+                                       "      <failure type=\"test\" "
+                                       "message=\"test exception\">"
+                                       "bad?value &lt;1&gt;\nat "));
+    BUT_ASSERT_NOT_NULL(strstr(report, "</failure>\n    </testcase>\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "name=\"Fail Setup\" time=\"0.001000\">\n"
+                                       "      <error type=\"setup\" "
+                                       "message=\"invalid value\">at "));
+    BUT_ASSERT_NOT_NULL(strstr(report, "</error>\n    </testcase>\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "name=\"Print\" time=\"0.001000\">\n"
+                                       "      <system-out>said &quot;hi&quot;?\n"
+                                       "</system-out>\n    </testcase>\n"));
+}
@@ -0,0 +1,148 @@
+/**
+ * @file but_perf.c
+ * @author Douglas Cuthbertson
+ * @brief Per-thread hardware performance counters for test cases.
+ * @version 0.1
+ * @date 2025-09-16
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_perf.h"
+
+#include <abbreviated_types.h> // u64, flag32
+
+#include <stdbool.h> // bool, true, false
+#include <string.h>  // memset
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // EnableThreadProfiling, ReadThreadProfilingData, etc.
+
+// The hardware counter slots BUT asks for: instructions, L1D misses, LLC misses, and
+// branch misses, in that order.
+#define BUT_PERF_HW_SLOTS      4
+#define BUT_PERF_HW_SLOTS_MASK ((DWORD64)((1 << BUT_PERF_HW_SLOTS) - 1))
+
+static BUTPerfCounterFlag const g_slot_flags_[BUT_PERF_HW_SLOTS] = {
+    BUT_PERF_INSTRUCTIONS,
+    BUT_PERF_L1D_MISSES,
+    BUT_PERF_LLC_MISSES,
+    BUT_PERF_BRANCH_MISSES,
+};
+
+bool but_perf_open(BUTPerfSession *session) {
+    memset(session, 0, sizeof *session);
+    session->thread = GetCurrentThread();
+
+    // Prefer cycles and hardware counters, then cycles from the profiling API alone.
+    if (EnableThreadProfiling(session->thread, THREAD_PROFILING_FLAG_DISPATCH,
+                              BUT_PERF_HW_SLOTS_MASK, &session->profiling)
+        == ERROR_SUCCESS) {
+        session->available = BUT_PERF_CYCLES | BUT_PERF_INSTRUCTIONS
+                             | BUT_PERF_L1D_MISSES | BUT_PERF_LLC_MISSES
+                             | BUT_PERF_BRANCH_MISSES;
+    } else if (EnableThreadProfiling(session->thread, THREAD_PROFILING_FLAG_DISPATCH, 0,
+                                     &session->profiling)
+               == ERROR_SUCCESS) {
+        session->available = BUT_PERF_CYCLES;
+    } else {
+        // QueryThreadCycleTime works without any special configuration or privileges.
+        session->profiling = NULL;
+        session->available = BUT_PERF_CYCLES;
+    }
+
+    session->open = true;
+    return (session->available & BUT_PERF_INSTRUCTIONS) != 0;
+}
+
+void but_perf_close(BUTPerfSession *session) {
+    if (session->open && session->profiling != NULL) {
+        DisableThreadProfiling(session->profiling);
+    }
+
+    memset(session, 0, sizeof *session);
+}
+
+void but_perf_read(BUTPerfSession *session, BUTPerfCounters *counters) {
+    memset(counters, 0, sizeof *counters);
+    if (!session->open) {
+        return;
+    }
+
+    if (session->profiling != NULL) {
+        PERFORMANCE_DATA data;
+        DWORD            flags = READ_THREAD_PROFILING_FLAG_DISPATCHING;
+
+        if (session->available & BUT_PERF_INSTRUCTIONS) {
+            flags |= READ_THREAD_PROFILING_FLAG_HARDWARE_COUNTERS;
+        }
+
+        memset(&data, 0, sizeof data);
+        data.Size    = sizeof data;
+        data.Version = PERFORMANCE_DATA_VERSION;
+        if (ReadThreadProfilingData(session->profiling, flags, &data) == ERROR_SUCCESS) {
+            counters->cycles = data.CycleTime;
+            counters->valid  = BUT_PERF_CYCLES;
+            for (int i = 0; i < BUT_PERF_HW_SLOTS && i < data.HwCountersCount; i++) {
+                u64 value = data.HwCounters[i].Value;
+
+                switch (g_slot_flags_[i]) {
+                case BUT_PERF_INSTRUCTIONS:
+                    counters->instructions = value;
+                    break;
+                case BUT_PERF_L1D_MISSES:
+                    counters->l1d_misses = value;
+                    break;
+                case BUT_PERF_LLC_MISSES:
+                    counters->llc_misses = value;
+                    break;
+                case BUT_PERF_BRANCH_MISSES:
+                    counters->branch_misses = value;
+                    break;
+                default:
+                    break;
+                }
+                counters->valid |= g_slot_flags_[i];
+            }
+            return;
+        }
+    }
+
+    ULONG64 cycles;
+    if (QueryThreadCycleTime(session->thread, &cycles)) {
+        counters->cycles = cycles;
+        counters->valid  = BUT_PERF_CYCLES;
+    }
+}
+
+bool but_perf_read_context_switches(BUTPerfSession *session, u64 *count) {
+    PERFORMANCE_DATA data;
+    DWORD            flags;
+
+    *count = 0;
+    if (!session->open || session->profiling == NULL) {
+        return false;
+    }
+
+    memset(&data, 0, sizeof data);
+    data.Size    = sizeof data;
+    data.Version = PERFORMANCE_DATA_VERSION;
+    flags = READ_THREAD_PROFILING_FLAG_DISPATCHING;
+    if (ReadThreadProfilingData(session->profiling, flags, &data) != ERROR_SUCCESS) {
+        return false;
+    }
+
+    *count = data.ContextSwitchCount;
+    return true;
+}
+
+void but_perf_delta(BUTPerfCounters const *begin, BUTPerfCounters const *end,
+                    BUTPerfCounters *delta) {
+    delta->valid         = begin->valid & end->valid;
+    delta->cycles        = end->cycles - begin->cycles;
+    delta->instructions  = end->instructions - begin->instructions;
+    delta->l1d_misses    = end->l1d_misses - begin->l1d_misses;
+    delta->llc_misses    = end->llc_misses - begin->llc_misses;
+    delta->branch_misses = end->branch_misses - begin->branch_misses;
+}
@@ -0,0 +1,117 @@
+#ifndef BUT_PERF_H_
+#define BUT_PERF_H_
+
+/**
+ * @file but_perf.h
+ * @author Douglas Cuthbertson
+ * @brief Per-thread hardware performance counters for test cases.
+ * @version 0.1
+ * @date 2025-09-16
+ *
+ * Windows doesn't have an equivalent of Linux's perf_event_open. Instead, the thread
+ * profiling API (EnableThreadProfiling/ReadThreadProfilingData) reports a thread's cycle
+ * time and, when an administrator has configured the system's hardware counter profile
+ * sources, up to 16 hardware counters. BUT expects the first four configured counters
+ * to be, in order: instructions retired, L1 data-cache misses, last-level cache misses,
+ * and mispredicted branches.
+ *
+ * Counters degrade gracefully. If hardware counters can't be enabled, only cycles are
+ * collected, and if thread profiling isn't available at all, cycles are read with
+ * QueryThreadCycleTime.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u64, flag32
+
+#include <stdbool.h> // bool
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HANDLE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/// Bits in BUTPerfCounters.valid that identify the counters that were collected
+typedef enum BUTPerfCounterFlag {
+    BUT_PERF_CYCLES        = 1 << 0,
+    BUT_PERF_INSTRUCTIONS  = 1 << 1,
+    BUT_PERF_L1D_MISSES    = 1 << 2,
+    BUT_PERF_LLC_MISSES    = 1 << 3,
+    BUT_PERF_BRANCH_MISSES = 1 << 4,
+} BUTPerfCounterFlag;
+
+/**
+ * @brief a snapshot of, or the difference between two snapshots of, a thread's
+ * performance counters.
+ */
+typedef struct BUTPerfCounters {
+    u64    cycles;        ///< CPU cycles consumed by the thread
+    u64    instructions;  ///< instructions retired
+    u64    l1d_misses;    ///< L1 data-cache misses
+    u64    llc_misses;    ///< last-level cache misses
+    u64    branch_misses; ///< mispredicted branches
+    flag32 valid;         ///< BUTPerfCounterFlag bits for the counters collected
+} BUTPerfCounters;
+
+/**
+ * @brief the state needed to read the performance counters of one thread.
+ */
+typedef struct BUTPerfSession {
+    HANDLE profiling; ///< from EnableThreadProfiling, or NULL
+    HANDLE thread;    ///< the thread being measured
+    flag32 available; ///< BUTPerfCounterFlag bits for the counters that can be read
+    bool   open;      ///< true between but_perf_open and but_perf_close
+} BUTPerfSession;
+
+/**
+ * @brief start collecting performance counters for the calling thread.
+ *
+ * @param session the session to open.
+ * @return true if at least hardware counters are available, and false if only cycles
+ * can be collected.
+ */
+bool but_perf_open(BUTPerfSession *session);
+
+/**
+ * @brief stop collecting performance counters.
+ *
+ * @param session a session opened by but_perf_open.
+ */
+void but_perf_close(BUTPerfSession *session);
+
+/**
+ * @brief read the current values of the counters for the session's thread.
+ *
+ * @param session a session opened by but_perf_open.
+ * @param counters receives the counter values.
+ */
+void but_perf_read(BUTPerfSession *session, BUTPerfCounters *counters);
+
+/**
+ * @brief read the number of context switches of the session's thread.
+ *
+ * @param session a session opened by but_perf_open.
+ * @param count receives the number of context switches.
+ * @return true if the count was read, and false if the session isn't open or thread
+ * profiling isn't available.
+ */
+bool but_perf_read_context_switches(BUTPerfSession *session, u64 *count);
+
+/**
+ * @brief calculate the difference between two snapshots of the counters.
+ *
+ * @param begin the counters read before the code being measured.
+ * @param end the counters read after the code being measured.
+ * @param delta receives end - begin for each counter that's valid in both.
+ */
+void but_perf_delta(BUTPerfCounters const *begin, BUTPerfCounters const *end,
+                    BUTPerfCounters *delta);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_PERF_H_
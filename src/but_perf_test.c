@@ -0,0 +1,61 @@
+/**
+ * @file but_perf_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of reading a thread's performance counters.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * Which counters can be read depends on the machine and the account that runs the tests,
+ * but cycles always can, so the test only counts on those.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_perf.h" // BUTPerfSession, but_perf_open, but_perf_read, etc.
+
+#include <abbreviated_types.h> // u32, u64, flag32
+#include <but.h>               // BUT_TEST
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_FALSE
+
+#include <stdbool.h> // bool
+
+// Do some work for the counters to count.
+static u64 perf_spin(void) {
+    u64 volatile sum = 0;
+
+    for (u32 i = 0; i < 100000; i++) {
+        sum += i;
+    }
+
+    return sum;
+}
+
+// Verify a session opens on the test's thread, counts the cycles spent between two
+// reads, and reads nothing once it's closed.
+BUT_TEST("Perf Counters Session", perf_session) {
+    BUTPerfSession  session;
+    BUTPerfCounters begin;
+    BUTPerfCounters end;
+    BUTPerfCounters delta;
+    bool            hardware  = but_perf_open(&session);
+    bool            opened    = session.open;
+    flag32          available = session.available;
+
+    but_perf_read(&session, &begin);
+    perf_spin();
+    but_perf_read(&session, &end);
+    but_perf_delta(&begin, &end, &delta);
+    but_perf_close(&session);
+
+    BUT_ASSERT_TRUE(opened);
+    BUT_ASSERT_TRUE(available & BUT_PERF_CYCLES);
+    BUT_ASSERT_TRUE(hardware == ((available & BUT_PERF_INSTRUCTIONS) != 0));
+    BUT_ASSERT_TRUE(delta.valid & BUT_PERF_CYCLES);
+    BUT_ASSERT_TRUE(delta.cycles > 0);
+    if (delta.valid & BUT_PERF_INSTRUCTIONS) {
+        BUT_ASSERT_TRUE(delta.instructions > 0);
+    }
+
+    BUT_ASSERT_FALSE(session.open);
+    but_perf_read(&session, &end);
+    BUT_ASSERT_TRUE(end.valid == 0);
+}
@@ -0,0 +1,307 @@
+/**
+ * @file but_profile.c
+ * @author Douglas Cuthbertson
+ * @brief A sampling CPU profiler for test functions.
+ * @version 0.1
+ * @date 2025-09-21
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_profile.h"
+#include "log.h" // logger_get_filename
+
+#include <abbreviated_types.h> // u16, u32
+
+#include <stdbool.h> // bool, true, false
+#include <stdint.h>  // uintptr_t
+#include <stdio.h>   // fprintf, fputc
+#include <stdlib.h>  // calloc, free, qsort
+#include <string.h>  // memcmp, memset
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // SuspendThread, GetThreadContext, RtlVirtualUnwind, etc.
+#include <DbgHelp.h> // SymFromAddr
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+/**
+ * @brief unwind the suspended target's stack into a sample. Don't call anything here
+ * that might take a lock the target holds, such as the heap's.
+ *
+ * @param profiler the profiler.
+ * @param context the target's registers.
+ * @param sample receives the call stack.
+ */
+static void capture_stack(BUTProfiler *profiler, CONTEXT *context,
+                          BUTProfileSample *sample) {
+    u16 n = 0;
+
+#if defined(_M_X64)
+    while (n < BUT_PROFILE_MAX_FRAMES && context->Rip != 0) {
+        DWORD64           image_base;
+        PRUNTIME_FUNCTION function;
+
+        sample->frames[n++] = (void *)(uintptr_t)context->Rip;
+        function            = RtlLookupFunctionEntry(context->Rip, &image_base, NULL);
+        if (function != NULL) {
+            PVOID   handler_data;
+            DWORD64 establisher_frame;
+
+            RtlVirtualUnwind(UNW_FLAG_NHANDLER, image_base, context->Rip, function,
+                             context, &handler_data, &establisher_frame, NULL);
+        } else if (context->Rsp >= profiler->stack_low
+                   && context->Rsp + sizeof(DWORD64) <= profiler->stack_high) {
+            // A leaf function: the return address is on the top of the stack.
+            context->Rip = *(DWORD64 *)(uintptr_t)context->Rsp;
+            context->Rsp += sizeof(DWORD64);
+        } else {
+            break;
+        }
+    }
+#else
+    // Walk the chain of frame pointers. Each frame holds the caller's frame pointer
+    // followed by the return address.
+#if defined(_M_IX86)
+    ULONG_PTR frame = context->Ebp;
+
+    sample->frames[n++] = (void *)(uintptr_t)context->Eip;
+#else
+    ULONG_PTR frame = context->Fp;
+
+    sample->frames[n++] = (void *)(uintptr_t)context->Pc;
+#endif
+    while (n < BUT_PROFILE_MAX_FRAMES && frame >= profiler->stack_low
+           && frame + 2 * sizeof(ULONG_PTR) <= profiler->stack_high) {
+        ULONG_PTR const *link = (ULONG_PTR const *)frame;
+
+        sample->frames[n++] = (void *)link[1];
+        if (link[0] <= frame) {
+            break; // frames must move toward the base of the stack
+        }
+        frame = link[0];
+    }
+#endif
+
+    sample->frame_count = n;
+}
+
+static void take_sample(BUTProfiler *profiler) {
+    AcquireSRWLockExclusive(&profiler->lock);
+    if (profiler->sampling) {
+        if (profiler->count == BUT_PROFILE_MAX_SAMPLES) {
+            profiler->dropped++;
+        } else if (SuspendThread(profiler->target) != (DWORD)-1) {
+            CONTEXT context;
+
+            memset(&context, 0, sizeof context);
+            context.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
+            if (GetThreadContext(profiler->target, &context)) {
+                capture_stack(profiler, &context, &profiler->samples[profiler->count]);
+                profiler->count++;
+            }
+            ResumeThread(profiler->target);
+        }
+    }
+    ReleaseSRWLockExclusive(&profiler->lock);
+}
+
+static DWORD WINAPI sampler_main(LPVOID parameter) {
+    BUTProfiler *profiler = parameter;
+
+    while (WaitForSingleObject(profiler->timer, INFINITE) == WAIT_OBJECT_0
+           && !profiler->exiting) {
+        take_sample(profiler);
+    }
+
+    return 0;
+}
+
+bool but_profile_open(BUTProfiler *profiler) {
+    HANDLE process = GetCurrentProcess();
+
+    memset(profiler, 0, sizeof *profiler);
+    InitializeSRWLock(&profiler->lock);
+    GetCurrentThreadStackLimits(&profiler->stack_low, &profiler->stack_high);
+
+    profiler->samples = calloc(BUT_PROFILE_MAX_SAMPLES, sizeof *profiler->samples);
+    if (profiler->samples == NULL) {
+        return false;
+    }
+
+    if (!DuplicateHandle(process, GetCurrentThread(), process, &profiler->target,
+                         THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT
+                             | THREAD_QUERY_INFORMATION,
+                         FALSE, 0)) {
+        but_profile_close(profiler);
+        return false;
+    }
+
+    // Without a high-resolution timer, samples are only as frequent as the system tick.
+    profiler->timer = CreateWaitableTimerExW(NULL, NULL,
+                                             CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                             TIMER_ALL_ACCESS);
+    if (profiler->timer == NULL) {
+        profiler->timer = CreateWaitableTimerW(NULL, FALSE, NULL);
+    }
+
+    if (profiler->timer == NULL) {
+        but_profile_close(profiler);
+        return false;
+    }
+
+    profiler->sampler = CreateThread(NULL, 0, sampler_main, profiler, 0, NULL);
+    if (profiler->sampler == NULL) {
+        but_profile_close(profiler);
+        return false;
+    }
+
+    // Keep the sampler from waiting behind the test thread for a processor.
+    SetThreadPriority(profiler->sampler, THREAD_PRIORITY_TIME_CRITICAL);
+    profiler->open = true;
+    return true;
+}
+
+// Set the timer to fire after one interval and then periodically, or only once.
+static void set_timer(BUTProfiler *profiler, bool periodic) {
+    LARGE_INTEGER due;
+    LONG          period = periodic ? BUT_PROFILE_INTERVAL_US / 1000 : 0;
+
+    // The due time is relative, in 100-nanosecond units, and the period is in ms.
+    due.QuadPart = -(LONGLONG)BUT_PROFILE_INTERVAL_US * 10;
+    SetWaitableTimer(profiler->timer, &due, period, NULL, NULL, FALSE);
+}
+
+void but_profile_close(BUTProfiler *profiler) {
+    if (profiler->sampler != NULL) {
+        profiler->exiting = true;
+        set_timer(profiler, false);
+        WaitForSingleObject(profiler->sampler, INFINITE);
+        CloseHandle(profiler->sampler);
+    }
+
+    if (profiler->timer != NULL) {
+        CancelWaitableTimer(profiler->timer);
+        CloseHandle(profiler->timer);
+    }
+
+    if (profiler->target != NULL) {
+        CloseHandle(profiler->target);
+    }
+
+    free(profiler->samples);
+    memset(profiler, 0, sizeof *profiler);
+}
+
+void but_profile_start(BUTProfiler *profiler) {
+    if (profiler->open) {
+        AcquireSRWLockExclusive(&profiler->lock);
+        profiler->count    = 0;
+        profiler->dropped  = 0;
+        profiler->sampling = true;
+        ReleaseSRWLockExclusive(&profiler->lock);
+        set_timer(profiler, true);
+    }
+}
+
+void but_profile_stop(BUTProfiler *profiler) {
+    if (profiler->open) {
+        AcquireSRWLockExclusive(&profiler->lock);
+        profiler->sampling = false;
+        ReleaseSRWLockExclusive(&profiler->lock);
+        CancelWaitableTimer(profiler->timer);
+    }
+}
+
+// Order samples by their call stacks so identical stacks are adjacent.
+static int compare_samples(void const *a, void const *b) {
+    BUTProfileSample const *lhs = a;
+    BUTProfileSample const *rhs = b;
+
+    if (lhs->frame_count != rhs->frame_count) {
+        return lhs->frame_count < rhs->frame_count ? -1 : 1;
+    }
+
+    return memcmp(lhs->frames, rhs->frames, lhs->frame_count * sizeof lhs->frames[0]);
+}
+
+// Write a frame's name with the characters folded stacks reserve replaced.
+static void write_frame_name(FILE *out, char const *name) {
+    for (; *name != '\0'; name++) {
+        fputc(*name == ';' ? ':' : *name, out);
+    }
+}
+
+// Write "module!symbol", or "module+offset" if the address has no symbol.
+static void write_frame(FILE *out, void *address) {
+    HANDLE  process = GetCurrentProcess();
+    HMODULE module  = NULL;
+    char    path[MAX_PATH] = "?";
+    DWORD64 displacement;
+    struct {
+        SYMBOL_INFO info;
+        char        name[256];
+    } symbol;
+
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                               | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCSTR)address, &module)) {
+        GetModuleFileNameA(module, path, sizeof path);
+    }
+    write_frame_name(out, logger_get_filename(path));
+
+    memset(&symbol, 0, sizeof symbol);
+    symbol.info.SizeOfStruct = sizeof symbol.info;
+    symbol.info.MaxNameLen   = sizeof symbol.name;
+    if (SymFromAddr(process, (DWORD64)(uintptr_t)address, &displacement, &symbol.info)) {
+        fputc('!', out);
+        write_frame_name(out, symbol.info.Name);
+    } else {
+        fprintf(out, "+0x%llx", (unsigned long long)((BYTE *)address - (BYTE *)module));
+    }
+}
+
+void but_profile_write_folded(BUTProfiler *profiler, FILE *out, char const *suite,
+                              char const *test_case) {
+    HANDLE process = GetCurrentProcess();
+    u32    i       = 0;
+
+    if (!profiler->open || profiler->count == 0) {
+        return;
+    }
+
+    // Symbols are loaded lazily, the first time samples are written.
+    SymSetOptions(SymGetOptions() | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+    SymInitialize(process, NULL, TRUE); // fails harmlessly if already initialized
+    SymRefreshModuleList(process);
+
+    qsort(profiler->samples, profiler->count, sizeof *profiler->samples,
+          compare_samples);
+    while (i < profiler->count) {
+        BUTProfileSample const *sample = &profiler->samples[i];
+        u32                     same   = 1;
+
+        while (i + same < profiler->count
+               && compare_samples(sample, &profiler->samples[i + same]) == 0) {
+            same++;
+        }
+
+        write_frame_name(out, suite);
+        fputc(';', out);
+        write_frame_name(out, test_case);
+        for (u16 f = sample->frame_count; f > 0; f--) {
+            fputc(';', out);
+            write_frame(out, sample->frames[f - 1]);
+        }
+        fprintf(out, " %u\n", same);
+        i += same;
+    }
+
+    if (profiler->dropped > 0) {
+        LOG_INFO("Profile", "%s: dropped %u samples after the first %u", test_case,
+                 profiler->dropped, BUT_PROFILE_MAX_SAMPLES);
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef BUT_PROFILE_H_
+#define BUT_PROFILE_H_
+
+/**
+ * @file but_profile.h
+ * @author Douglas Cuthbertson
+ * @brief A sampling CPU profiler for test functions.
+ * @version 0.1
+ * @date 2025-09-21
+ *
+ * Windows has no SIGPROF or per-thread POSIX timers. Instead, a sampling thread wakes on
+ * a high-resolution waitable timer, suspends the thread running the test, captures its
+ * call stack from its register context, and resumes it. Capturing a stack only unwinds
+ * it, using the unwind tables on x64 and frame pointers on x86, into preallocated
+ * storage. Symbols are looked up after the test function returns, when the samples are
+ * written as folded stacks that flame-graph tools can consume.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u16, u32
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HANDLE, SRWLOCK, ULONG_PTR
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_PROFILE_MAX_FRAMES  48    ///< the deepest call stack recorded in a sample
+#define BUT_PROFILE_MAX_SAMPLES 16384 ///< samples kept per test case; about 16s at 1kHz
+#define BUT_PROFILE_INTERVAL_US 1000  ///< the time between samples, in microseconds
+
+/**
+ * @brief the call stack of one sample, leaf first.
+ */
+typedef struct BUTProfileSample {
+    void *frames[BUT_PROFILE_MAX_FRAMES]; ///< return addresses, starting at the leaf
+    u16   frame_count;                    ///< the number of valid frames
+} BUTProfileSample;
+
+/**
+ * @brief the state of a profiler that samples one thread.
+ */
+typedef struct BUTProfiler {
+    HANDLE            target;     ///< the thread being sampled
+    HANDLE            sampler;    ///< the thread taking the samples
+    HANDLE            timer;      ///< wakes the sampler
+    SRWLOCK           lock;       ///< held while the target is suspended
+    ULONG_PTR         stack_low;  ///< the lowest address of the target's stack
+    ULONG_PTR         stack_high; ///< one past the highest address of the target's stack
+    BUTProfileSample *samples;    ///< the current case's samples
+    u32               count;      ///< the number of samples taken for the current case
+    u32               dropped;    ///< samples that didn't fit in samples
+    bool              sampling;   ///< true while the target runs a test function
+    bool volatile     exiting;    ///< tells the sampler to exit
+    bool              open;       ///< true while the sampling thread runs
+} BUTProfiler;
+
+/**
+ * @brief start a sampling thread for the calling thread. It doesn't take samples until
+ * but_profile_start is called.
+ *
+ * @param profiler the profiler to open.
+ * @return true if the profiler is ready, and false otherwise.
+ */
+bool but_profile_open(BUTProfiler *profiler);
+
+/**
+ * @brief stop the sampling thread and release the profiler's resources.
+ *
+ * @param profiler a profiler opened by but_profile_open.
+ */
+void but_profile_close(BUTProfiler *profiler);
+
+/**
+ * @brief discard the samples of the previous case and start sampling.
+ *
+ * @param profiler a profiler opened by but_profile_open on the calling thread.
+ */
+void but_profile_start(BUTProfiler *profiler);
+
+/**
+ * @brief stop sampling. No sample is in progress when this returns.
+ *
+ * @param profiler a profiler opened by but_profile_open on the calling thread.
+ */
+void but_profile_stop(BUTProfiler *profiler);
+
+/**
+ * @brief write the samples of the most recent case as folded stacks: one line per
+ * unique call stack, with its frames from the root to the leaf separated by semicolons,
+ * followed by the number of samples with that stack.
+ *
+ * @param profiler a profiler opened by but_profile_open.
+ * @param out the stream to which the stacks are written.
+ * @param suite the name of the test suite, written as the root frame of every stack.
+ * @param test_case the name of the test case, written as the second frame.
+ */
+void but_profile_write_folded(BUTProfiler *profiler, FILE *out, char const *suite,
+                              char const *test_case);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_PROFILE_H_
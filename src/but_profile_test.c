@@ -0,0 +1,61 @@
+/**
+ * @file but_profile_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the sampling profiler.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * How many samples are taken depends on the scheduler, so the test checks that the
+ * profiler starts, samples, and stops cleanly on the test's own thread rather than what
+ * it sampled.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_profile.h" // BUTProfiler, but_profile_open, but_profile_close, etc.
+
+#include <abbreviated_types.h> // u32, u64
+#include <but.h>               // BUT_TEST
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_FALSE, BUT_ASSERT_NULL
+
+#include <stdbool.h> // bool
+
+// Keep the thread busy long enough to be sampled.
+static u64 profile_spin(void) {
+    u64 volatile sum = 0;
+
+    for (u32 i = 0; i < 1000000; i++) {
+        sum += i;
+    }
+
+    return sum;
+}
+
+// Verify a profiler opens on a normal thread, starts and stops sampling, keeps no more
+// samples than it has room for, and releases everything when it's closed.
+BUT_TEST("Profiler Open and Close", profile_open_close) {
+    BUTProfiler profiler;
+    bool        opened   = but_profile_open(&profiler);
+    bool        ready    = profiler.open && profiler.samples != NULL;
+    bool        sampling = false;
+    bool        stopped  = false;
+    u32         count    = 0;
+
+    if (opened) {
+        but_profile_start(&profiler);
+        sampling = profiler.sampling;
+        profile_spin();
+        but_profile_stop(&profiler);
+        stopped = !profiler.sampling;
+        count   = profiler.count;
+    }
+    but_profile_close(&profiler);
+
+    BUT_ASSERT_TRUE(opened);
+    BUT_ASSERT_TRUE(ready);
+    BUT_ASSERT_TRUE(sampling);
+    BUT_ASSERT_TRUE(stopped);
+    BUT_ASSERT_TRUE(count <= BUT_PROFILE_MAX_SAMPLES);
+    BUT_ASSERT_FALSE(profiler.open);
+    BUT_ASSERT_NULL(profiler.samples);
+    BUT_ASSERT_NULL(profiler.sampler);
+}
@@ -0,0 +1,105 @@
+/**
+ * @file but_progress.c
+ * @author Douglas Cuthbertson
+ * @brief A single status line that shows the progress of a test suite.
+ * @version 0.1
+ * @date 2025-09-26
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_progress.h"
+#include "but_timer.h" // but_timer_now, but_timer_frequency, but_timer_ticks_to_ns
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <inttypes.h> // PRIu64
+#include <io.h>       // _fileno, _isatty
+#include <stdbool.h>  // bool, true, false
+#include <stdio.h>    // FILE, fprintf, fflush, snprintf
+#include <string.h>   // memset
+
+#define BUT_PROGRESS_RATE 10 ///< the most times the line is drawn each second
+
+void but_progress_init(BUTProgress *progress, FILE *out) {
+    memset(progress, 0, sizeof *progress);
+    progress->out      = out;
+    progress->live     = _isatty(_fileno(out)) != 0;
+    progress->interval = but_timer_frequency() / BUT_PROGRESS_RATE;
+}
+
+// Draw the line over the one on the console.
+static void draw(BUTProgress *progress, u64 now) {
+    char   line[BUT_PROGRESS_WIDTH + 1];
+    double seconds = (double)but_timer_ticks_to_ns(now - progress->begin) / 1e9;
+    double rate    = seconds > 0 ? progress->completed / seconds : 0;
+    int    length;
+
+    length = snprintf(line, sizeof line, "%s: %u/%u", progress->suite,
+                      progress->completed, progress->total);
+    if (progress->failures > 0 && length < BUT_PROGRESS_WIDTH) {
+        length += snprintf(line + length, sizeof line - length, ", %u failed",
+                           progress->failures);
+    }
+    if (rate > 0 && length < BUT_PROGRESS_WIDTH) {
+        u64 left = (u64)((progress->total - progress->completed) / rate);
+
+        length += snprintf(line + length, sizeof line - length,
+                           ", %.0f/s, ETA %" PRIu64 ":%02" PRIu64, rate, left / 60,
+                           left % 60);
+    }
+    if (progress->current != NULL && length < BUT_PROGRESS_WIDTH) {
+        length += snprintf(line + length, sizeof line - length, ", running %s",
+                           progress->current);
+    }
+    if (length > BUT_PROGRESS_WIDTH) {
+        length = BUT_PROGRESS_WIDTH;
+    }
+
+    // Pad with spaces to cover the end of a longer line drawn before.
+    fprintf(progress->out, "\r%s%*s", line,
+            progress->drawn > length ? progress->drawn - length : 0, "");
+    fflush(progress->out);
+    progress->drawn    = length;
+    progress->drawn_at = now;
+}
+
+void but_progress_begin_suite(BUTProgress *progress, char const *suite, u32 total) {
+    progress->suite     = suite;
+    progress->current   = NULL;
+    progress->total     = total;
+    progress->completed = 0;
+    progress->failures  = 0;
+    progress->begin     = but_timer_now();
+    progress->drawn_at  = progress->begin;
+}
+
+void but_progress_begin_case(BUTProgress *progress, char const *name) {
+    progress->current = name;
+    if (progress->live) {
+        u64 now = but_timer_now();
+
+        if (now - progress->drawn_at >= progress->interval) {
+            draw(progress, now);
+        }
+    }
+}
+
+void but_progress_end_case(BUTProgress *progress, bool failed) {
+    progress->current = NULL;
+    progress->completed++;
+    progress->failures += failed;
+}
+
+void but_progress_clear(BUTProgress *progress) {
+    if (progress->drawn > 0) {
+        fprintf(progress->out, "\r%*s\r", progress->drawn, "");
+        progress->drawn = 0;
+    }
+}
+
+void but_progress_end_suite(BUTProgress *progress) {
+    but_progress_clear(progress);
+    fflush(progress->out);
+    progress->suite   = NULL;
+    progress->current = NULL;
+}
@@ -0,0 +1,98 @@
+#ifndef BUT_PROGRESS_H_
+#define BUT_PROGRESS_H_
+
+/**
+ * @file but_progress.h
+ * @author Douglas Cuthbertson
+ * @brief A single status line that shows the progress of a test suite.
+ * @version 0.1
+ * @date 2025-09-26
+ *
+ * The line shows how many of a suite's test cases have finished, how many failed, how
+ * fast they're running, an estimate of the time left, and the case that's running. It's
+ * redrawn in place at most ten times a second, so the cost of reporting progress doesn't
+ * grow with the number of cases. When the output isn't a console, nothing is drawn.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u32, u64
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_PROGRESS_WIDTH 79 ///< the longest line drawn, so it never wraps
+
+/**
+ * @brief the progress of the test suite being run.
+ */
+typedef struct BUTProgress {
+    FILE       *out;       ///< the stream the line is drawn on
+    bool        live;      ///< true if out is a console, and the line can be redrawn
+    u64         interval;  ///< the fewest ticks between redraws
+    u64         begin;     ///< when the suite started, in ticks
+    u64         drawn_at;  ///< when the line was last drawn, in ticks
+    int         drawn;     ///< the length of the line on the console, or 0
+    char const *suite;     ///< the name of the suite
+    char const *current;   ///< the name of the case that's running, or NULL
+    u32         total;     ///< the number of cases in the suite
+    u32         completed; ///< the number of cases that have finished
+    u32         failures;  ///< the number of cases that failed
+} BUTProgress;
+
+/**
+ * @brief prepare to report progress.
+ *
+ * @param progress the progress line.
+ * @param out the stream to draw it on.
+ */
+void but_progress_init(BUTProgress *progress, FILE *out);
+
+/**
+ * @brief start reporting the progress of a test suite.
+ *
+ * @param progress the progress line.
+ * @param suite the name of the suite.
+ * @param total the number of test cases in the suite.
+ */
+void but_progress_begin_suite(BUTProgress *progress, char const *suite, u32 total);
+
+/**
+ * @brief note that a test case is about to run, and redraw the line if it's due.
+ *
+ * @param progress the progress line.
+ * @param name the name of the test case.
+ */
+void but_progress_begin_case(BUTProgress *progress, char const *name);
+
+/**
+ * @brief count a test case that finished.
+ *
+ * @param progress the progress line.
+ * @param failed true if the case failed.
+ */
+void but_progress_end_case(BUTProgress *progress, bool failed);
+
+/**
+ * @brief erase the line, so a full line can be printed in its place. It's drawn again
+ * the next time it's due.
+ *
+ * @param progress the progress line.
+ */
+void but_progress_clear(BUTProgress *progress);
+
+/**
+ * @brief stop reporting the progress of a test suite, and erase the line.
+ *
+ * @param progress the progress line.
+ */
+void but_progress_end_suite(BUTProgress *progress);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_PROGRESS_H_
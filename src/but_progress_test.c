@@ -0,0 +1,120 @@
+/**
+ * @file but_progress_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the progress line.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The tests draw the line on a file in the current directory and read it back. A file
+ * isn't a console, so the test that checks what's drawn makes the line live itself.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_progress.h" // BUTProgress, but_progress_init, etc.
+
+#include <but.h>        // BUT_TEST_SETUP_CLEANUP
+#include <but_assert.h> // BUT_ASSERT_TRUE, BUT_ASSERT_FALSE, BUT_ASSERT_NOT_NULL, etc.
+#include <but_macros.h> // BUT_UNUSED
+
+#include <stddef.h> // size_t
+#include <stdio.h>  // FILE, fopen_s, fread, fclose, remove, rewind
+#include <string.h> // memchr, memset, strchr, strlen, strncmp, strspn, strstr
+
+#define PROGRESS_TEST_PATH "but_butts_progress.txt"
+
+static BUT_SETUP_FN(set_up_progress) {
+    BUT_UNUSED(btc);
+    remove(PROGRESS_TEST_PATH);
+}
+
+static BUT_CLEANUP_FN(cleanup_progress) {
+    BUT_UNUSED(btc);
+    remove(PROGRESS_TEST_PATH);
+}
+
+// Read back what was drawn, and close the file.
+static size_t read_progress(FILE *out, char *text, size_t size) {
+    size_t length;
+
+    rewind(out);
+    length       = fread(text, 1, size - 1, out);
+    text[length] = '\0';
+    fclose(out);
+
+    return length;
+}
+
+// Verify nothing is drawn on a stream that isn't a console.
+BUT_TEST_SETUP_CLEANUP("Progress Not a Console", progress_quiet, set_up_progress,
+                       cleanup_progress) {
+    BUTProgress progress;
+    FILE       *out = NULL;
+    char        text[256];
+
+    BUT_ASSERT_TRUE(fopen_s(&out, PROGRESS_TEST_PATH, "w+") == 0);
+    but_progress_init(&progress, out);
+    BUT_ASSERT_FALSE(progress.live);
+
+    but_progress_begin_suite(&progress, "Suite", 1);
+    but_progress_begin_case(&progress, "a");
+    but_progress_end_case(&progress, false);
+    but_progress_end_suite(&progress);
+    BUT_ASSERT_EQ_INT((int)read_progress(out, text, sizeof text), 0);
+}
+
+// Verify a line longer than the width is cut to it, a shorter line drawn over it is
+// padded to cover it, and the line is erased at the end of the suite.
+BUT_TEST_SETUP_CLEANUP("Progress Line Width", progress_width, set_up_progress,
+                       cleanup_progress) {
+    BUTProgress progress;
+    FILE       *out = NULL;
+    char        name[101];
+    char        blank[BUT_PROGRESS_WIDTH + 1];
+    char        text[1024];
+    char       *line;
+    char       *end;
+    size_t      shown;
+    size_t      length;
+
+    memset(name, 'n', sizeof name - 1);
+    name[sizeof name - 1] = '\0';
+    memset(blank, ' ', sizeof blank - 1);
+    blank[sizeof blank - 1] = '\0';
+
+    BUT_ASSERT_TRUE(fopen_s(&out, PROGRESS_TEST_PATH, "w+") == 0);
+    but_progress_init(&progress, out);
+    progress.live     = true;
+    progress.interval = 0;
+
+    but_progress_begin_suite(&progress, "Suite", 3);
+    but_progress_begin_case(&progress, name);
+    but_progress_end_case(&progress, true);
+    but_progress_begin_case(&progress, "b");
+    but_progress_end_suite(&progress);
+    length = read_progress(out, text, sizeof text);
+
+    // The first line is cut to the width.
+    line = text;
+    BUT_ASSERT_TRUE(*line++ == '\r');
+    BUT_ASSERT_TRUE(strncmp(line, "Suite: 0/3, running nnn", 23) == 0);
+    BUT_ASSERT_NULL(memchr(line, '\r', BUT_PROGRESS_WIDTH));
+    line += BUT_PROGRESS_WIDTH;
+
+    // The second is padded with spaces to the width of the first.
+    BUT_ASSERT_TRUE(*line++ == '\r');
+    BUT_ASSERT_TRUE(strncmp(line, "Suite: 1/3, 1 failed, ", 22) == 0);
+    end = strchr(line, '\r');
+    BUT_ASSERT_NOT_NULL(end);
+    BUT_ASSERT_EQ_INT((int)(end - line), BUT_PROGRESS_WIDTH);
+    *end = '\0';
+    BUT_ASSERT_NOT_NULL(strstr(line, ", running b"));
+    shown = strstr(line, ", running b") + strlen(", running b") - line;
+    BUT_ASSERT_EQ_INT((int)strspn(&line[shown], " "), BUT_PROGRESS_WIDTH - (int)shown);
+    line = end + 1;
+
+    // The last is erased as far as the text of the second reached.
+    BUT_ASSERT_EQ_INT((int)(text + length - line), (int)shown + 1);
+    BUT_ASSERT_TRUE(strncmp(line, blank, shown) == 0);
+    BUT_ASSERT_TRUE(line[shown] == '\r');
+    BUT_ASSERT_EQ_INT(progress.drawn, 0);
+}
@@ -0,0 +1,92 @@
+/**
+ * @file but_reason_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of catching a reason in a different module than the one that threw it.
+ * @version 0.1
+ * @date 2025-10-01
+ *
+ * The test loads but_test_data.dll as the driver, as the tests in but_test.c do, and
+ * installs one context in both libraries, so both number reasons in the driver's
+ * registry. Each library has its own copy of TEST_DATA_REASON, at its own address. It
+ * uses the helpers in but_test.c, so this file is included after it.
+ *
+ * While the context is installed, an assertion would throw through it instead of the
+ * context that runs this suite, so the test records what it saw and asserts afterward.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_test.h"      // TestDriverData
+#include "but_test_data.h" // TEST_DATA_REASON, THROW_REASON_CTX_STR, etc.
+
+#include <but.h>        // BUT_TYPE_TEST_SETUP_CLEANUP
+#include <but_assert.h> // BUT_ASSERT_TRUE, BUT_ASSERT_NOT_NULL
+#include <but_macros.h> // BUT_CONTAINER
+#include <exception.h>  // BUT_THROW, BUT_TRY, BUT_CATCH, but_reason_id, etc.
+
+#include <stdbool.h> // bool, true, false
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetProcAddress
+
+// This library's copy of the reason the driver throws and catches.
+static char const suite_reason[] = TEST_DATA_REASON;
+
+static void throw_suite_reason(void) {
+    BUT_THROW(suite_reason);
+}
+
+static void set_up_reason_driver(BUTTestCase *btc) {
+    set_up_test_driver_data(BUT_CONTAINER(btc, TestDriverData, btc));
+}
+
+static void cleanup_reason_driver(BUTTestCase *btc) {
+    cleanup_test_driver_data(BUT_CONTAINER(btc, TestDriverData, btc));
+}
+
+// Verify a reason thrown by the suite is caught by the driver's copy of it, and the
+// driver's is caught by the suite's, though neither library declared the reason first.
+BUT_TYPE_TEST_SETUP_CLEANUP("Catch Reasons Across Modules", TestDriverData,
+                            reason_modules, set_up_reason_driver,
+                            cleanup_reason_driver) {
+    but_handler                handler;
+    test_data_throw_reason_fn *throw_reason;
+    test_data_catch_reason_fn *catch_reason;
+    BUTContext                 bctx;
+    bool                       unnumbered    = false;
+    bool                       driver_caught = false;
+    bool                       suite_caught  = false;
+    bool                       numbered      = false;
+
+    handler = (but_handler)GetProcAddress(t->h, "test_data_handler");
+    throw_reason
+        = (test_data_throw_reason_fn *)GetProcAddress(t->h, THROW_REASON_CTX_STR);
+    catch_reason
+        = (test_data_catch_reason_fn *)GetProcAddress(t->h, CATCH_REASON_CTX_STR);
+    BUT_ASSERT_NOT_NULL(handler);
+    BUT_ASSERT_NOT_NULL(throw_reason);
+    BUT_ASSERT_NOT_NULL(catch_reason);
+
+    t->initialize_context(&bctx, handler);
+    t->register_suite(&bctx, but_set_exception_context);
+    t->attach_thread(&bctx);
+
+    unnumbered = but_reason_id(BUT_CURRENT_CONTEXT, suite_reason) == BUT_REASON_ID_NONE;
+    driver_caught = catch_reason(throw_suite_reason);
+    BUT_TRY {
+        throw_reason();
+    }
+    BUT_CATCH(suite_reason) {
+        suite_caught = true;
+    }
+    BUT_END_TRY;
+    numbered = but_reason_id(BUT_CURRENT_CONTEXT, suite_reason) != BUT_REASON_ID_NONE;
+
+    t->detach_thread(&bctx);
+
+    BUT_ASSERT_TRUE(unnumbered);
+    BUT_ASSERT_TRUE(driver_caught);
+    BUT_ASSERT_TRUE(suite_caught);
+    BUT_ASSERT_TRUE(numbered);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file but_report.c
+ * @author Douglas Cuthbertson
+ * @brief Reports of where a run's time went: the slowest test cases of each suite, and
+ * the suites that spend more time in setup and cleanup than in their tests.
+ * @version 0.1
+ * @date 2025-09-27
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_report.h"
+#include "but_driver.h" // but_get_case_times, but_get_case_name
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdio.h>  // FILE, fprintf, snprintf
+#include <stdlib.h> // free, malloc, qsort
+
+/**
+ * @brief A test case and the value of the metric by which it's sorted.
+ */
+typedef struct SortedCase {
+    u32 index; ///< the index of the test case
+    u64 value; ///< the value of the metric
+} SortedCase;
+
+// Sort the largest values first, and equal values by index.
+static int compare_sorted_cases(void const *a, void const *b) {
+    SortedCase const *lhs = a;
+    SortedCase const *rhs = b;
+
+    if (lhs->value != rhs->value) {
+        return lhs->value < rhs->value ? 1 : -1;
+    }
+
+    return lhs->index < rhs->index ? -1 : lhs->index > rhs->index;
+}
+
+void but_report_slowest(FILE *out, BUTContext *bctx, BUTTestSuite const *bts,
+                        u32 slowest) {
+    SortedCase *cases = malloc(bts->count * sizeof *cases);
+    u32         count = 0;
+
+    if (cases == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < bts->count; i++) {
+        BUTCaseTimes const *times = but_get_case_times(bctx, i);
+
+        if (times != NULL) {
+            cases[count].index = i;
+            cases[count].value = times->setup_ns + times->test_ns + times->cleanup_ns;
+            count++;
+        }
+    }
+
+    qsort(cases, count, sizeof *cases, compare_sorted_cases);
+    fprintf(out, "\nSlowest test cases (ms):\n%10s %10s %10s %10s\n", "total", "setup",
+            "test", "cleanup");
+    for (u32 i = 0; i < count && i < slowest; i++) {
+        BUTCaseTimes const *times = but_get_case_times(bctx, cases[i].index);
+
+        fprintf(out, "%10.3f %10.3f %10.3f %10.3f  %6u. %s\n",
+                (double)cases[i].value / 1e6, (double)times->setup_ns / 1e6,
+                (double)times->test_ns / 1e6, (double)times->cleanup_ns / 1e6,
+                cases[i].index + 1, but_get_case_name(bctx, cases[i].index));
+    }
+
+    free(cases);
+}
+
+void but_report_suite_times(BUTContext *bctx, BUTTestSuite const *bts,
+                            BUTSuiteTimes *total) {
+    snprintf(total->name, sizeof total->name, "%s", bts->name);
+    total->setup_ns   = 0;
+    total->test_ns    = 0;
+    total->cleanup_ns = 0;
+    for (u32 i = 0; i < bts->count; i++) {
+        BUTCaseTimes const *times = but_get_case_times(bctx, i);
+
+        if (times != NULL) {
+            total->setup_ns += times->setup_ns;
+            total->test_ns += times->test_ns;
+            total->cleanup_ns += times->cleanup_ns;
+        }
+    }
+}
+
+// Order suites by the share of their time spent in setup and cleanup, largest first.
+static int compare_fixture_share(void const *a, void const *b) {
+    BUTSuiteTimes const *lhs         = a;
+    BUTSuiteTimes const *rhs         = b;
+    double               lhs_fixture = (double)(lhs->setup_ns + lhs->cleanup_ns);
+    double               rhs_fixture = (double)(rhs->setup_ns + rhs->cleanup_ns);
+    double               lhs_share   = lhs_fixture / (lhs_fixture + lhs->test_ns + 1);
+    double               rhs_share   = rhs_fixture / (rhs_fixture + rhs->test_ns + 1);
+
+    return lhs_share < rhs_share ? 1 : lhs_share > rhs_share ? -1 : 0;
+}
+
+void but_report_fixture_heavy(FILE *out, BUTSuiteTimes *suites, int count) {
+    int heavy = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (suites[i].setup_ns + suites[i].cleanup_ns > suites[i].test_ns) {
+            suites[heavy++] = suites[i];
+        }
+    }
+    if (heavy == 0) {
+        return;
+    }
+
+    qsort(suites, (size_t)heavy, sizeof *suites, compare_fixture_share);
+    fprintf(out, "\nSuites dominated by setup and cleanup (ms):\n%10s %10s %10s\n",
+            "setup", "test", "cleanup");
+    for (int i = 0; i < heavy; i++) {
+        fprintf(out, "%10.3f %10.3f %10.3f  %s\n", (double)suites[i].setup_ns / 1e6,
+                (double)suites[i].test_ns / 1e6, (double)suites[i].cleanup_ns / 1e6,
+                suites[i].name);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef BUT_REPORT_H_
+#define BUT_REPORT_H_
+
+/**
+ * @file but_report.h
+ * @author Douglas Cuthbertson
+ * @brief Reports of where a run's time went: the slowest test cases of each suite, and
+ * the suites that spend more time in setup and cleanup than in their tests.
+ * @version 0.1
+ * @date 2025-09-27
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <but.h> // BUTTestSuite
+
+#include <stdio.h> // FILE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief The time a test suite spent in each phase of its test cases, kept after the
+ * suite is unloaded for the summary of the run.
+ */
+typedef struct BUTSuiteTimes {
+    char name[64];   ///< a copy of the suite's name, possibly truncated
+    u64  setup_ns;   ///< the total time spent in setup functions
+    u64  test_ns;    ///< the total time spent in test functions
+    u64  cleanup_ns; ///< the total time spent in cleanup functions
+} BUTSuiteTimes;
+
+/**
+ * @brief list the test cases of a suite that took the longest, slowest first, with the
+ * time each spent in its setup, test, and cleanup functions.
+ *
+ * @param out the stream to which the list is written.
+ * @param bctx the test context that ran the suite, before but_end.
+ * @param bts the test suite.
+ * @param slowest the most test cases to list.
+ */
+void but_report_slowest(FILE *out, BUTContext *bctx, BUTTestSuite const *bts,
+                        u32 slowest);
+
+/**
+ * @brief total the time a suite's test cases spent in each phase.
+ *
+ * @param bctx the test context that ran the suite, before but_end.
+ * @param bts the test suite.
+ * @param total receives the suite's name and totals.
+ */
+void but_report_suite_times(BUTContext *bctx, BUTTestSuite const *bts,
+                            BUTSuiteTimes *total);
+
+/**
+ * @brief list the suites that spend more time in setup and cleanup than in their tests,
+ * where a suite-level fixture would pay off, with the largest share of fixture time
+ * first.
+ *
+ * @param out the stream to which the list is written.
+ * @param suites the totals of the suites of a run. They're reordered.
+ * @param count the number of suites.
+ */
+void but_report_fixture_heavy(FILE *out, BUTSuiteTimes *suites, int count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_REPORT_H_
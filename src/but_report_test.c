@@ -0,0 +1,139 @@
+/**
+ * @file but_report_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the reports of the slowest test cases and fixture-heavy suites.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The tests give a context's cases phase times of their own choosing, so the reports
+ * are the same on every run, write the reports to a file in the current directory, and
+ * read them back.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTContext, BUTCaseTimes
+#include "but_driver.h"  // but_initialize, but_begin, but_end
+#include "but_report.h"  // but_report_slowest, but_report_fixture_heavy, etc.
+
+#include <abbreviated_types.h> // u32, u64
+#include <but.h>               // BUT_TEST_SETUP_CLEANUP, BUT_CASE_NAME, etc.
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_STREQ
+#include <but_macros.h>        // BUT_UNUSED, BUT_ARRAY_COUNT
+
+#include <stddef.h> // size_t
+#include <stdio.h>  // FILE, fopen_s, fread, fclose, remove, rewind
+
+#define REPORT_TEST_PATH "but_butts_report.txt"
+#define MS               1000000ull ///< nanoseconds in a millisecond
+
+static BUT_TEST_FN(report_pass) {
+    BUT_UNUSED(btc);
+}
+
+BUT_CASE_NAME("Alpha", report_alpha, report_pass, NULL, NULL);
+BUT_CASE_NAME("Bravo", report_bravo, report_pass, NULL, NULL);
+BUT_CASE_NAME("Charlie", report_charlie, report_pass, NULL, NULL);
+BUT_CASE_NAME("Delta", report_delta, report_pass, NULL, NULL);
+
+BUT_SUITE_BEGIN(report)
+BUT_SUITE_ADD(report_alpha)
+BUT_SUITE_ADD(report_bravo)
+BUT_SUITE_ADD(report_charlie)
+BUT_SUITE_ADD(report_delta)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("Report", report);
+
+static BUT_SETUP_FN(set_up_report) {
+    BUT_UNUSED(btc);
+    remove(REPORT_TEST_PATH);
+}
+
+static BUT_CLEANUP_FN(cleanup_report) {
+    BUT_UNUSED(btc);
+    remove(REPORT_TEST_PATH);
+}
+
+// Open the file a report is written to.
+static FILE *open_report(void) {
+    FILE *out = NULL;
+
+    BUT_ASSERT_TRUE(fopen_s(&out, REPORT_TEST_PATH, "w+") == 0);
+    return out;
+}
+
+// Read back what was written to a report, and close it.
+static void read_report(FILE *out, char *report, size_t size) {
+    size_t length;
+
+    rewind(out);
+    length         = fread(report, 1, size - 1, out);
+    report[length] = '\0';
+    fclose(out);
+}
+
+// Verify the slowest cases are listed slowest first, ties in suite order, and no more
+// than asked for, and that a suite's phase times are totaled.
+BUT_TEST_SETUP_CLEANUP("Report Slowest Cases", report_slowest, set_up_report,
+                       cleanup_report) {
+    static BUTCaseTimes const times[] = {
+        {1 * MS, 1 * MS, 1 * MS},
+        {2 * MS, 6 * MS, 2 * MS},
+        {0, 1 * MS, 0},
+        {0, 10 * MS, 0},
+    };
+    char const   *expected
+        = "\nSlowest test cases (ms):\n"
+          "     total      setup       test    cleanup\n"
+          "    10.000      2.000      6.000      2.000       2. Bravo\n"
+          "    10.000      0.000     10.000      0.000       4. Delta\n"
+          "     3.000      1.000      1.000      1.000       1. Alpha\n";
+    BUTContext    bctx;
+    BUTSuiteTimes total;
+    char          report[1024];
+    FILE         *out = open_report();
+
+    but_initialize(&bctx, NULL);
+    but_begin(&bctx, &BUT_TEST_SUITE_NAME(report));
+    for (u32 i = 0; i < BUT_ARRAY_COUNT(times); i++) {
+        bctx.env.times[i] = times[i];
+    }
+    but_report_slowest(out, &bctx, &BUT_TEST_SUITE_NAME(report), 3);
+    but_report_suite_times(&bctx, &BUT_TEST_SUITE_NAME(report), &total);
+    but_end(&bctx);
+    read_report(out, report, sizeof report);
+
+    BUT_ASSERT_STREQ(report, expected);
+    BUT_ASSERT_STREQ(total.name, "Report");
+    BUT_ASSERT_TRUE(total.setup_ns == 3 * MS);
+    BUT_ASSERT_TRUE(total.test_ns == 18 * MS);
+    BUT_ASSERT_TRUE(total.cleanup_ns == 3 * MS);
+}
+
+// Verify only the suites that spend more time in setup and cleanup than in their tests
+// are listed, with the largest share of fixture time first.
+BUT_TEST_SETUP_CLEANUP("Report Fixture-Heavy Suites", report_fixture_heavy,
+                       set_up_report, cleanup_report) {
+    BUTSuiteTimes suites[] = {
+        {"Light", 1 * MS, 10 * MS, 0},
+        {"Heavy", 3 * MS, 4 * MS, 3 * MS},
+        {"Even", 2 * MS, 4 * MS, 2 * MS},
+        {"Heaviest", 4 * MS, 1 * MS, 5 * MS},
+    };
+    char const *expected = "\nSuites dominated by setup and cleanup (ms):\n"
+                           "     setup       test    cleanup\n"
+                           "     4.000      1.000      5.000  Heaviest\n"
+                           "     3.000      4.000      3.000  Heavy\n";
+    char        report[1024];
+    FILE       *out = open_report();
+
+    but_report_fixture_heavy(out, suites, (int)BUT_ARRAY_COUNT(suites));
+    read_report(out, report, sizeof report);
+    BUT_ASSERT_STREQ(report, expected);
+
+    // A run with no fixture-heavy suites reports nothing.
+    out = open_report();
+    but_report_fixture_heavy(out, suites, 0);
+    read_report(out, report, sizeof report);
+    BUT_ASSERT_STREQ(report, "");
+}
@@ -8,14 +8,15 @@
  * See LICENSE.txt for copyright and licensing information about this file.
  *
  */
+#include "but_arena.h"          // but_arena_copy
 #include "but_context.h"        // BUTContext
 #include "but_result_context.h" // ResultContext
 #include "intrinsics_win32.h"
 
-#include <abbreviated_types.h> // u32
+#include <abbreviated_types.h> // u08, u32
 
 #include <stddef.h> // NULL
-#include <stdlib.h> // realloc
+#include <stdlib.h> // calloc, realloc
 #include <string.h> // memset
 
 /**
@@ -25,23 +26,16 @@
  */
 static void grow_capacity(BUTContext *bctx) {
     ResultContext *new_results;
-    u32            new_capacity, count;
-    u32 const      increment = 10;
+    u32            new_capacity;
 
-    // Calculate a new capacity up to the number of test cases in the test suite.
-    if (bctx->env.results_capacity + increment > bctx->env.test_case_count) {
-        new_capacity = bctx->env.test_case_count;
-        count        = bctx->env.test_case_count - bctx->env.results_capacity;
-    } else {
-        new_capacity = bctx->env.results_capacity + increment;
-        count        = increment;
-    }
-
-    new_results = realloc(bctx->env.results, new_capacity * sizeof(ResultContext));
+    // Double the capacity so appending n results copies O(n) of them. A test case can
+    // have more than one result, so the capacity isn't bounded by the number of cases.
+    new_capacity = bctx->env.results_capacity == 0 ? 16 : bctx->env.results_capacity * 2;
+    new_results  = realloc(bctx->env.results, new_capacity * sizeof(ResultContext));
     if (new_results) {
         // Initialize new memory block
         memset(&new_results[bctx->env.results_capacity], 0,
-               count * sizeof(ResultContext));
+               (new_capacity - bctx->env.results_capacity) * sizeof(ResultContext));
         bctx->env.results_capacity = new_capacity;
         bctx->env.results          = new_results;
     }
@@ -49,17 +43,41 @@ static void grow_capacity(BUTContext *bctx) {
 
 // create a new result context to capture the reason for a test failure.
 void new_result(BUTContext *bctx, BUTResultCode status, char const *reason,
-                char const *file, int line) {
+                char const *details, char const *file, int line) {
+    u32 index;
+
     if (bctx->env.results_count == bctx->env.results_capacity) {
         grow_capacity(bctx);
     }
 
     if (bctx->env.results_count < bctx->env.results_capacity) {
-        bctx->env.results[bctx->env.results_count].index  = bctx->env.index;
-        bctx->env.results[bctx->env.results_count].status = status;
-        bctx->env.results[bctx->env.results_count].reason = reason;
-        bctx->env.results[bctx->env.results_count].file   = file;
-        bctx->env.results[bctx->env.results_count].line   = line;
+        ResultContext *result = &bctx->env.results[bctx->env.results_count];
+
+        result->index   = bctx->env.index;
+        result->status  = status;
+        result->reason  = reason;
+        result->details = but_arena_copy(&bctx->env.arena, details);
+        result->output  = NULL;
+        result->file    = file;
+        result->line    = line;
         bctx->env.results_count++;
+
+        // Index each case's first result. The index is allocated at the first failure,
+        // so a suite that passes doesn't pay for it.
+        if (bctx->env.first_results == NULL && bctx->env.test_case_count > 0) {
+            bctx->env.first_results
+                = calloc(bctx->env.test_case_count, sizeof *bctx->env.first_results);
+        }
+        if (bctx->env.first_results != NULL && result->index < bctx->env.test_case_count
+            && bctx->env.first_results[result->index] == 0) {
+            bctx->env.first_results[result->index] = bctx->env.results_count;
+        }
+    }
+
+    // The first result of a test case is its status.
+    index = bctx->env.index;
+    if (bctx->env.statuses != NULL && index < bctx->env.test_case_count
+        && BUT_CASE_STATUS(bctx->env.statuses, index) == BUT_PASSED) {
+        bctx->env.statuses[index / 4] |= (u08)(status << index % 4 * 2);
     }
 }
@@ -15,6 +15,13 @@
 
 #include <abbreviated_types.h> // u32
 
+/**
+ * @brief the status of a test case in a table that packs two bits for each case, four
+ * cases to a byte. A case that hasn't failed is BUT_PASSED.
+ */
+#define BUT_CASE_STATUS(statuses, index) \
+    ((BUTResultCode)(((statuses)[(index) / 4] >> (index) % 4 * 2) & 3))
+
 /**
  * @brief The status and exception generated from a test case that did not pass.
  *
@@ -24,7 +31,9 @@
 struct ResultContext {
     u32           index;  ///< the index of the test case
     BUTResultCode status; ///< indicate state of test result
-    char const   *reason; ///< a string describing the reason for a failure
+    char const   *reason;  ///< a string describing the reason for a failure
+    char const   *details; ///< more about the failure, or NULL; a copy of BUT_DETAILS
+    char const   *output;  ///< what the test case printed, if it was kept, or NULL
     char const   *file;
     int           line;
 };
@@ -36,10 +45,12 @@ struct ResultContext {
  * @param bctx a test context.
  * @param status a test-result code.
  * @param reason a string describing the reason for the test failure.
+ * @param details a possibly NULL string with more about the failure. It's copied into
+ * the context's arena, so it outlives the exception that carried it.
  * @param file the name of the file in which the test failure occurred.
  * @param line the number of the line on which the test failure occurred.
  */
 void new_result(BUTContext *bctx, BUTResultCode status, char const *reason,
-                char const *file, int line);
+                char const *details, char const *file, int line);
 
 #endif // BUT_RESULT_CONTEXT_H_
@@ -0,0 +1,411 @@
+/**
+ * @file but_results.c
+ * @author Douglas Cuthbertson
+ * @brief A compact, append-only binary log of test results.
+ * @version 0.1
+ * @date 2025-09-25
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_results.h"
+
+#include <abbreviated_types.h> // u08, u16, u32, u64
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, fwrite, fclose, setvbuf
+#include <stdlib.h>  // calloc, free, malloc, realloc
+#include <string.h>  // memcpy, memset, strcmp, strlen, memchr
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // CreateFileA, CreateFileMappingA, MapViewOfFile, etc.
+
+#define BUT_RESULTS_ALIGNMENT   8         ///< the alignment of every record
+#define BUT_RESULTS_MAX_RECORD  0xfff8u   ///< the largest aligned size in a u16
+#define BUT_RESULTS_BUFFER_SIZE (1 << 20) ///< the size of the writer's stream buffer
+
+static u32 align_record(size_t size) {
+    size_t mask = BUT_RESULTS_ALIGNMENT - 1;
+
+    return (u32)((size + mask) & ~mask);
+}
+
+// FNV-1a
+static u64 hash_text(char const *text) {
+    u64 hash = 0xcbf29ce484222325ull;
+
+    for (; *text != '\0'; text++) {
+        hash ^= (unsigned char)*text;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+bool but_results_create(BUTResultsWriter *writer, char const *path) {
+    BUTResultsHeader header;
+
+    memset(writer, 0, sizeof *writer);
+    if (fopen_s(&writer->out, path, "ab") != 0) {
+        writer->out = NULL;
+        return false;
+    }
+    setvbuf(writer->out, NULL, _IOFBF, BUT_RESULTS_BUFFER_SIZE);
+
+    memset(&header, 0, sizeof header);
+    header.record.type = BUT_RESULTS_HEADER;
+    header.record.size = (u16)sizeof header;
+    header.magic       = BUT_RESULTS_MAGIC;
+    header.version     = BUT_RESULTS_VERSION;
+    fwrite(&header, sizeof header, 1, writer->out);
+
+    return true;
+}
+
+void but_results_close(BUTResultsWriter *writer) {
+    if (writer->out != NULL) {
+        fclose(writer->out);
+    }
+
+    for (u32 i = 0; i < writer->name_capacity; i++) {
+        free(writer->names[i].text);
+    }
+    free(writer->names);
+    memset(writer, 0, sizeof *writer);
+}
+
+// Double the size of the string table.
+static bool grow_names(BUTResultsWriter *writer) {
+    u32             capacity = writer->name_capacity * 2;
+    BUTResultsName *names;
+
+    if (capacity == 0) {
+        capacity = 256;
+    }
+    names = calloc(capacity, sizeof *names);
+    if (names == NULL) {
+        return false;
+    }
+
+    for (u32 i = 0; i < writer->name_capacity; i++) {
+        BUTResultsName *name = &writer->names[i];
+
+        if (name->text != NULL) {
+            u32 slot = (u32)name->hash & (capacity - 1);
+
+            while (names[slot].text != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            names[slot] = *name;
+        }
+    }
+
+    free(writer->names);
+    writer->names         = names;
+    writer->name_capacity = capacity;
+    return true;
+}
+
+// Truncate the length of some text so it fits in a string or output record.
+static size_t fit_text(size_t length) {
+    size_t limit = BUT_RESULTS_MAX_RECORD - sizeof(BUTResultsString) - 1;
+
+    return length < limit ? length : limit;
+}
+
+// Write a string or output record, which have the same layout: a record, a number, and
+// null-terminated text.
+static void write_text(BUTResultsWriter *writer, u16 type, u32 value, char const *text,
+                       size_t length) {
+    static u08 const padding[BUT_RESULTS_ALIGNMENT] = {0};
+    BUTResultsString string;
+    u32              size = align_record(sizeof string + length + 1);
+
+    string.record.type = type;
+    string.record.size = (u16)size;
+    string.id          = value;
+    fwrite(&string, sizeof string, 1, writer->out);
+    fwrite(text, 1, length, writer->out);
+    fwrite(padding, 1, size - sizeof string - length, writer->out);
+}
+
+// Find the number of a string, defining it first if it's new. Strings that are too long
+// for a record are truncated.
+static u32 intern(BUTResultsWriter *writer, char const *text) {
+    u64    hash;
+    u32    slot;
+    size_t length;
+    char  *copy;
+
+    if (text == NULL) {
+        return 0;
+    }
+
+    // Keep the table at most half full.
+    if ((writer->name_count + 1) * 2 > writer->name_capacity && !grow_names(writer)) {
+        return 0;
+    }
+
+    hash = hash_text(text);
+    slot = (u32)hash & (writer->name_capacity - 1);
+    while (writer->names[slot].text != NULL) {
+        BUTResultsName const *name = &writer->names[slot];
+
+        if (name->hash == hash && strcmp(name->text, text) == 0) {
+            return name->id;
+        }
+        slot = (slot + 1) & (writer->name_capacity - 1);
+    }
+
+    length = strlen(text);
+    copy   = malloc(length + 1);
+    if (copy == NULL) {
+        return 0;
+    }
+    memcpy(copy, text, length + 1);
+
+    writer->names[slot].hash = hash;
+    writer->names[slot].text = copy;
+    writer->names[slot].id   = ++writer->name_count;
+    write_text(writer, BUT_RESULTS_STRING, writer->names[slot].id, text,
+               fit_text(length));
+
+    return writer->names[slot].id;
+}
+
+void but_results_write_suite(BUTResultsWriter *writer, char const *suite, u32 count) {
+    BUTResultsSuite record;
+
+    if (writer->out == NULL) {
+        return;
+    }
+
+    memset(&record, 0, sizeof record);
+    record.record.type = BUT_RESULTS_SUITE;
+    record.record.size = (u16)sizeof record;
+    record.suite       = intern(writer, suite);
+    record.count       = count;
+    fwrite(&record, sizeof record, 1, writer->out);
+}
+
+void but_results_write(BUTResultsWriter *writer, BUTResultsEntry const *entry) {
+    BUTResultsCase record;
+
+    if (writer->out == NULL) {
+        return;
+    }
+
+    if (entry->output != NULL) {
+        size_t length = fit_text(strlen(entry->output));
+
+        write_text(writer, BUT_RESULTS_OUTPUT, (u32)length, entry->output, length);
+    }
+
+    memset(&record, 0, sizeof record);
+    record.record.type = BUT_RESULTS_CASE;
+    record.record.size = (u16)sizeof record;
+    record.suite       = intern(writer, entry->suite);
+    record.name        = intern(writer, entry->name);
+    record.index       = entry->index;
+    record.reason      = intern(writer, entry->reason);
+    record.file        = intern(writer, entry->file);
+    record.line        = entry->line;
+    record.status      = (u08)entry->status;
+    record.duration_ns = entry->duration_ns;
+    fwrite(&record, sizeof record, 1, writer->out);
+}
+
+bool but_results_map(BUTResultsLog *log, char const *path) {
+    LARGE_INTEGER size;
+
+    memset(log, 0, sizeof *log);
+    log->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (log->file == INVALID_HANDLE_VALUE) {
+        log->file = NULL;
+        return false;
+    }
+
+    if (!GetFileSizeEx(log->file, &size)) {
+        but_results_unmap(log);
+        return false;
+    }
+
+    // An empty file can't be mapped, but it's a valid log with no results.
+    log->size = (u64)size.QuadPart;
+    if (log->size > 0) {
+        log->mapping = CreateFileMappingA(log->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (log->mapping != NULL) {
+            log->base = MapViewOfFile(log->mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (log->base == NULL) {
+            but_results_unmap(log);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void but_results_unmap(BUTResultsLog *log) {
+    if (log->base != NULL) {
+        UnmapViewOfFile(log->base);
+    }
+    if (log->mapping != NULL) {
+        CloseHandle(log->mapping);
+    }
+    if (log->file != NULL) {
+        CloseHandle(log->file);
+    }
+    free((void *)log->strings);
+    memset(log, 0, sizeof *log);
+}
+
+// Record where a string is, so case records can refer to it. Writers number strings in
+// order, so a number more than one past the highest so far is corrupt; accepting it
+// would size the table by whatever a damaged record holds.
+static bool define_string(BUTResultsLog *log, BUTResultsString const *string) {
+    char const *text   = (char const *)(string + 1);
+    size_t      length = string->record.size - sizeof *string;
+
+    if (string->id == 0 || string->id > (u64)log->string_count + 1
+        || memchr(text, '\0', length) == NULL) {
+        return false;
+    }
+
+    if (string->id >= log->string_capacity) {
+        u64          capacity = log->string_capacity == 0 ? 256 : log->string_capacity;
+        char const **strings;
+
+        while (capacity <= string->id) {
+            capacity *= 2;
+        }
+        strings = realloc((void *)log->strings, (size_t)capacity * sizeof *strings);
+        if (strings == NULL) {
+            return false;
+        }
+        memset((void *)&strings[log->string_capacity], 0,
+               (size_t)(capacity - log->string_capacity) * sizeof *strings);
+        log->strings         = strings;
+        log->string_capacity = (u32)capacity;
+    }
+
+    log->strings[string->id] = text;
+    if (string->id > log->string_count) {
+        log->string_count = string->id;
+    }
+    return true;
+}
+
+// Resolve a string's number, or return NULL for zero or a number that isn't defined.
+static char const *lookup(BUTResultsLog const *log, u32 id) {
+    return id < log->string_capacity ? log->strings[id] : NULL;
+}
+
+bool but_results_next(BUTResultsLog *log, BUTResultsEntry *entry) {
+    while (log->offset + sizeof(BUTResultsRecord) <= log->size) {
+        BUTResultsRecord const *record;
+
+        record = (BUTResultsRecord const *)(log->base + log->offset);
+
+        if (record->size < sizeof *record || record->size % BUT_RESULTS_ALIGNMENT != 0
+            || log->offset + record->size > log->size) {
+            log->corrupt = true;
+            return false;
+        }
+        log->offset += record->size;
+
+        if (record->type == BUT_RESULTS_HEADER) {
+            BUTResultsHeader const *header = (BUTResultsHeader const *)record;
+
+            if (record->size < sizeof *header || header->magic != BUT_RESULTS_MAGIC) {
+                log->corrupt = true;
+                return false;
+            }
+            // The strings and suite of the previous writer go out of scope.
+            if (log->strings != NULL) {
+                memset((void *)log->strings, 0,
+                       log->string_capacity * sizeof *log->strings);
+            }
+            log->string_count = 0;
+            log->suite        = 0;
+            log->suite_size   = 0;
+            log->output       = NULL;
+        } else if (record->type == BUT_RESULTS_STRING) {
+            if (record->size <= sizeof(BUTResultsString)
+                || !define_string(log, (BUTResultsString const *)record)) {
+                log->corrupt = true;
+                return false;
+            }
+        } else if (record->type == BUT_RESULTS_SUITE
+                   && record->size >= sizeof(BUTResultsSuite)) {
+            BUTResultsSuite const *suite = (BUTResultsSuite const *)record;
+
+            log->suite      = suite->suite;
+            log->suite_size = suite->count;
+            if (log->on_suite != NULL) {
+                char const *name = lookup(log, suite->suite);
+
+                log->on_suite(log->on_suite_data, name != NULL ? name : "?",
+                              suite->count);
+            }
+        } else if (record->type == BUT_RESULTS_OUTPUT) {
+            BUTResultsOutput const *output = (BUTResultsOutput const *)record;
+
+            if (record->size <= sizeof *output
+                || output->length >= record->size - sizeof *output
+                || ((char const *)(output + 1))[output->length] != '\0') {
+                log->corrupt = true;
+                return false;
+            }
+            log->output = (char const *)(output + 1);
+        } else if (record->type == BUT_RESULTS_CASE
+                   && record->size >= sizeof(BUTResultsCase)) {
+            BUTResultsCase const *result = (BUTResultsCase const *)record;
+
+            entry->suite       = lookup(log, result->suite);
+            entry->name        = lookup(log, result->name);
+            entry->reason      = lookup(log, result->reason);
+            entry->file        = lookup(log, result->file);
+            entry->index       = result->index;
+            entry->line        = result->line;
+            entry->suite_size  = result->suite == log->suite ? log->suite_size : 0;
+            entry->output      = log->output;
+            log->output        = NULL;
+            entry->status      = (BUTResultCode)result->status;
+            entry->duration_ns = result->duration_ns;
+            if (entry->suite == NULL) {
+                entry->suite = "?";
+            }
+            if (entry->name == NULL) {
+                entry->name = "?";
+            }
+            return true;
+        }
+    }
+
+    // Trailing bytes too short for a record mean the writer was interrupted.
+    if (log->offset != log->size) {
+        log->corrupt = true;
+    }
+
+    return false;
+}
+
+char const *but_results_status_name(BUTResultCode status) {
+    switch (status) {
+    case BUT_PASSED:
+        return "passed";
+    case BUT_FAILED:
+        return "failed";
+    case BUT_FAILED_SETUP:
+        return "setup failed";
+    case BUT_FAILED_CLEANUP:
+        return "cleanup failed";
+    case BUT_NOT_RUN:
+        return "not run";
+    default:
+        return "unknown";
+    }
+}
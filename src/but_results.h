@@ -0,0 +1,255 @@
+#ifndef BUT_RESULTS_H_
+#define BUT_RESULTS_H_
+
+/**
+ * @file but_results.h
+ * @author Douglas Cuthbertson
+ * @brief A compact, append-only binary log of test results.
+ * @version 0.1
+ * @date 2025-09-25
+ *
+ * A log is a sequence of records, each starting with its type and size, padded so every
+ * record is 8-byte aligned. A writer starts with a header record, defines each string
+ * once in a string record before its first use, and then refers to it by a number, so
+ * a case record has a fixed size. String numbers are scoped to the records that follow
+ * a header, which makes the concatenation of two logs a valid log: merging shards is
+ * just appending their files. Readers map a log into memory and walk it in place; they
+ * skip record types they don't know and bytes at the end of records that are longer
+ * than they expect, so later versions can add fields.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_context.h" // BUTResultCode
+
+#include <abbreviated_types.h> // u08, u16, u32, u64
+
+#include <stdbool.h> // bool
+#include <stdio.h>   // FILE
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // HANDLE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_RESULTS_MAGIC   0x52545542u ///< "BUTR" in a little-endian u32
+#define BUT_RESULTS_VERSION 1           ///< the version of the format written
+
+/**
+ * @brief the types of the records in a log.
+ */
+typedef enum BUTResultsRecordType {
+    BUT_RESULTS_HEADER = 1, ///< starts a log, and a new set of strings
+    BUT_RESULTS_STRING = 2, ///< defines a string
+    BUT_RESULTS_CASE   = 3, ///< the result of a test case
+    BUT_RESULTS_SUITE  = 4, ///< the start of a test suite
+    BUT_RESULTS_OUTPUT = 5, ///< what the test case that follows it printed
+} BUTResultsRecordType;
+
+/**
+ * @brief the start of every record.
+ */
+typedef struct BUTResultsRecord {
+    u16 type; ///< a BUTResultsRecordType
+    u16 size; ///< the size of the record in bytes, including padding; a multiple of 8
+} BUTResultsRecord;
+
+/**
+ * @brief the first record written by each writer.
+ */
+typedef struct BUTResultsHeader {
+    BUTResultsRecord record;  ///< BUT_RESULTS_HEADER
+    u32              magic;   ///< BUT_RESULTS_MAGIC
+    u32              version; ///< the version of the writer
+    u32              reserved;
+} BUTResultsHeader;
+
+/**
+ * @brief a string definition. The string, with its terminating null, follows it.
+ */
+typedef struct BUTResultsString {
+    BUTResultsRecord record; ///< BUT_RESULTS_STRING
+    u32              id;     ///< the number that refers to the string; never zero
+} BUTResultsString;
+
+/**
+ * @brief the result of a test case. Strings are referred to by number, and zero means
+ * there is none.
+ */
+typedef struct BUTResultsCase {
+    BUTResultsRecord record;      ///< BUT_RESULTS_CASE
+    u32              suite;       ///< the name of the test suite
+    u32              name;        ///< the name of the test case
+    u32              index;       ///< the index of the test case in its suite
+    u32              reason;      ///< the reason it failed
+    u32              file;        ///< the file in which it failed
+    u32              line;        ///< the line on which it failed
+    u08              status;      ///< a BUTResultCode
+    u08              reserved[3]; ///< zero
+    u64              duration_ns; ///< from the start of its setup to its cleanup's end
+} BUTResultsCase;
+
+/**
+ * @brief the start of a test suite, written before the results of its cases so a reader
+ * can tell which cases are missing from a partial or sharded run.
+ */
+typedef struct BUTResultsSuite {
+    BUTResultsRecord record;   ///< BUT_RESULTS_SUITE
+    u32              suite;    ///< the name of the test suite
+    u32              count;    ///< the number of test cases in the suite
+    u32              reserved; ///< zero
+} BUTResultsSuite;
+
+/**
+ * @brief the output of the test case whose result is the next case record. The text,
+ * with its terminating null, follows it.
+ */
+typedef struct BUTResultsOutput {
+    BUTResultsRecord record; ///< BUT_RESULTS_OUTPUT
+    u32              length; ///< the length of the text, which may have been truncated
+} BUTResultsOutput;
+
+/**
+ * @brief a test result with its strings resolved.
+ */
+typedef struct BUTResultsEntry {
+    char const   *suite;       ///< the name of the test suite
+    char const   *name;        ///< the name of the test case
+    char const   *reason;      ///< the reason it failed, or NULL
+    char const   *file;        ///< the file in which it failed, or NULL
+    char const   *output;      ///< what it printed, if that was captured, or NULL
+    u32           index;       ///< the index of the test case in its suite
+    u32           line;        ///< the line on which it failed
+    u32           suite_size;  ///< the number of cases in the suite, or 0 if unknown
+    BUTResultCode status;      ///< whether it passed
+    u64           duration_ns; ///< from the start of its setup to the end of its cleanup
+} BUTResultsEntry;
+
+/**
+ * @brief a string the writer has defined.
+ */
+typedef struct BUTResultsName {
+    u64   hash; ///< the hash of text
+    char *text; ///< a copy of the string, or NULL if the slot is empty
+    u32   id;   ///< the number that refers to it
+} BUTResultsName;
+
+/**
+ * @brief a log being written.
+ */
+typedef struct BUTResultsWriter {
+    FILE           *out;           ///< the log, or NULL
+    BUTResultsName *names;         ///< a hash table of the strings defined so far
+    u32             name_count;    ///< the number of strings defined
+    u32             name_capacity; ///< the number of slots in names; a power of 2
+} BUTResultsWriter;
+
+/**
+ * @brief a function a reader calls for each suite record it passes.
+ *
+ * @param data the log's on_suite_data.
+ * @param suite the name of the suite, or "?" if it isn't defined. It points into the
+ * mapping.
+ * @param count the number of test cases in the suite.
+ */
+typedef void but_results_suite_fn(void *data, char const *suite, u32 count);
+
+/**
+ * @brief a log mapped into memory to be read.
+ */
+typedef struct BUTResultsLog {
+    HANDLE       file;            ///< the log file
+    HANDLE       mapping;         ///< the mapping of the file, or NULL if it's empty
+    u08 const   *base;            ///< the first byte of the log
+    u64          size;            ///< the size of the log in bytes
+    u64          offset;          ///< the offset of the next record
+    char const **strings;         ///< the strings defined since the last header, by id
+    u32          string_capacity; ///< the number of entries in strings
+    u32          string_count;    ///< the highest string number since the last header
+    u32          suite;           ///< the string number of the last suite started
+    u32          suite_size;      ///< the number of cases in that suite
+    char const  *output;          ///< the output for the next case record, or NULL
+    bool         corrupt;         ///< true if reading stopped at a malformed record
+
+    // Set by the caller after but_results_map, which clears them.
+    but_results_suite_fn *on_suite;      ///< called for each suite record, or NULL
+    void                 *on_suite_data; ///< passed to on_suite
+} BUTResultsLog;
+
+/**
+ * @brief open a log for appending and write a header. Appending to an existing log adds
+ * to it, just like concatenating two logs.
+ *
+ * @param writer the writer.
+ * @param path the log file.
+ * @return true if the log was opened, and false otherwise.
+ */
+bool but_results_create(BUTResultsWriter *writer, char const *path);
+
+/**
+ * @brief record the start of a test suite.
+ *
+ * @param writer a writer opened by but_results_create.
+ * @param suite the name of the suite.
+ * @param count the number of test cases in the suite.
+ */
+void but_results_write_suite(BUTResultsWriter *writer, char const *suite, u32 count);
+
+/**
+ * @brief write the result of a test case.
+ *
+ * @param writer a writer opened by but_results_create.
+ * @param entry the result.
+ */
+void but_results_write(BUTResultsWriter *writer, BUTResultsEntry const *entry);
+
+/**
+ * @brief close a log and release the writer's resources.
+ *
+ * @param writer a writer opened by but_results_create.
+ */
+void but_results_close(BUTResultsWriter *writer);
+
+/**
+ * @brief map a log into memory to read it. Set on_suite after mapping the log to see
+ * every suite it starts, including those with no case records.
+ *
+ * @param log the reader.
+ * @param path the log file.
+ * @return true if the log was mapped, and false otherwise.
+ */
+bool but_results_map(BUTResultsLog *log, char const *path);
+
+/**
+ * @brief read the next test result from a log.
+ *
+ * @param log a log mapped by but_results_map.
+ * @param entry receives the result. Its strings point into the mapping.
+ * @return true if a result was read, and false at the end of the log or at a malformed
+ * record, in which case log->corrupt is set.
+ */
+bool but_results_next(BUTResultsLog *log, BUTResultsEntry *entry);
+
+/**
+ * @brief unmap a log and release the reader's resources.
+ *
+ * @param log a log mapped by but_results_map.
+ */
+void but_results_unmap(BUTResultsLog *log);
+
+/**
+ * @brief name a result code.
+ *
+ * @param status a result code.
+ * @return a short, lowercase name such as "passed" or "setup failed".
+ */
+char const *but_results_status_name(BUTResultCode status);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_RESULTS_H_
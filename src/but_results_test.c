@@ -0,0 +1,290 @@
+/**
+ * @file but_results_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of writing and reading the binary results log.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * Each test writes a log to a file in the current directory and maps it back. The tests
+ * of damaged logs build their records by hand, using align_record from but_results.c,
+ * so this file is included after it.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_results.h" // but_results_create, but_results_map, but_results_next, etc.
+
+#include <abbreviated_types.h> // u08, u16, u32
+#include <but.h>               // BUT_TEST_SETUP_CLEANUP
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_STREQ, etc.
+#include <but_macros.h>        // BUT_UNUSED
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, fopen_s, fwrite, fclose, remove
+#include <string.h>  // memcpy, memset, strlen
+
+#define RESULTS_TEST_PATH "but_butts_results.bin"
+
+// The log the current test reads, so cleanup can unmap it when an assertion fails.
+static BUTResultsLog g_results_log_;
+
+// Bytes of a hand-built log.
+typedef struct RawLog {
+    u08    bytes[512];
+    size_t size;
+} RawLog;
+
+static BUT_SETUP_FN(set_up_results_log) {
+    BUT_UNUSED(btc);
+    memset(&g_results_log_, 0, sizeof g_results_log_);
+    remove(RESULTS_TEST_PATH);
+}
+
+static BUT_CLEANUP_FN(cleanup_results_log) {
+    BUT_UNUSED(btc);
+    but_results_unmap(&g_results_log_);
+    remove(RESULTS_TEST_PATH);
+}
+
+static void raw_append(RawLog *raw, void const *bytes, size_t size) {
+    BUT_ASSERT_TRUE(raw->size + size <= sizeof raw->bytes);
+    memcpy(&raw->bytes[raw->size], bytes, size);
+    raw->size += size;
+}
+
+static void raw_header(RawLog *raw) {
+    BUTResultsHeader header;
+
+    memset(&header, 0, sizeof header);
+    header.record.type = BUT_RESULTS_HEADER;
+    header.record.size = (u16)sizeof header;
+    header.magic       = BUT_RESULTS_MAGIC;
+    header.version     = BUT_RESULTS_VERSION;
+    raw_append(raw, &header, sizeof header);
+}
+
+// Append a string or output record, which share a layout.
+static void raw_text(RawLog *raw, u16 type, u32 value, char const *text) {
+    static u08 const padding[8] = {0};
+    BUTResultsString string;
+    size_t           length = strlen(text);
+    u32              size   = align_record(sizeof string + length + 1);
+
+    string.record.type = type;
+    string.record.size = (u16)size;
+    string.id          = value;
+    raw_append(raw, &string, sizeof string);
+    raw_append(raw, text, length);
+    raw_append(raw, padding, size - sizeof string - length);
+}
+
+static void raw_case(RawLog *raw, u32 suite, u32 name) {
+    BUTResultsCase result;
+
+    memset(&result, 0, sizeof result);
+    result.record.type = BUT_RESULTS_CASE;
+    result.record.size = (u16)sizeof result;
+    result.suite       = suite;
+    result.name        = name;
+    result.status      = (u08)BUT_PASSED;
+    raw_append(raw, &result, sizeof result);
+}
+
+// Write a hand-built log and map it.
+static void map_raw(RawLog const *raw) {
+    FILE *out = NULL;
+
+    but_results_unmap(&g_results_log_);
+    BUT_ASSERT_TRUE(fopen_s(&out, RESULTS_TEST_PATH, "wb") == 0);
+    fwrite(raw->bytes, 1, raw->size, out);
+    fclose(out);
+    BUT_ASSERT_TRUE(but_results_map(&g_results_log_, RESULTS_TEST_PATH));
+}
+
+// Verify a case's strings, status, output, and suite size survive a write and a read.
+BUT_TEST_SETUP_CLEANUP("Results Round Trip", results_round_trip, set_up_results_log,
+                       cleanup_results_log) {
+    BUTResultsWriter writer;
+    BUTResultsEntry  entry;
+
+    BUT_ASSERT_TRUE(but_results_create(&writer, RESULTS_TEST_PATH));
+    but_results_write_suite(&writer, "Round Trip", 2);
+    memset(&entry, 0, sizeof entry);
+    entry.suite       = "Round Trip";
+    entry.name        = "passes";
+    entry.output      = "hello\n";
+    entry.status      = BUT_PASSED;
+    entry.duration_ns = 1234;
+    but_results_write(&writer, &entry);
+    memset(&entry, 0, sizeof entry);
+    entry.suite  = "Round Trip";
+    entry.name   = "fails";
+    entry.index  = 1;
+    entry.reason = "boom";
+    entry.file   = "round_trip.c";
+    entry.line   = 42;
+    entry.status = BUT_FAILED;
+    but_results_write(&writer, &entry);
+    but_results_close(&writer);
+
+    BUT_ASSERT_TRUE(but_results_map(&g_results_log_, RESULTS_TEST_PATH));
+
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.suite, "Round Trip");
+    BUT_ASSERT_STREQ(entry.name, "passes");
+    BUT_ASSERT_STREQ(entry.output, "hello\n");
+    BUT_ASSERT_NULL(entry.reason);
+    BUT_ASSERT_NULL(entry.file);
+    BUT_ASSERT_EQ_UINT32(entry.index, 0);
+    BUT_ASSERT_EQ_UINT32(entry.suite_size, 2);
+    BUT_ASSERT_TRUE(entry.status == BUT_PASSED);
+    BUT_ASSERT_TRUE(entry.duration_ns == 1234);
+
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.name, "fails");
+    BUT_ASSERT_STREQ(entry.reason, "boom");
+    BUT_ASSERT_STREQ(entry.file, "round_trip.c");
+    BUT_ASSERT_NULL(entry.output);
+    BUT_ASSERT_EQ_UINT32(entry.index, 1);
+    BUT_ASSERT_EQ_UINT32(entry.line, 42);
+    BUT_ASSERT_TRUE(entry.status == BUT_FAILED);
+
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(!g_results_log_.corrupt);
+}
+
+// Verify appending a second writer's log starts a new set of string numbers, so each
+// log's numbers resolve to its own strings.
+BUT_TEST_SETUP_CLEANUP("Results Concatenated Logs", results_concatenated,
+                       set_up_results_log, cleanup_results_log) {
+    BUTResultsWriter writer;
+    BUTResultsEntry  entry;
+
+    BUT_ASSERT_TRUE(but_results_create(&writer, RESULTS_TEST_PATH));
+    but_results_write_suite(&writer, "First", 1);
+    memset(&entry, 0, sizeof entry);
+    entry.suite  = "First";
+    entry.name   = "one";
+    entry.status = BUT_PASSED;
+    but_results_write(&writer, &entry);
+    but_results_close(&writer);
+
+    BUT_ASSERT_TRUE(but_results_create(&writer, RESULTS_TEST_PATH));
+    but_results_write_suite(&writer, "Second", 3);
+    memset(&entry, 0, sizeof entry);
+    entry.suite  = "Second";
+    entry.name   = "two";
+    entry.reason = "boom";
+    entry.status = BUT_FAILED;
+    but_results_write(&writer, &entry);
+    but_results_close(&writer);
+
+    BUT_ASSERT_TRUE(but_results_map(&g_results_log_, RESULTS_TEST_PATH));
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.suite, "First");
+    BUT_ASSERT_STREQ(entry.name, "one");
+    BUT_ASSERT_EQ_UINT32(entry.suite_size, 1);
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.suite, "Second");
+    BUT_ASSERT_STREQ(entry.name, "two");
+    BUT_ASSERT_STREQ(entry.reason, "boom");
+    BUT_ASSERT_EQ_UINT32(entry.suite_size, 3);
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(!g_results_log_.corrupt);
+}
+
+// Verify a truncated record, a misaligned size, and string numbers that are zero or
+// skip ahead stop reading and mark the log corrupt. A huge number must be rejected
+// before it sizes the string table.
+BUT_TEST_SETUP_CLEANUP("Results Damaged Logs", results_damaged, set_up_results_log,
+                       cleanup_results_log) {
+    static u32 const bad_ids[] = {0, 2, 0x80000000u, 0xffffffffu};
+    BUTResultsEntry  entry;
+    RawLog           raw;
+    BUTResultsRecord record;
+
+    // A case record cut short by an interrupted writer.
+    memset(&raw, 0, sizeof raw);
+    raw_header(&raw);
+    raw_text(&raw, BUT_RESULTS_STRING, 1, "suite");
+    raw_case(&raw, 1, 1);
+    raw_case(&raw, 1, 1);
+    raw.size -= sizeof(BUTResultsCase) / 2;
+    map_raw(&raw);
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(g_results_log_.corrupt);
+
+    // A record whose size isn't a multiple of the alignment.
+    memset(&raw, 0, sizeof raw);
+    raw_header(&raw);
+    record.type = BUT_RESULTS_CASE;
+    record.size = 12;
+    raw_append(&raw, &record, sizeof record);
+    raw_append(&raw, &record, sizeof record);
+    raw_append(&raw, &record, sizeof record);
+    raw_append(&raw, &record, sizeof record);
+    map_raw(&raw);
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(g_results_log_.corrupt);
+
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(bad_ids); i++) {
+        memset(&raw, 0, sizeof raw);
+        raw_header(&raw);
+        raw_text(&raw, BUT_RESULTS_STRING, bad_ids[i], "bad");
+        raw_case(&raw, bad_ids[i], bad_ids[i]);
+        map_raw(&raw);
+        BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+        BUT_ASSERT_TRUE(g_results_log_.corrupt);
+        BUT_ASSERT_TRUE(g_results_log_.string_capacity <= 256);
+    }
+}
+
+// Verify records of unknown types are skipped, and an output record is attached to the
+// case that follows it and no other.
+BUT_TEST_SETUP_CLEANUP("Results Skipped Records", results_skipped, set_up_results_log,
+                       cleanup_results_log) {
+    BUTResultsEntry  entry;
+    RawLog           raw;
+    BUTResultsSuite  unknown;
+    BUTResultsOutput empty;
+
+    memset(&raw, 0, sizeof raw);
+    raw_header(&raw);
+    memset(&unknown, 0, sizeof unknown);
+    unknown.record.type = 99;
+    unknown.record.size = (u16)sizeof unknown;
+    unknown.count       = 0xffffffffu;
+    raw_append(&raw, &unknown, sizeof unknown);
+    raw_text(&raw, BUT_RESULTS_STRING, 1, "suite");
+    raw_text(&raw, BUT_RESULTS_STRING, 2, "first");
+    raw_text(&raw, BUT_RESULTS_STRING, 3, "second");
+    raw_text(&raw, BUT_RESULTS_OUTPUT, 6, "output");
+    raw_append(&raw, &unknown, sizeof unknown);
+    raw_case(&raw, 1, 2);
+    raw_case(&raw, 1, 3);
+    raw_append(&raw, &unknown, sizeof unknown);
+    map_raw(&raw);
+
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.suite, "suite");
+    BUT_ASSERT_STREQ(entry.name, "first");
+    BUT_ASSERT_STREQ(entry.output, "output");
+    BUT_ASSERT_TRUE(but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_STREQ(entry.name, "second");
+    BUT_ASSERT_NULL(entry.output);
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(!g_results_log_.corrupt);
+
+    // An output record whose length runs past its text is corrupt.
+    memset(&raw, 0, sizeof raw);
+    raw_header(&raw);
+    memset(&empty, 0, sizeof empty);
+    empty.record.type = BUT_RESULTS_OUTPUT;
+    empty.record.size = 16;
+    empty.length      = 100;
+    raw_append(&raw, &empty, sizeof empty);
+    raw_append(&raw, "12345678", 8);
+    map_raw(&raw);
+    BUT_ASSERT_TRUE(!but_results_next(&g_results_log_, &entry));
+    BUT_ASSERT_TRUE(g_results_log_.corrupt);
+}
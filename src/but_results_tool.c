@@ -0,0 +1,550 @@
+/**
+ * @file but_results_tool.c
+ * @author Douglas Cuthbertson
+ * @brief The commands of but_results: summarize, filter, compare, and merge result logs.
+ * @version 0.1
+ * @date 2025-09-25
+ *
+ * It uses hash_text from but_results.c, so it's included after it.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_results_tool.h"
+#include "but_results.h" // but_results_map, but_results_next, but_results_unmap, etc.
+
+#include <abbreviated_types.h> // u32, u64
+
+#include <inttypes.h> // PRIu64
+#include <stdbool.h>  // bool, true, false
+#include <stdio.h>    // FILE, fprintf
+#include <stdlib.h>   // calloc, exit, free, qsort, realloc
+#include <string.h>   // memset, strcmp, strcspn, strncmp, strstr
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetLastError
+
+#define MAX_STATUS        (BUT_NOT_RUN + 1) ///< the number of result codes
+#define SUMMARY_TOP_COUNT 10                ///< the most reasons and suites listed
+
+/**
+ * @brief a pair of strings and the results tallied for them.
+ */
+typedef struct Tally {
+    char const   *first;       ///< a suite or a reason, or NULL if the slot is empty
+    char const   *second;      ///< a test case, or NULL
+    u64           count;       ///< the number of results
+    u64           failures;    ///< the number of results that weren't passes
+    u64           duration_ns; ///< their total duration
+    BUTResultCode status;      ///< the status of the last result
+    int           source;      ///< the log the first result was read from
+    u32           size;        ///< the number of cases in a suite, if known
+    bool         *seen;        ///< which of a suite's cases have a result
+} Tally;
+
+/**
+ * @brief a hash table of tallies, keyed by their strings' contents.
+ */
+typedef struct TallyTable {
+    Tally *slots;    ///< the tallies
+    u32    count;    ///< the number of slots in use
+    u32    capacity; ///< the number of slots; a power of 2
+} TallyTable;
+
+static u64 hash_pair(char const *first, char const *second) {
+    u64 hash = hash_text(first);
+
+    if (second != NULL) {
+        hash = (hash ^ hash_text(second)) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static bool same_pair(Tally const *tally, char const *first, char const *second) {
+    if (strcmp(tally->first, first) != 0) {
+        return false;
+    } else if (second == NULL || tally->second == NULL) {
+        return second == tally->second;
+    }
+
+    return strcmp(tally->second, second) == 0;
+}
+
+static Tally *find_slot(Tally *slots, u32 capacity, char const *first,
+                        char const *second) {
+    u32 slot = (u32)hash_pair(first, second) & (capacity - 1);
+
+    while (slots[slot].first != NULL && !same_pair(&slots[slot], first, second)) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+
+    return &slots[slot];
+}
+
+// Find the tally for a pair of strings, adding it if it's new. Exits if memory runs out.
+static Tally *tally(TallyTable *table, char const *first, char const *second) {
+    Tally *found;
+
+    if ((table->count + 1) * 2 > table->capacity) {
+        u32    capacity = table->capacity == 0 ? 1024 : table->capacity * 2;
+        Tally *slots    = calloc(capacity, sizeof *slots);
+
+        if (slots == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            exit(1);
+        }
+        for (u32 i = 0; i < table->capacity; i++) {
+            if (table->slots[i].first != NULL) {
+                *find_slot(slots, capacity, table->slots[i].first,
+                           table->slots[i].second)
+                    = table->slots[i];
+            }
+        }
+        free(table->slots);
+        table->slots    = slots;
+        table->capacity = capacity;
+    }
+
+    found = find_slot(table->slots, table->capacity, first, second);
+    if (found->first == NULL) {
+        found->first  = first;
+        found->second = second;
+        table->count++;
+    }
+
+    return found;
+}
+
+// Find the tally for a pair of strings, or NULL if there isn't one.
+static Tally *lookup_tally(TallyTable const *table, char const *first,
+                           char const *second) {
+    Tally *found;
+
+    if (table->capacity == 0) {
+        return NULL;
+    }
+
+    found = find_slot(table->slots, table->capacity, first, second);
+    return found->first != NULL ? found : NULL;
+}
+
+// Order tallies with the most failures first, then the most results.
+static int compare_tallies(void const *a, void const *b) {
+    Tally const *lhs = a;
+    Tally const *rhs = b;
+
+    if (lhs->failures != rhs->failures) {
+        return lhs->failures < rhs->failures ? 1 : -1;
+    }
+    if (lhs->count != rhs->count) {
+        return lhs->count < rhs->count ? 1 : -1;
+    }
+
+    return 0;
+}
+
+// Print the tallies with the most failures, and release the table.
+static void print_top(FILE *out, char const *title, TallyTable *table) {
+    u32 used = 0;
+
+    for (u32 i = 0; i < table->capacity; i++) {
+        if (table->slots[i].first != NULL) {
+            table->slots[used++] = table->slots[i];
+        }
+    }
+    qsort(table->slots, used, sizeof *table->slots, compare_tallies);
+
+    if (used > 0) {
+        fprintf(out, "\n%s:\n", title);
+    }
+    for (u32 i = 0; i < used && i < SUMMARY_TOP_COUNT; i++) {
+        Tally const *t = &table->slots[i];
+
+        fprintf(out, "  %8" PRIu64 " of %8" PRIu64 " failed, %10.3f ms  %s\n",
+                t->failures, t->count, (double)t->duration_ns / 1e6, t->first);
+    }
+    if (used > SUMMARY_TOP_COUNT) {
+        fprintf(out, "  ... and %u more\n", used - SUMMARY_TOP_COUNT);
+    }
+
+    free(table->slots);
+    memset(table, 0, sizeof *table);
+}
+
+/**
+ * @brief the logs named on the command line, mapped together.
+ */
+typedef struct LogSet {
+    BUTResultsLog *logs;    ///< the logs
+    int            count;   ///< the number of logs
+    int            current; ///< the log being read
+} LogSet;
+
+static bool open_logs(LogSet *set, char **paths, int count) {
+    set->logs    = calloc(count > 0 ? count : 1, sizeof *set->logs);
+    set->count   = 0;
+    set->current = 0;
+    if (set->logs == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!but_results_map(&set->logs[i], paths[i])) {
+            fprintf(stderr, "Error: failed to read %s, error = %lu\n", paths[i],
+                    GetLastError());
+            return false;
+        }
+        set->count++;
+    }
+
+    return true;
+}
+
+static void close_logs(LogSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        but_results_unmap(&set->logs[i]);
+    }
+    free(set->logs);
+}
+
+// Read the next result from the set, warning about a log that's cut short.
+static bool next_entry(LogSet *set, char **paths, BUTResultsEntry *entry) {
+    while (set->current < set->count) {
+        BUTResultsLog *log = &set->logs[set->current];
+
+        if (but_results_next(log, entry)) {
+            return true;
+        }
+        if (log->corrupt) {
+            fprintf(stderr, "Warning: %s is malformed after byte %" PRIu64 "\n",
+                    paths[set->current], log->offset);
+        }
+        set->current++;
+    }
+
+    return false;
+}
+
+int but_results_summary(FILE *out, char **paths, int count) {
+    LogSet          set;
+    BUTResultsEntry entry;
+    TallyTable      suites             = {0};
+    TallyTable      reasons            = {0};
+    u64             totals[MAX_STATUS] = {0};
+    u64             results            = 0;
+    u64             duration_ns        = 0;
+    u64             failures;
+
+    if (!open_logs(&set, paths, count)) {
+        close_logs(&set);
+        return 1;
+    }
+
+    while (next_entry(&set, paths, &entry)) {
+        Tally *suite = tally(&suites, entry.suite, NULL);
+
+        results++;
+        duration_ns += entry.duration_ns;
+        if ((u32)entry.status < MAX_STATUS) {
+            totals[entry.status]++;
+        }
+        suite->count++;
+        suite->duration_ns += entry.duration_ns;
+        if (entry.status != BUT_PASSED) {
+            char const *text   = entry.reason != NULL ? entry.reason : "?";
+            Tally      *reason = tally(&reasons, text, NULL);
+
+            suite->failures++;
+            reason->count++;
+            reason->failures++;
+            reason->duration_ns += entry.duration_ns;
+        }
+    }
+
+    fprintf(out, "%" PRIu64 " results in %.3f ms\n", results, (double)duration_ns / 1e6);
+    for (u32 i = 0; i < MAX_STATUS; i++) {
+        if (totals[i] > 0) {
+            fprintf(out, "  %-15s %" PRIu64 "\n",
+                    but_results_status_name((BUTResultCode)i), totals[i]);
+        }
+    }
+    print_top(out, "Suites", &suites);
+    print_top(out, "Reasons", &reasons);
+
+    close_logs(&set);
+    failures = totals[BUT_FAILED] + totals[BUT_FAILED_SETUP];
+    failures += totals[BUT_FAILED_CLEANUP];
+    return failures > 0;
+}
+
+static void print_entry(FILE *out, char const *prefix, BUTResultsEntry const *entry) {
+    fprintf(out, "%s%s: %s: %s", prefix, entry->suite, entry->name,
+            but_results_status_name(entry->status));
+    if (entry->reason != NULL) {
+        fprintf(out, ": %s", entry->reason);
+    }
+    if (entry->file != NULL) {
+        fprintf(out, " @%s:%u", entry->file, entry->line);
+    }
+    fprintf(out, " (%.3f ms)\n", (double)entry->duration_ns / 1e6);
+
+    // Indent the captured output under the result.
+    for (char const *output = entry->output; output != NULL && *output != '\0';) {
+        size_t length = strcspn(output, "\r\n");
+
+        fprintf(out, "    | %.*s\n", (int)length, output);
+        output += length;
+        if (*output == '\r') {
+            output++;
+        }
+        if (*output == '\n') {
+            output++;
+        }
+    }
+}
+
+// Parse a status name given to --status.
+static bool parse_status(char const *name, BUTResultCode *status) {
+    for (u32 i = 0; i < MAX_STATUS; i++) {
+        if (strcmp(name, but_results_status_name((BUTResultCode)i)) == 0) {
+            *status = (BUTResultCode)i;
+            return true;
+        }
+    }
+
+    // Accept the single-word forms, too.
+    if (strcmp(name, "setup") == 0) {
+        *status = BUT_FAILED_SETUP;
+        return true;
+    } else if (strcmp(name, "cleanup") == 0) {
+        *status = BUT_FAILED_CLEANUP;
+        return true;
+    }
+
+    return false;
+}
+
+int but_results_filter(FILE *out, char **args, int count) {
+    LogSet          set;
+    BUTResultsEntry entry;
+    BUTResultCode   status     = BUT_PASSED;
+    bool            any_status = true;
+    char const     *suite      = NULL;
+    char const     *reason     = NULL;
+    int             i          = 0;
+
+    for (; i + 1 < count && strncmp(args[i], "--", 2) == 0; i += 2) {
+        if (strcmp(args[i], "--status") == 0) {
+            if (!parse_status(args[i + 1], &status)) {
+                fprintf(stderr, "Error: unknown status %s\n", args[i + 1]);
+                return 2;
+            }
+            any_status = false;
+        } else if (strcmp(args[i], "--suite") == 0) {
+            suite = args[i + 1];
+        } else if (strcmp(args[i], "--reason") == 0) {
+            reason = args[i + 1];
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", args[i]);
+            return 2;
+        }
+    }
+
+    if (!open_logs(&set, &args[i], count - i)) {
+        close_logs(&set);
+        return 1;
+    }
+
+    while (next_entry(&set, &args[i], &entry)) {
+        if ((any_status || entry.status == status)
+            && (suite == NULL || strcmp(entry.suite, suite) == 0)
+            && (reason == NULL
+                || (entry.reason != NULL && strstr(entry.reason, reason) != NULL))) {
+            print_entry(out, "", &entry);
+        }
+    }
+
+    close_logs(&set);
+    return 0;
+}
+
+int but_results_diff(FILE *out, char **paths) {
+    LogSet          base;
+    LogSet          current;
+    BUTResultsEntry entry;
+    TallyTable      cases       = {0};
+    u64             regressions = 0;
+    bool            opened      = open_logs(&base, &paths[0], 1);
+
+    // Open the second log even if the first failed, so both can be closed.
+    if (!open_logs(&current, &paths[1], 1) || !opened) {
+        close_logs(&base);
+        close_logs(&current);
+        return 1;
+    }
+
+    // A case's count is 1 if it's only in the baseline, and 2 if it's in both logs.
+    while (next_entry(&base, &paths[0], &entry)) {
+        Tally *t = tally(&cases, entry.suite, entry.name);
+
+        t->status = entry.status;
+        t->count  = 1;
+    }
+
+    while (next_entry(&current, &paths[1], &entry)) {
+        Tally *t = lookup_tally(&cases, entry.suite, entry.name);
+
+        if (t == NULL) {
+            print_entry(out, "+ ", &entry);
+            regressions += entry.status != BUT_PASSED;
+        } else {
+            if (t->status != entry.status) {
+                print_entry(out, entry.status == BUT_PASSED ? "fixed " : "broken ",
+                            &entry);
+                regressions += entry.status != BUT_PASSED;
+            }
+            t->count = 2;
+        }
+    }
+
+    for (u32 i = 0; i < cases.capacity; i++) {
+        Tally const *t = &cases.slots[i];
+
+        if (t->first != NULL && t->count == 1) {
+            fprintf(out, "- %s: %s\n", t->first, t->second);
+        }
+    }
+
+    free(cases.slots);
+    close_logs(&base);
+    close_logs(&current);
+    return regressions > 0;
+}
+
+// Make room to record which of a suite's cases ran. Exits if memory runs out.
+static void grow_seen(Tally *suite, u32 size) {
+    bool *seen = realloc(suite->seen, size * sizeof *seen);
+
+    if (seen == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    memset(&seen[suite->size], 0, (size - suite->size) * sizeof *seen);
+    suite->seen = seen;
+    suite->size = size;
+}
+
+// Start checking a suite's cases when a log starts the suite, so a suite that no log has
+// a case result for still has its cases counted as missing.
+static void merge_suite(void *data, char const *name, u32 count) {
+    Tally *suite = tally(data, name, NULL);
+
+    if (count > suite->size) {
+        grow_seen(suite, count);
+    }
+}
+
+int but_results_merge(FILE *out, char **paths, int count) {
+    LogSet           set;
+    BUTResultsEntry  entry;
+    TallyTable       cases              = {0};
+    TallyTable       suites             = {0};
+    BUTResultsEntry *failed             = NULL;
+    u64              failed_count       = 0;
+    u64              failed_capacity    = 0;
+    u64              totals[MAX_STATUS] = {0};
+    u64              runs               = 0;
+    u64              duplicates         = 0;
+    u64              missing            = 0;
+    u64              duration_ns        = 0;
+
+    if (!open_logs(&set, paths, count)) {
+        close_logs(&set);
+        return 1;
+    }
+    for (int i = 0; i < set.count; i++) {
+        set.logs[i].on_suite      = merge_suite;
+        set.logs[i].on_suite_data = &suites;
+    }
+
+    while (next_entry(&set, paths, &entry)) {
+        Tally *c     = tally(&cases, entry.suite, entry.name);
+        Tally *suite = tally(&suites, entry.suite, NULL);
+
+        runs++;
+        if (entry.index < suite->size) {
+            suite->seen[entry.index] = true;
+        }
+
+        if (c->count++ > 0) {
+            fprintf(out, "duplicate %s: %s in %s and %s\n", entry.suite, entry.name,
+                    paths[c->source], paths[set.current]);
+            duplicates++;
+            continue;
+        }
+        c->source = set.current;
+        duration_ns += entry.duration_ns;
+        if ((u32)entry.status < MAX_STATUS) {
+            totals[entry.status]++;
+        }
+        if (entry.status != BUT_PASSED && entry.status != BUT_NOT_RUN) {
+            if (failed_count == failed_capacity) {
+                u64              capacity = failed_capacity * 2 + 64;
+                BUTResultsEntry *grown    = realloc(failed, capacity * sizeof *grown);
+
+                if (grown == NULL) {
+                    fprintf(stderr, "Error: out of memory\n");
+                    exit(1);
+                }
+                failed          = grown;
+                failed_capacity = capacity;
+            }
+            // The strings point into the mapped logs, which stay open until the end.
+            failed[failed_count++] = entry;
+        }
+    }
+
+    for (u32 i = 0; i < suites.capacity; i++) {
+        Tally *suite = &suites.slots[i];
+
+        for (u32 index = 0; suite->first != NULL && index < suite->size; index++) {
+            if (!suite->seen[index]) {
+                fprintf(out, "missing %s: case %u of %u\n", suite->first, index + 1,
+                        suite->size);
+                missing++;
+            }
+        }
+        free(suite->seen);
+    }
+
+    fprintf(out, "%u cases from %d logs in %" PRIu64 " runs, %.3f ms\n", cases.count,
+            count, runs, (double)duration_ns / 1e6);
+    for (u32 i = 0; i < MAX_STATUS; i++) {
+        if (totals[i] > 0) {
+            fprintf(out, "  %-15s %" PRIu64 "\n",
+                    but_results_status_name((BUTResultCode)i), totals[i]);
+        }
+    }
+    if (duplicates > 0) {
+        fprintf(out, "  %-15s %" PRIu64 "\n", "duplicate", duplicates);
+    }
+    if (missing > 0) {
+        fprintf(out, "  %-15s %" PRIu64 "\n", "missing", missing);
+    }
+
+    if (failed_count > 0) {
+        fprintf(out, "\nFailures:\n");
+    }
+    for (u64 i = 0; i < failed_count; i++) {
+        print_entry(out, "  ", &failed[i]);
+    }
+
+    free(failed);
+    free(suites.slots);
+    free(cases.slots);
+    close_logs(&set);
+    return failed_count > 0 || duplicates > 0 || missing > 0;
+}
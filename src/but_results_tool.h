@@ -0,0 +1,78 @@
+#ifndef BUT_RESULTS_TOOL_H_
+#define BUT_RESULTS_TOOL_H_
+
+/**
+ * @file but_results_tool.h
+ * @author Douglas Cuthbertson
+ * @brief The commands of but_results: summarize, filter, compare, and merge result logs.
+ * @version 0.1
+ * @date 2025-09-25
+ *
+ *     but_results summary LOG...
+ *     but_results filter [--status STATUS] [--suite SUITE] [--reason TEXT] LOG...
+ *     but_results diff BASE_LOG LOG
+ *     but_results merge LOG...
+ *
+ * Logs are read in place from memory-mapped files. Several logs given to summary or
+ * filter are read as one, just like their concatenation. merge reads the logs of the
+ * shards of one run, and checks that together they ran every case exactly once. Each
+ * command writes its report to a stream, and errors and warnings to stderr.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <stdio.h> // FILE
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief count the results of some logs by status, and list the suites and reasons with
+ * the most failures.
+ *
+ * @param out the stream to which the summary is written.
+ * @param paths the logs.
+ * @param count the number of logs.
+ * @return 1 if a case failed or a log couldn't be read, and 0 otherwise.
+ */
+int but_results_summary(FILE *out, char **paths, int count);
+
+/**
+ * @brief list the results of some logs that match every option.
+ *
+ * @param out the stream to which the results are written.
+ * @param args the options, --status, --suite, and --reason, each followed by its value,
+ * and then the logs.
+ * @param count the number of args.
+ * @return 2 if an option is unknown, 1 if a log couldn't be read, and 0 otherwise.
+ */
+int but_results_filter(FILE *out, char **args, int count);
+
+/**
+ * @brief compare a log with a baseline by suite and test case name, and list the cases
+ * whose status changed, that are new, or that are gone.
+ *
+ * @param out the stream to which the differences are written.
+ * @param paths the baseline log and the log to compare with it.
+ * @return 1 if a case regressed or a log couldn't be read, and 0 otherwise.
+ */
+int but_results_diff(FILE *out, char **paths);
+
+/**
+ * @brief combine the logs of the shards of a run. Each case counts once, by its first
+ * result, toward the totals; a case with results in more than one place is a duplicate,
+ * and a case of a suite that some log started but no log has a result for is missing.
+ *
+ * @param out the stream to which the totals, failures, duplicates, and gaps are written.
+ * @param paths the logs.
+ * @param count the number of logs.
+ * @return 1 if a case failed, was duplicated, or is missing, or a log couldn't be read,
+ * and 0 otherwise.
+ */
+int but_results_merge(FILE *out, char **paths, int count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_RESULTS_TOOL_H_
@@ -0,0 +1,137 @@
+/**
+ * @file but_results_tool_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of merging the result logs of the shards of a run.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * Each test writes the shards' logs to files in the current directory, merges them into
+ * a report file, and reads the report back.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_results.h"      // but_results_create, but_results_write, etc.
+#include "but_results_tool.h" // but_results_merge
+
+#include <abbreviated_types.h> // u32
+#include <but.h>               // BUT_TEST_SETUP_CLEANUP
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_NOT_NULL, etc.
+#include <but_macros.h>        // BUT_UNUSED, BUT_ARRAY_COUNT
+
+#include <stdio.h>  // FILE, fopen_s, fread, fclose, remove, rewind
+#include <string.h> // memset, strstr
+
+#define MERGE_REPORT_PATH "but_butts_merge.txt"
+
+static char *g_shard_paths_[] = {
+    "but_butts_shard_a.bin",
+    "but_butts_shard_b.bin",
+    "but_butts_shard_c.bin",
+};
+
+// A result written to a shard's log.
+typedef struct ShardCase {
+    char const   *name;
+    u32           index;
+    BUTResultCode status;
+} ShardCase;
+
+static void remove_merge_files(void) {
+    for (size_t i = 0; i < BUT_ARRAY_COUNT(g_shard_paths_); i++) {
+        remove(g_shard_paths_[i]);
+    }
+    remove(MERGE_REPORT_PATH);
+}
+
+static BUT_SETUP_FN(set_up_merge) {
+    BUT_UNUSED(btc);
+    remove_merge_files();
+}
+
+static BUT_CLEANUP_FN(cleanup_merge) {
+    BUT_UNUSED(btc);
+    remove_merge_files();
+}
+
+// Write the log of a shard that ran some of the cases of one suite.
+static void write_shard(char const *path, char const *suite, u32 size,
+                        ShardCase const *cases, u32 count) {
+    BUTResultsWriter writer;
+    BUTResultsEntry  entry;
+
+    BUT_ASSERT_TRUE(but_results_create(&writer, path));
+    but_results_write_suite(&writer, suite, size);
+    for (u32 i = 0; i < count; i++) {
+        memset(&entry, 0, sizeof entry);
+        entry.suite  = suite;
+        entry.name   = cases[i].name;
+        entry.index  = cases[i].index;
+        entry.status = cases[i].status;
+        if (entry.status != BUT_PASSED) {
+            entry.reason = "boom";
+        }
+        but_results_write(&writer, &entry);
+    }
+    but_results_close(&writer);
+}
+
+// Merge the shards' logs and read the report into a buffer.
+static int merge_shards(int count, char *report, size_t size) {
+    FILE  *out    = NULL;
+    int    result = 0;
+    size_t length;
+
+    BUT_ASSERT_TRUE(fopen_s(&out, MERGE_REPORT_PATH, "w+") == 0);
+    result = but_results_merge(out, g_shard_paths_, count);
+    rewind(out);
+    length         = fread(report, 1, size - 1, out);
+    report[length] = '\0';
+    fclose(out);
+
+    return result;
+}
+
+// Verify shards that together ran every case once merge into exact totals, with no
+// duplicates or gaps.
+BUT_TEST_SETUP_CLEANUP("Merge Complete Shards", merge_complete, set_up_merge,
+                       cleanup_merge) {
+    static ShardCase const first[]  = {{"zero", 0, BUT_PASSED}, {"one", 1, BUT_FAILED}};
+    static ShardCase const second[] = {{"two", 2, BUT_PASSED}, {"three", 3, BUT_PASSED}};
+    char                   report[4096];
+
+    write_shard(g_shard_paths_[0], "Sharded", 4, first, BUT_ARRAY_COUNT(first));
+    write_shard(g_shard_paths_[1], "Sharded", 4, second, BUT_ARRAY_COUNT(second));
+
+    BUT_ASSERT_EQ_INT(merge_shards(2, report, sizeof report), 1);
+    BUT_ASSERT_NOT_NULL(strstr(report, "4 cases from 2 logs in 4 runs"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  passed          3\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  failed          1\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  Sharded: one: failed: boom"));
+    BUT_ASSERT_NULL(strstr(report, "duplicate"));
+    BUT_ASSERT_NULL(strstr(report, "missing"));
+}
+
+// Verify a case run by two shards counts once and is reported as a duplicate, and the
+// cases no shard ran are missing, including those of a suite with no results at all.
+BUT_TEST_SETUP_CLEANUP("Merge Duplicate and Missing Cases", merge_gaps, set_up_merge,
+                       cleanup_merge) {
+    static ShardCase const first[]  = {{"zero", 0, BUT_PASSED}, {"one", 1, BUT_FAILED}};
+    static ShardCase const second[] = {{"one", 1, BUT_PASSED}, {"two", 2, BUT_PASSED}};
+    char                   report[4096];
+
+    write_shard(g_shard_paths_[0], "Sharded", 4, first, BUT_ARRAY_COUNT(first));
+    write_shard(g_shard_paths_[1], "Sharded", 4, second, BUT_ARRAY_COUNT(second));
+    write_shard(g_shard_paths_[2], "Empty", 2, NULL, 0);
+
+    BUT_ASSERT_EQ_INT(merge_shards(3, report, sizeof report), 1);
+    BUT_ASSERT_NOT_NULL(strstr(report, "duplicate Sharded: one in but_butts_shard_a.bin "
+                                       "and but_butts_shard_b.bin\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "missing Sharded: case 4 of 4\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "missing Empty: case 1 of 2\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "missing Empty: case 2 of 2\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "3 cases from 3 logs in 4 runs"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  passed          2\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  failed          1\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  duplicate       1\n"));
+    BUT_ASSERT_NOT_NULL(strstr(report, "  missing         3\n"));
+}
@@ -58,6 +58,10 @@ struct TestDriverData {
     get_set_up_fail_count_fn      get_failed_set_up_count;
     get_results_count_fn          get_results_count;
     get_result_fn                 get_result;
+    but_register_suite_fn        *register_suite;
+    but_attach_thread_fn         *attach_thread;
+    but_detach_thread_fn         *detach_thread;
+    but_run_range_fn             *run_range;
     void (*throw_me)(BUTContext *ctx);
 };
 typedef struct TestDriverData TestDriverData;
@@ -7,12 +7,22 @@
  *
  * See LICENSE.txt for copyright and licensing information about this file.
  */
+#include "but_alloc.c"
+#include "but_arena.c"
+#include "but_case_table.c"
 #include "but_driver.c"
+#include "but_perf.c"
+#include "but_profile.c"
 #include "but_result_context.c"
+#include "but_timer.c"
+#include "but_trace.c"
+#include "but_usage.c"
 #include "exception_assert.c"
 #include "exception.c"
 #include "log.c"
 
+#include "but_test_data.h" // TEST_DATA_REASON, TEST_DATA_THROW_REASON, etc.
+
 DLL_SPEC_EXPORT BUT_HANDLER_FN(test_data_handler) {
     BUTContext *bctx = BUT_CONTAINER(ctx, BUTContext, exception_context);
 
@@ -95,3 +105,40 @@ DLL_SPEC_EXPORT BUT_GET_RESULTS_COUNT(test_data_get_results_count) {
 DLL_SPEC_EXPORT BUT_GET_RESULT(test_data_get_result) {
     return but_get_result(bctx, index);
 }
+
+DLL_SPEC_EXPORT BUT_REGISTER_SUITE(test_data_register_suite) {
+    but_register_suite(bctx, set_context);
+}
+
+DLL_SPEC_EXPORT BUT_ATTACH_THREAD(test_data_attach_thread) {
+    but_attach_thread(bctx);
+}
+
+DLL_SPEC_EXPORT BUT_DETACH_THREAD(test_data_detach_thread) {
+    but_detach_thread(bctx);
+}
+
+DLL_SPEC_EXPORT BUT_RUN_RANGE(test_data_run_range) {
+    but_run_range(bctx, first, end, callbacks);
+}
+
+// The library's own copy of the reason, at a different address than any suite's copy.
+static char const test_data_reason[] = TEST_DATA_REASON;
+
+DLL_SPEC_EXPORT TEST_DATA_THROW_REASON(test_data_throw_reason) {
+    BUT_THROW(test_data_reason);
+}
+
+DLL_SPEC_EXPORT TEST_DATA_CATCH_REASON(test_data_catch_reason) {
+    bool caught = false;
+
+    BUT_TRY {
+        thrower();
+    }
+    BUT_CATCH(test_data_reason) {
+        caught = true;
+    }
+    BUT_END_TRY;
+
+    return caught;
+}
@@ -33,6 +33,12 @@
 #define GET_SETUP_FAIL_COUNT_CTX_STR "test_data_get_setup_fail_count"
 #define GET_RESULTS_COUNT_CTX_STR    "test_data_get_results_count"
 #define GET_RESULT_CTX_STR           "test_data_get_result"
+#define REGISTER_SUITE_CTX_STR       "test_data_register_suite"
+#define ATTACH_THREAD_CTX_STR        "test_data_attach_thread"
+#define DETACH_THREAD_CTX_STR        "test_data_detach_thread"
+#define RUN_RANGE_CTX_STR            "test_data_run_range"
+#define THROW_REASON_CTX_STR         "test_data_throw_reason"
+#define CATCH_REASON_CTX_STR         "test_data_catch_reason"
 #define GET_CONTEXT                  "but_get_exception_context"
 #define SET_CONTEXT                  "but_set_exception_context"
 
@@ -51,5 +57,30 @@ DLL_SPEC BUT_GET_SETUP_FAILURE_COUNT(test_data_get_fail_count);
 DLL_SPEC BUT_GET_SETUP_FAILURE_COUNT(test_data_get_setup_fail_count);
 DLL_SPEC BUT_GET_RESULTS_COUNT(test_data_get_results_count);
 DLL_SPEC BUT_GET_RESULT(test_data_get_result);
+DLL_SPEC BUT_REGISTER_SUITE(test_data_register_suite);
+DLL_SPEC BUT_ATTACH_THREAD(test_data_attach_thread);
+DLL_SPEC BUT_DETACH_THREAD(test_data_detach_thread);
+DLL_SPEC BUT_RUN_RANGE(test_data_run_range);
+
+// The text of the reason the library throws and catches, which a suite defines, too.
+#define TEST_DATA_REASON "test data reason"
+
+/**
+ * @brief throw the library's own copy of TEST_DATA_REASON.
+ */
+#define TEST_DATA_THROW_REASON(name) void name(void)
+typedef TEST_DATA_THROW_REASON(test_data_throw_reason_fn);
+
+/**
+ * @brief call a function that throws, and catch the library's own copy of
+ * TEST_DATA_REASON.
+ *
+ * @return true if the exception was caught as TEST_DATA_REASON.
+ */
+#define TEST_DATA_CATCH_REASON(name) bool name(void (*thrower)(void))
+typedef TEST_DATA_CATCH_REASON(test_data_catch_reason_fn);
+
+DLL_SPEC TEST_DATA_THROW_REASON(test_data_throw_reason);
+DLL_SPEC TEST_DATA_CATCH_REASON(test_data_catch_reason);
 
 #endif // BUT_TEST_DATA_H_
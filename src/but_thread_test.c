@@ -0,0 +1,299 @@
+/**
+ * @file but_thread_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of running a suite, logging, and tracing on several threads at once.
+ * @version 0.1
+ * @date 2025-10-01
+ *
+ * The driver test loads but_test_data.dll as the driver, as the tests in but_test.c do,
+ * and runs a suite defined in this library on several threads, each with its own
+ * context. Its cases throw through this library's exception context, as a loaded
+ * suite's do, so each thread has to install its context in both libraries. It uses the
+ * helpers in but_test.c, so this file is included after it. The tracing test reads the
+ * trace state in but_trace.c, so it's included after that, too.
+ *
+ * Each worker only records what it saw; the assertions run on the test's own thread,
+ * after the workers have finished, because an assertion throws through the exception
+ * context of the thread that makes it.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_test.h"  // TestDriverData
+#include "but_trace.h" // but_trace_enable, but_trace_mark, but_trace_summarize, etc.
+#include "log.h"       // logger_get_context, logger_set_output, LOG_INFO
+
+#include <abbreviated_types.h> // u32, u64
+#include <but.h>               // BUT_TEST, BUT_CASE_NAME, BUT_TEST_SUITE, etc.
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_EQ_UINT32, etc.
+#include <but_macros.h>        // BUT_UNUSED, BUT_CONTAINER
+#include <exception.h>         // BUT_THROW, but_peek_exception_context, etc.
+
+#include <stdbool.h> // bool, true, false
+#include <stdio.h>   // FILE, tmpfile, fopen_s, fgets, remove
+#include <stdlib.h>  // strtol
+#include <string.h>  // strstr, strchr, strncmp
+#include <threads.h> // thrd_t, thrd_create, thrd_join
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetProcAddress
+
+#define THREAD_COUNT      4    ///< the number of workers each test starts
+#define CASES_PER_THREAD  2    ///< the span of the suite each worker runs
+#define EVENTS_PER_THREAD 1000 ///< log lines or spans per worker; more than one chunk
+#define THREAD_TRACE_PATH "but_butts_trace.json"
+
+static BUT_TEST_FN(thread_pass) {
+    BUT_UNUSED(btc);
+}
+
+static BUT_TEST_FN(thread_fail) {
+    BUT_UNUSED(btc);
+    BUT_THROW(but_test_exception);
+}
+
+// The odd cases fail, so each worker's span has a pass and a failure.
+BUT_CASE_NAME("Thread Case 0", thread_case_0, thread_pass, NULL, NULL);
+BUT_CASE_NAME("Thread Case 1", thread_case_1, thread_fail, NULL, NULL);
+BUT_CASE_NAME("Thread Case 2", thread_case_2, thread_pass, NULL, NULL);
+BUT_CASE_NAME("Thread Case 3", thread_case_3, thread_fail, NULL, NULL);
+BUT_CASE_NAME("Thread Case 4", thread_case_4, thread_pass, NULL, NULL);
+BUT_CASE_NAME("Thread Case 5", thread_case_5, thread_fail, NULL, NULL);
+BUT_CASE_NAME("Thread Case 6", thread_case_6, thread_pass, NULL, NULL);
+BUT_CASE_NAME("Thread Case 7", thread_case_7, thread_fail, NULL, NULL);
+
+BUT_SUITE_BEGIN(thread_cases)
+BUT_SUITE_ADD(thread_case_0)
+BUT_SUITE_ADD(thread_case_1)
+BUT_SUITE_ADD(thread_case_2)
+BUT_SUITE_ADD(thread_case_3)
+BUT_SUITE_ADD(thread_case_4)
+BUT_SUITE_ADD(thread_case_5)
+BUT_SUITE_ADD(thread_case_6)
+BUT_SUITE_ADD(thread_case_7)
+BUT_SUITE_END;
+
+BUT_TEST_SUITE("Thread Cases", thread_cases);
+
+// What a worker saw while it ran its span of the suite.
+typedef struct ThreadRun {
+    TestDriverData const *driver;
+    but_handler           handler;
+    u32                   first;
+    u32                   test_failures;
+    BUTResultCode         results[CASES_PER_THREAD];
+    bool                  driver_restored; ///< the data library's context was put back
+    bool                  suite_restored;  ///< this library's context was put back
+} ThreadRun;
+
+// Run a span of the suite with a context of the worker's own, and record the results.
+static int run_thread_cases(void *arg) {
+    ThreadRun            *run    = arg;
+    TestDriverData const *t      = run->driver;
+    BUTExceptionContext  *driver = t->get_context(__FILE__, __LINE__);
+    BUTExceptionContext  *suite  = but_peek_exception_context();
+    BUTContext            bctx;
+
+    t->initialize_context(&bctx, run->handler);
+    t->register_suite(&bctx, but_set_exception_context);
+    t->attach_thread(&bctx);
+    t->begin(&bctx, &BUT_TEST_SUITE_NAME(thread_cases));
+    t->run_range(&bctx, run->first, run->first + CASES_PER_THREAD, NULL);
+    run->test_failures = (u32)t->get_fail_count(&bctx);
+    for (u32 i = 0; i < CASES_PER_THREAD; i++) {
+        run->results[i] = t->get_result(&bctx, run->first + i);
+    }
+    t->end(&bctx);
+    t->detach_thread(&bctx);
+
+    // Neither library may be left pointing at bctx once it goes out of scope.
+    run->driver_restored = t->get_context(__FILE__, __LINE__) == driver;
+    run->suite_restored  = but_peek_exception_context() == suite;
+    return 0;
+}
+
+static void set_up_driver(BUTTestCase *btc) {
+    set_up_test_driver_data(BUT_CONTAINER(btc, TestDriverData, btc));
+}
+
+static void cleanup_driver(BUTTestCase *btc) {
+    cleanup_test_driver_data(BUT_CONTAINER(btc, TestDriverData, btc));
+}
+
+// Verify workers with their own contexts run their spans of a suite at the same time,
+// each recording only its own failures, and leave each thread's contexts as they were.
+BUT_TYPE_TEST_SETUP_CLEANUP("Run a Suite on Several Threads", TestDriverData,
+                            thread_suite, set_up_driver, cleanup_driver) {
+    ThreadRun   runs[THREAD_COUNT] = {0};
+    thrd_t      workers[THREAD_COUNT];
+    bool        created[THREAD_COUNT];
+    but_handler handler = (but_handler)GetProcAddress(t->h, "test_data_handler");
+
+    BUT_ASSERT_NOT_NULL(handler);
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        runs[i].driver  = t;
+        runs[i].handler = handler;
+        runs[i].first   = i * CASES_PER_THREAD;
+        created[i]
+            = thrd_create(&workers[i], run_thread_cases, &runs[i]) == thrd_success;
+    }
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        if (created[i]) {
+            thrd_join(workers[i], NULL);
+        }
+    }
+
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        BUT_ASSERT_TRUE(created[i]);
+        BUT_ASSERT_EQ_UINT32(runs[i].test_failures, CASES_PER_THREAD / 2);
+        for (u32 j = 0; j < CASES_PER_THREAD; j++) {
+            BUTResultCode expected = j % 2 == 0 ? BUT_PASSED : BUT_FAILED;
+
+            BUT_ASSERT_TRUE(runs[i].results[j] == expected);
+        }
+        BUT_ASSERT_TRUE(runs[i].driver_restored);
+        BUT_ASSERT_TRUE(runs[i].suite_restored);
+    }
+}
+
+// Return the worker that logged a line, or -1 if the line was torn or interleaved. A
+// whole line has one header, one message, and its own newline.
+static int parse_log_line(char const *line) {
+    static char const prefix[] = "[Threads] worker ";
+    char const       *message  = strstr(line, prefix);
+    char             *end;
+    long              worker;
+
+    if (line[0] != '[' || message == NULL || strchr(message + 1, '[') != NULL) {
+        return -1;
+    }
+
+    worker = strtol(message + sizeof prefix - 1, &end, 10);
+    if (end == message + sizeof prefix - 1 || strncmp(end, " line ", 6) != 0
+        || strchr(end, '\n') == NULL || worker < 0 || worker >= THREAD_COUNT) {
+        return -1;
+    }
+    return (int)worker;
+}
+
+static int log_lines(void *arg) {
+    int worker = *(int const *)arg;
+
+    for (int i = 0; i < EVENTS_PER_THREAD; i++) {
+        LOG_INFO("Threads", "worker %d line %d", worker, i);
+    }
+    return 0;
+}
+
+// Verify lines logged by several threads at once are written whole, one per line.
+BUT_TEST("Log on Several Threads", thread_log) {
+    Logger     *logger = &logger_get_context()->logger;
+    FILE       *output = logger->output;
+    log_level_t level  = logger->min_level;
+    FILE       *out    = tmpfile();
+    int         ids[THREAD_COUNT];
+    thrd_t      workers[THREAD_COUNT];
+    bool        created[THREAD_COUNT];
+    u32         lines[THREAD_COUNT] = {0};
+    u32         torn                = 0;
+    char        line[256];
+
+    BUT_ASSERT_NOT_NULL(out);
+    logger_set_output(out);
+    logger_set_level(LOG_INFO);
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        ids[i]     = i;
+        created[i] = thrd_create(&workers[i], log_lines, &ids[i]) == thrd_success;
+    }
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        if (created[i]) {
+            thrd_join(workers[i], NULL);
+        }
+    }
+    logger_set_output(output);
+    logger_set_level(level);
+
+    rewind(out);
+    while (fgets(line, sizeof line, out) != NULL) {
+        int worker = parse_log_line(line);
+
+        if (worker >= 0) {
+            lines[worker]++;
+        } else {
+            torn++;
+        }
+    }
+    fclose(out);
+
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        BUT_ASSERT_TRUE(created[i]);
+        BUT_ASSERT_EQ_UINT32(lines[i], EVENTS_PER_THREAD);
+    }
+    BUT_ASSERT_EQ_UINT32(torn, 0);
+}
+
+static int trace_spans(void *arg) {
+    BUTTraceSummary *summary = arg;
+    BUTTracer const *tracer  = but_trace_tracer();
+    BUTTraceMark     mark;
+
+    but_trace_mark(&mark);
+    for (int i = 0; i < EVENTS_PER_THREAD; i++) {
+        u64 begin = tracer->now();
+
+        tracer->span("thread span", begin, tracer->now());
+    }
+    but_trace_summarize(&mark, summary);
+    return 0;
+}
+
+// Verify threads tracing at once each summarize only their own events, and every event
+// is written, in one buffer per thread.
+BUT_TEST("Trace on Several Threads", thread_trace) {
+    BUTTraceSummary summaries[THREAD_COUNT] = {0};
+    thrd_t          workers[THREAD_COUNT];
+    bool            created[THREAD_COUNT];
+    bool            enabled = but_trace_enabled();
+    bool            written;
+    FILE           *in      = NULL;
+    u32             buffers = 0;
+    u32             spans   = 0;
+    char            line[512];
+
+    but_trace_enable();
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        created[i]
+            = thrd_create(&workers[i], trace_spans, &summaries[i]) == thrd_success;
+    }
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        if (created[i]) {
+            thrd_join(workers[i], NULL);
+        }
+    }
+
+    // Writing the trace discards the workers' buffers.
+    written          = but_trace_write(THREAD_TRACE_PATH);
+    g_trace_enabled_ = enabled;
+    if (written && fopen_s(&in, THREAD_TRACE_PATH, "r") == 0) {
+        while (fgets(line, sizeof line, in) != NULL) {
+            if (strstr(line, "\"name\":\"thread_name\"") != NULL) {
+                buffers++;
+            } else if (strstr(line, "\"name\":\"thread span\"") != NULL) {
+                spans++;
+            }
+        }
+        fclose(in);
+    }
+    remove(THREAD_TRACE_PATH);
+
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        BUT_ASSERT_TRUE(created[i]);
+        BUT_ASSERT_EQ_UINT32(summaries[i].count, 1);
+        BUT_ASSERT_STREQ(summaries[i].totals[0].name, "thread span");
+        BUT_ASSERT_TRUE(summaries[i].totals[0].count == EVENTS_PER_THREAD);
+    }
+    BUT_ASSERT_TRUE(written);
+    BUT_ASSERT_EQ_UINT32(buffers, THREAD_COUNT);
+    BUT_ASSERT_EQ_UINT32(spans, THREAD_COUNT * EVENTS_PER_THREAD);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file but_timer.c
+ * @author Douglas Cuthbertson
+ * @brief A monotonic, high-resolution timer for measuring the test driver.
+ * @version 0.1
+ * @date 2025-09-14
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_timer.h"
+
+#include <abbreviated_types.h> // u64
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // QueryPerformanceCounter, QueryPerformanceFrequency
+
+// The frequency is fixed at boot, so it's read once and cached.
+static u64 g_timer_frequency_;
+
+u64 but_timer_now(void) {
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return (u64)now.QuadPart;
+}
+
+u64 but_timer_frequency(void) {
+    if (g_timer_frequency_ == 0) {
+        LARGE_INTEGER frequency;
+
+        QueryPerformanceFrequency(&frequency);
+        g_timer_frequency_ = (u64)frequency.QuadPart;
+    }
+
+    return g_timer_frequency_;
+}
+
+u64 but_timer_ticks_to_ns(u64 ticks) {
+    u64 frequency = but_timer_frequency();
+
+    // Split the conversion so ticks * 1e9 can't overflow for long intervals.
+    return (ticks / frequency) * 1000000000ull
+           + ((ticks % frequency) * 1000000000ull) / frequency;
+}
@@ -0,0 +1,46 @@
+#ifndef BUT_TIMER_H_
+#define BUT_TIMER_H_
+
+/**
+ * @file but_timer.h
+ * @author Douglas Cuthbertson
+ * @brief A monotonic, high-resolution timer for measuring the test driver.
+ * @version 0.1
+ * @date 2025-09-14
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // u64
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief read the current value of the monotonic performance counter.
+ *
+ * @return the current tick count. Use but_timer_ticks_to_ns to convert the difference
+ * between two readings to nanoseconds.
+ */
+u64 but_timer_now(void);
+
+/**
+ * @brief retrieve the frequency of the performance counter in ticks per second.
+ *
+ * @return the number of ticks per second.
+ */
+u64 but_timer_frequency(void);
+
+/**
+ * @brief convert a number of ticks to nanoseconds.
+ *
+ * @param ticks the difference between two values returned by but_timer_now.
+ * @return the number of nanoseconds that elapsed.
+ */
+u64 but_timer_ticks_to_ns(u64 ticks);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_TIMER_H_
@@ -0,0 +1,404 @@
+/**
+ * @file but_trace.c
+ * @author Douglas Cuthbertson
+ * @brief A timeline of a test run in the Chrome trace-event format.
+ * @version 0.1
+ * @date 2025-09-22
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_trace.h"
+#include "but_timer.h" // but_timer_now, but_timer_ticks_to_ns
+#include "log.h"       // logger_get_filename, LOG_INFO
+
+#include <abbreviated_types.h> // i64, u32, u64
+#include <but_macros.h>        // THREAD_LOCAL
+#include <but_tracing.h>       // BUTTracer
+
+#include <stdatomic.h> // _Atomic, atomic_compare_exchange_weak
+#include <stdbool.h>   // bool, true, false
+#include <stdio.h>     // FILE, fopen_s, fprintf, snprintf
+#include <stdlib.h>    // calloc, free
+#include <string.h>    // memset, strcmp
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetCurrentThreadId
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h> // __rdtsc
+#endif
+
+/**
+ * @brief a fixed-size block of events. A buffer grows by adding chunks, so recorded
+ * events never move until their chunk is reused.
+ */
+typedef struct BUTTraceChunk {
+    struct BUTTraceChunk *next;                           ///< the next chunk, or NULL
+    u64                   sequence;                       ///< increases with each use
+    u32                   count;                          ///< the events in use
+    BUTTraceEvent         events[BUT_TRACE_CHUNK_EVENTS]; ///< the events
+} BUTTraceChunk;
+
+/**
+ * @brief the events recorded by one thread.
+ */
+typedef struct BUTTraceBuffer {
+    struct BUTTraceBuffer *next;      ///< the buffer of another thread, or NULL
+    BUTTraceChunk         *head;      ///< the first chunk
+    BUTTraceChunk         *tail;      ///< the chunk events are added to
+    u64                    sequence;  ///< the sequence number of the next chunk used
+    u64                    dropped;   ///< events discarded when chunks were reused
+    u32                    chunks;    ///< the number of chunks in the ring
+    u32                    thread_id; ///< the thread that owns the buffer
+} BUTTraceBuffer;
+
+// Spans and counters from test suites are recorded in this category. It's compared by
+// address.
+static char const g_user_category_[] = "user";
+
+static bool                         g_trace_enabled_;
+static u64                          g_trace_origin_;       // from but_trace_now
+static u64                          g_trace_origin_timer_; // from but_timer_now
+static BUTTraceBuffer *_Atomic      g_trace_buffers_;
+static THREAD_LOCAL BUTTraceBuffer *g_trace_buffer_;
+
+static void record_user_span(char const *name, u64 begin, u64 end) {
+    but_trace_span(g_user_category_, name, begin, end);
+}
+
+static void record_user_counter(char const *name, i64 value) {
+    but_trace_value(g_user_category_, name, value);
+}
+
+static BUTTracer const g_tracer_ = {
+    .now     = but_trace_now,
+    .span    = record_user_span,
+    .counter = record_user_counter,
+};
+
+void but_trace_enable(void) {
+    g_trace_origin_timer_ = but_timer_now();
+    g_trace_origin_       = but_trace_now();
+    g_trace_enabled_      = true;
+}
+
+bool but_trace_enabled(void) {
+    return g_trace_enabled_;
+}
+
+u64 but_trace_now(void) {
+#if defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return but_timer_now();
+#endif
+}
+
+// Calibrate the trace clock against the performance counter over the run so far.
+static double ns_per_tick(void) {
+    u64 ticks = but_trace_now() - g_trace_origin_;
+    u64 ns    = but_timer_ticks_to_ns(but_timer_now() - g_trace_origin_timer_);
+
+    return ticks != 0 ? (double)ns / (double)ticks : 0.0;
+}
+
+u64 but_trace_ticks_to_ns(u64 ticks) {
+    return (u64)((double)ticks * ns_per_tick());
+}
+
+BUTTracer const *but_trace_tracer(void) {
+    return &g_tracer_;
+}
+
+// Add a chunk to the calling thread's buffer, creating the buffer the first time, or
+// reuse its oldest chunk if the ring is full.
+static BUTTraceChunk *add_chunk(void) {
+    BUTTraceBuffer *ring = g_trace_buffer_;
+    BUTTraceChunk  *chunk;
+
+    if (ring != NULL && ring->chunks == BUT_TRACE_MAX_CHUNKS) {
+        chunk            = ring->head;
+        ring->head       = chunk->next;
+        ring->dropped   += chunk->count;
+        chunk->next      = NULL;
+        chunk->count     = 0;
+        chunk->sequence  = ring->sequence++;
+        ring->tail->next = chunk;
+        ring->tail       = chunk;
+        return chunk;
+    }
+
+    chunk = calloc(1, sizeof *chunk);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    if (g_trace_buffer_ == NULL) {
+        BUTTraceBuffer *buffer = calloc(1, sizeof *buffer);
+
+        if (buffer == NULL) {
+            free(chunk);
+            return NULL;
+        }
+
+        buffer->thread_id = GetCurrentThreadId();
+        buffer->head      = chunk;
+        buffer->next      = atomic_load(&g_trace_buffers_);
+        while (!atomic_compare_exchange_weak(&g_trace_buffers_, &buffer->next, buffer)) {
+        }
+        g_trace_buffer_ = buffer;
+    } else {
+        g_trace_buffer_->tail->next = chunk;
+    }
+    g_trace_buffer_->tail = chunk;
+    g_trace_buffer_->chunks++;
+    chunk->sequence = g_trace_buffer_->sequence++;
+
+    return chunk;
+}
+
+// Reserve the next event in the calling thread's buffer, or return NULL.
+static BUTTraceEvent *next_event(void) {
+    BUTTraceChunk *chunk = g_trace_buffer_ != NULL ? g_trace_buffer_->tail : NULL;
+
+    if (chunk == NULL || chunk->count == BUT_TRACE_CHUNK_EVENTS) {
+        chunk = add_chunk();
+        if (chunk == NULL) {
+            return NULL;
+        }
+    }
+
+    return &chunk->events[chunk->count++];
+}
+
+// Copy a string, truncating it to fit.
+static void copy_text(char *dest, size_t size, char const *src) {
+    snprintf(dest, size, "%s", src != NULL ? src : "");
+}
+
+void but_trace_span(char const *category, char const *name, u64 begin, u64 end) {
+    if (g_trace_enabled_) {
+        BUTTraceEvent *event = next_event();
+
+        if (event != NULL) {
+            event->begin    = begin;
+            event->end      = end;
+            event->value    = 0;
+            event->category = category;
+            event->phase    = 'X';
+            copy_text(event->name, sizeof event->name, name);
+            event->detail[0] = '\0';
+        }
+    }
+}
+
+void but_trace_instant(char const *category, char const *name, char const *detail) {
+    if (g_trace_enabled_) {
+        BUTTraceEvent *event = next_event();
+
+        if (event != NULL) {
+            event->begin    = but_trace_now();
+            event->end      = event->begin;
+            event->value    = 0;
+            event->category = category;
+            event->phase    = 'i';
+            copy_text(event->name, sizeof event->name, name);
+            copy_text(event->detail, sizeof event->detail, detail);
+        }
+    }
+}
+
+void but_trace_value(char const *category, char const *name, i64 value) {
+    if (g_trace_enabled_) {
+        BUTTraceEvent *event = next_event();
+
+        if (event != NULL) {
+            event->begin    = but_trace_now();
+            event->end      = event->begin;
+            event->value    = value;
+            event->category = category;
+            event->phase    = 'C';
+            copy_text(event->name, sizeof event->name, name);
+            event->detail[0] = '\0';
+        }
+    }
+}
+
+void but_trace_mark(BUTTraceMark *mark) {
+    BUTTraceBuffer *ring = g_trace_buffer_;
+
+    if (ring != NULL) {
+        mark->sequence = ring->tail->sequence;
+        mark->index    = ring->tail->count;
+    } else {
+        // The thread's first chunk will have the first sequence number.
+        mark->sequence = 0;
+        mark->index    = 0;
+    }
+}
+
+// Find the total for a name, adding it if there's room.
+static BUTTraceTotal *find_total(BUTTraceSummary *summary, BUTTraceEvent const *event) {
+    for (u32 i = 0; i < summary->count; i++) {
+        if (strcmp(summary->totals[i].name, event->name) == 0) {
+            return &summary->totals[i];
+        }
+    }
+
+    if (summary->count == BUT_TRACE_SUMMARY_NAMES) {
+        return NULL;
+    }
+
+    copy_text(summary->totals[summary->count].name, BUT_TRACE_NAME_LENGTH, event->name);
+    summary->totals[summary->count].counter = event->phase == 'C';
+    return &summary->totals[summary->count++];
+}
+
+void but_trace_summarize(BUTTraceMark const *mark, BUTTraceSummary *summary) {
+    BUTTraceChunk *chunk = g_trace_buffer_ != NULL ? g_trace_buffer_->head : NULL;
+    double         scale = ns_per_tick();
+
+    memset(summary, 0, sizeof *summary);
+    for (; chunk != NULL; chunk = chunk->next) {
+        u32 i = chunk->sequence == mark->sequence ? mark->index : 0;
+
+        if (chunk->sequence < mark->sequence) {
+            continue;
+        }
+
+        for (; i < chunk->count; i++) {
+            BUTTraceEvent const *event = &chunk->events[i];
+            BUTTraceTotal       *total;
+
+            if (event->category != g_user_category_) {
+                continue;
+            }
+
+            total = find_total(summary, event);
+            if (total == NULL) {
+                summary->other++;
+            } else if (total->counter) {
+                total->count++;
+                total->value = event->value;
+            } else {
+                total->count++;
+                total->total_ns += (u64)((double)(event->end - event->begin) * scale);
+            }
+        }
+    }
+}
+
+BUT_HANDLER_FN(but_trace_on_throw) {
+    char where[BUT_TRACE_DETAIL_LENGTH];
+
+    (void)ctx;
+    (void)details;
+    snprintf(where, sizeof where, "%s:%d",
+             file != NULL ? logger_get_filename(file) : "?", line);
+    but_trace_instant("exception", reason, where);
+}
+
+// Write a string as the contents of a JSON string.
+static void write_json_text(FILE *out, char const *text) {
+    for (; *text != '\0'; text++) {
+        unsigned char c = (unsigned char)*text;
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+}
+
+// Convert a time in ticks to microseconds since tracing was enabled.
+static double to_us(u64 ticks, double scale) {
+    u64 since = ticks > g_trace_origin_ ? ticks - g_trace_origin_ : 0;
+
+    return (double)since * scale / 1000.0;
+}
+
+static void write_event(FILE *out, BUTTraceEvent const *event, u32 thread_id,
+                        double scale) {
+    fputs(",\n{\"name\":\"", out);
+    write_json_text(out, event->name);
+    fprintf(out, "\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+            event->category, event->phase, thread_id, to_us(event->begin, scale));
+    if (event->phase == 'X') {
+        fprintf(out, ",\"dur\":%.3f",
+                to_us(event->end, scale) - to_us(event->begin, scale));
+    } else if (event->phase == 'C') {
+        fprintf(out, ",\"args\":{\"value\":%lld}", (long long)event->value);
+    } else {
+        fputs(",\"s\":\"t\"", out);
+    }
+    if (event->detail[0] != '\0') {
+        fputs(",\"args\":{\"detail\":\"", out);
+        write_json_text(out, event->detail);
+        fputs("\"}", out);
+    }
+    fputc('}', out);
+}
+
+bool but_trace_write(char const *path) {
+    BUTTraceBuffer *buffer  = atomic_exchange(&g_trace_buffers_, NULL);
+    FILE           *out     = NULL;
+    u32             worker  = 0;
+    u64             dropped = 0;
+    double          scale   = ns_per_tick();
+    bool            written;
+
+    g_trace_buffer_ = NULL;
+    if (fopen_s(&out, path, "w") != 0) {
+        out = NULL;
+    }
+
+    written = out != NULL;
+    if (out != NULL) {
+        fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+        fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"args\":{\"name\":\"but\"}}",
+              out);
+    }
+
+    // Buffers are freed whether or not they're written.
+    while (buffer != NULL) {
+        BUTTraceBuffer *next_buffer = buffer->next;
+        BUTTraceChunk  *chunk       = buffer->head;
+
+        if (out != NULL) {
+            fprintf(out,
+                    ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"name\":\"thread %u\"}}",
+                    buffer->thread_id, worker++);
+        }
+        while (chunk != NULL) {
+            BUTTraceChunk *next_chunk = chunk->next;
+
+            for (u32 i = 0; out != NULL && i < chunk->count; i++) {
+                write_event(out, &chunk->events[i], buffer->thread_id, scale);
+            }
+            free(chunk);
+            chunk = next_chunk;
+        }
+        dropped += buffer->dropped;
+        free(buffer);
+        buffer = next_buffer;
+    }
+
+    if (dropped > 0) {
+        LOG_INFO("Trace", "dropped the %llu oldest events", (unsigned long long)dropped);
+    }
+
+    if (out != NULL) {
+        fputs("\n]}\n", out);
+        fclose(out);
+    }
+
+    return written;
+}
@@ -0,0 +1,181 @@
+#ifndef BUT_TRACE_H_
+#define BUT_TRACE_H_
+
+/**
+ * @file but_trace.h
+ * @author Douglas Cuthbertson
+ * @brief A timeline of a test run in the Chrome trace-event format.
+ * @version 0.1
+ * @date 2025-09-22
+ *
+ * Each thread records its events into its own buffer, so recording an event takes no
+ * lock and does no I/O. A buffer is only shared when its thread records its first event
+ * and links the buffer into a list. A buffer is a ring of chunks: when it's full, its
+ * oldest chunk is reused, so a long run keeps its most recent events. The events of
+ * every thread are written when the run ends, as JSON that chrome://tracing and Perfetto
+ * can load.
+ *
+ * Timestamps come from the time-stamp counter where there is one, which is cheaper to
+ * read than QueryPerformanceCounter. It's calibrated against the performance counter
+ * over the run so far whenever times are converted to nanoseconds.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <abbreviated_types.h> // i64, u32, u64
+#include <but_tracing.h>       // BUTTracer
+#include <exception_types.h>   // BUT_HANDLER_FN
+
+#include <stdbool.h> // bool
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BUT_TRACE_NAME_LENGTH   64  ///< the longest name kept for an event
+#define BUT_TRACE_DETAIL_LENGTH 128 ///< the longest detail kept for an event
+#define BUT_TRACE_CHUNK_EVENTS  512 ///< the number of events in each chunk of a buffer
+#define BUT_TRACE_MAX_CHUNKS    64  ///< the most chunks a thread's buffer holds
+#define BUT_TRACE_SUMMARY_NAMES 8   ///< the most distinct names summarized per test case
+
+/**
+ * @brief One event on a thread's timeline. Names and details are copied, because they
+ * often belong to a test suite that's unloaded before the trace is written.
+ */
+typedef struct BUTTraceEvent {
+    u64         begin;                           ///< the start time, in timer ticks
+    u64         end;                             ///< the end time; begin for an instant
+    i64         value;                           ///< a counter's value
+    char const *category;                        ///< a string literal, e.g., "phase"
+    char        name[BUT_TRACE_NAME_LENGTH];     ///< what the event measured
+    char        detail[BUT_TRACE_DETAIL_LENGTH]; ///< shown in the event's arguments
+    char        phase; ///< 'X' for a span, 'i' for an instant, 'C' for a counter
+} BUTTraceEvent;
+
+/**
+ * @brief a position in the calling thread's buffer, from which events are summarized.
+ */
+typedef struct BUTTraceMark {
+    u64 sequence; ///< the sequence number of the chunk
+    u32 index;    ///< the index of the next event in the chunk
+} BUTTraceMark;
+
+/**
+ * @brief the spans or the last value of a counter with the same name.
+ */
+typedef struct BUTTraceTotal {
+    char name[BUT_TRACE_NAME_LENGTH]; ///< the name of the spans or counter
+    u64  count;                       ///< the number of spans or counter values
+    u64  total_ns;                    ///< the total duration of the spans
+    i64  value;                       ///< the last value of the counter
+    bool counter;                     ///< true for a counter, false for spans
+} BUTTraceTotal;
+
+/**
+ * @brief the spans and counters a test suite recorded during one test case.
+ */
+typedef struct BUTTraceSummary {
+    BUTTraceTotal totals[BUT_TRACE_SUMMARY_NAMES]; ///< the totals by name
+    u32           count;                           ///< the number of totals in use
+    u32           other;                           ///< events with names that didn't fit
+} BUTTraceSummary;
+
+/**
+ * @brief start recording events. Until this is called, the recording functions do
+ * nothing.
+ */
+void but_trace_enable(void);
+
+/**
+ * @brief report whether events are being recorded.
+ *
+ * @return true after but_trace_enable is called, and false otherwise.
+ */
+bool but_trace_enabled(void);
+
+/**
+ * @brief read the clock used for trace events.
+ *
+ * @return the current time, in the clock's ticks.
+ */
+u64 but_trace_now(void);
+
+/**
+ * @brief convert a duration to nanoseconds.
+ *
+ * @param ticks the difference between two values returned by but_trace_now.
+ * @return the number of nanoseconds that elapsed.
+ */
+u64 but_trace_ticks_to_ns(u64 ticks);
+
+/**
+ * @brief retrieve the tracer that records the spans and counters of test suites. Assign
+ * it to BUTExceptionContext.tracer.
+ *
+ * @return the tracer.
+ */
+BUTTracer const *but_trace_tracer(void);
+
+/**
+ * @brief record a span on the calling thread's timeline.
+ *
+ * @param category a string literal that groups related events.
+ * @param name what the span measured.
+ * @param begin the time the span started, from but_trace_now.
+ * @param end the time the span ended, from but_trace_now.
+ */
+void but_trace_span(char const *category, char const *name, u64 begin, u64 end);
+
+/**
+ * @brief record an instant on the calling thread's timeline.
+ *
+ * @param category a string literal that groups related events.
+ * @param name what happened.
+ * @param detail more about what happened, or NULL.
+ */
+void but_trace_instant(char const *category, char const *name, char const *detail);
+
+/**
+ * @brief record the value of a counter on the calling thread's timeline.
+ *
+ * @param category a string literal that groups related events.
+ * @param name the name of the counter.
+ * @param value its current value.
+ */
+void but_trace_value(char const *category, char const *name, i64 value);
+
+/**
+ * @brief mark the calling thread's next event.
+ *
+ * @param mark receives the position.
+ */
+void but_trace_mark(BUTTraceMark *mark);
+
+/**
+ * @brief total the spans and counters that test suites recorded on the calling thread
+ * since a mark, by name.
+ *
+ * @param mark a position from but_trace_mark.
+ * @param summary receives the totals.
+ */
+void but_trace_summarize(BUTTraceMark const *mark, BUTTraceSummary *summary);
+
+/**
+ * @brief an exception observer that records each exception thrown as an instant. Assign
+ * it to BUTExceptionContext.on_throw.
+ */
+BUT_HANDLER_FN(but_trace_on_throw);
+
+/**
+ * @brief write the events of every thread to a file and discard them. Call it after the
+ * threads that recorded events have finished.
+ *
+ * @param path the file to write.
+ * @return true if the file was written, and false otherwise.
+ */
+bool but_trace_write(char const *path);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_TRACE_H_
@@ -0,0 +1,48 @@
+/**
+ * @file but_tracing.c
+ * @author Douglas Cuthbertson
+ * @brief Trace spans and counters for the macros in but_tracing.h.
+ * @version 0.1
+ * @date 2025-09-23
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include <but_tracing.h>       // BUTTracer, BUTTraceScope
+#include <abbreviated_types.h> // i64
+#include <exception.h>         // but_peek_exception_context
+
+#include <stdbool.h> // true, false
+#include <stddef.h>  // NULL
+
+// Find the tracer the driver installed for this thread, if any.
+static BUTTracer const *current_tracer(void) {
+    BUTExceptionContext *ctx = but_peek_exception_context();
+
+    return ctx != NULL ? ctx->tracer : NULL;
+}
+
+BUTTraceScope but_trace_scope_begin(char const *name) {
+    BUTTraceScope scope;
+
+    scope.tracer = current_tracer();
+    scope.name   = name;
+    scope.begin  = scope.tracer != NULL ? scope.tracer->now() : 0;
+    scope.open   = true;
+
+    return scope;
+}
+
+void but_trace_scope_end(BUTTraceScope *scope) {
+    if (scope->tracer != NULL) {
+        scope->tracer->span(scope->name, scope->begin, scope->tracer->now());
+    }
+    scope->open = false;
+}
+
+void but_trace_counter(char const *name, i64 value) {
+    BUTTracer const *tracer = current_tracer();
+
+    if (tracer != NULL) {
+        tracer->counter(name, value);
+    }
+}
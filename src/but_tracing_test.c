@@ -0,0 +1,106 @@
+/**
+ * @file but_tracing_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of the trace spans and counters test suites add to their code.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * The tests install a tracer in the test's exception context, or remove it, the way the
+ * driver does with and without --trace, and put back the one they found before they
+ * assert. They read the trace state in but_trace.c, so this file is included after it.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_trace.h" // but_trace_mark, but_trace_summarize, but_trace_tracer, etc.
+
+#include <abbreviated_types.h> // u32, u64
+#include <but.h>               // BUT_TEST
+#include <but_assert.h>        // BUT_ASSERT_TRUE, BUT_ASSERT_EQ_UINT32, etc.
+#include <but_tracing.h>       // BUT_TRACE_SCOPE, BUT_TRACE_COUNTER
+#include <exception.h>         // but_peek_exception_context
+
+#include <stdbool.h> // bool
+
+// Verify spans and counters are left out of the trace when there's no tracer, and the
+// code in a span still runs once.
+BUT_TEST("Trace Without a Tracer", tracing_off) {
+    BUTExceptionContext *ctx     = but_peek_exception_context();
+    BUTTracer const     *tracer  = ctx->tracer;
+    bool                 enabled = but_trace_enabled();
+    BUTTraceMark         mark;
+    BUTTraceSummary      summary;
+    BUTTraceScope        scope;
+    u32                  runs = 0;
+
+    ctx->tracer = NULL;
+    but_trace_enable();
+    but_trace_mark(&mark);
+    BUT_TRACE_SCOPE("quiet span") {
+        runs++;
+    }
+    BUT_TRACE_COUNTER("quiet counter", 1);
+    scope = but_trace_scope_begin("quiet span");
+    but_trace_scope_end(&scope);
+    but_trace_summarize(&mark, &summary);
+    g_trace_enabled_ = enabled;
+    ctx->tracer      = tracer;
+
+    BUT_ASSERT_EQ_UINT32(runs, 1);
+    BUT_ASSERT_EQ_UINT32(summary.count, 0);
+    BUT_ASSERT_EQ_UINT32(summary.other, 0);
+    BUT_ASSERT_NULL(scope.tracer);
+    BUT_ASSERT_TRUE(scope.begin == 0);
+    BUT_ASSERT_FALSE(scope.open);
+}
+
+// Verify a summary totals only the spans and counters test suites recorded since the
+// mark, by name: each span's count and duration, and each counter's last value.
+BUT_TEST("Trace Summary", tracing_summary) {
+    BUTExceptionContext *ctx     = but_peek_exception_context();
+    BUTTracer const     *tracer  = ctx->tracer;
+    BUTTracer const     *user    = but_trace_tracer();
+    bool                 enabled = but_trace_enabled();
+    BUTTraceMark         mark;
+    BUTTraceSummary      summary;
+    u32                  runs = 0;
+    u64                  expected;
+
+    ctx->tracer = user;
+    but_trace_enable();
+    BUT_TRACE_SCOPE("parse") {
+        runs++;
+    }
+    but_trace_mark(&mark);
+    for (int i = 0; i < 2; i++) {
+        BUT_TRACE_SCOPE("parse") {
+            runs++;
+        }
+    }
+    BUT_TRACE_COUNTER("depth", 3);
+    BUT_TRACE_COUNTER("depth", 5);
+    // The driver's own spans aren't the suite's.
+    but_trace_span("phase", "parse", 0, 1000);
+    user->span("fixed", 1000, 4000);
+    user->span("fixed", 5000, 6000);
+    but_trace_summarize(&mark, &summary);
+    expected         = but_trace_ticks_to_ns(4000);
+    g_trace_enabled_ = enabled;
+    ctx->tracer      = tracer;
+
+    BUT_ASSERT_EQ_UINT32(runs, 3);
+    BUT_ASSERT_EQ_UINT32(summary.count, 3);
+    BUT_ASSERT_EQ_UINT32(summary.other, 0);
+    BUT_ASSERT_STREQ(summary.totals[0].name, "parse");
+    BUT_ASSERT_FALSE(summary.totals[0].counter);
+    BUT_ASSERT_TRUE(summary.totals[0].count == 2);
+    BUT_ASSERT_STREQ(summary.totals[1].name, "depth");
+    BUT_ASSERT_TRUE(summary.totals[1].counter);
+    BUT_ASSERT_TRUE(summary.totals[1].count == 2);
+    BUT_ASSERT_TRUE(summary.totals[1].value == 5);
+    BUT_ASSERT_STREQ(summary.totals[2].name, "fixed");
+    BUT_ASSERT_TRUE(summary.totals[2].count == 2);
+
+    // The clock is calibrated as the run goes, so allow the scale to drift a little.
+    BUT_ASSERT_TRUE(summary.totals[2].total_ns + expected / 100 + 1 >= expected);
+    BUT_ASSERT_TRUE(summary.totals[2].total_ns <= expected + expected / 100 + 1);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file but_usage.c
+ * @author Douglas Cuthbertson
+ * @brief Operating-system resource usage for test cases.
+ * @version 0.1
+ * @date 2025-09-20
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_usage.h"
+#include "but_perf.h" // but_perf_read_context_switches
+
+#include <abbreviated_types.h> // u64
+
+#include <stdbool.h> // bool, true, false
+#include <string.h>  // memset
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h> // GetThreadTimes, GetProcessIoCounters
+#include <Psapi.h>   // GetProcessMemoryInfo
+
+// Convert a FILETIME duration, in 100-nanosecond units, to nanoseconds.
+static u64 filetime_to_ns(FILETIME const *time) {
+    return (((u64)time->dwHighDateTime << 32) | time->dwLowDateTime) * 100;
+}
+
+void but_usage_read(BUTPerfSession *session, BUTUsage *usage) {
+    HANDLE                  process = GetCurrentProcess();
+    FILETIME                creation, exit, kernel, user;
+    PROCESS_MEMORY_COUNTERS memory;
+    IO_COUNTERS             io;
+
+    memset(usage, 0, sizeof *usage);
+
+    if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        usage->user_ns   = filetime_to_ns(&user);
+        usage->system_ns = filetime_to_ns(&kernel);
+    }
+
+    memset(&memory, 0, sizeof memory);
+    memory.cb = sizeof memory;
+    if (GetProcessMemoryInfo(process, &memory, sizeof memory)) {
+        usage->peak_rss_bytes = memory.PeakWorkingSetSize;
+        usage->page_faults    = memory.PageFaultCount;
+    }
+
+    if (GetProcessIoCounters(process, &io)) {
+        usage->io_operations
+            = io.ReadOperationCount + io.WriteOperationCount + io.OtherOperationCount;
+        usage->io_bytes
+            = io.ReadTransferCount + io.WriteTransferCount + io.OtherTransferCount;
+    }
+
+    usage->switches_valid
+        = but_perf_read_context_switches(session, &usage->context_switches);
+}
+
+void but_usage_delta(BUTUsage const *begin, BUTUsage const *end, BUTUsage *delta) {
+    delta->user_ns          = end->user_ns - begin->user_ns;
+    delta->system_ns        = end->system_ns - begin->system_ns;
+    delta->peak_rss_bytes   = end->peak_rss_bytes - begin->peak_rss_bytes;
+    delta->page_faults      = end->page_faults - begin->page_faults;
+    delta->context_switches = end->context_switches - begin->context_switches;
+    delta->io_operations    = end->io_operations - begin->io_operations;
+    delta->io_bytes         = end->io_bytes - begin->io_bytes;
+    delta->switches_valid   = begin->switches_valid && end->switches_valid;
+}
@@ -0,0 +1,68 @@
+#ifndef BUT_USAGE_H_
+#define BUT_USAGE_H_
+
+/**
+ * @file but_usage.h
+ * @author Douglas Cuthbertson
+ * @brief Operating-system resource usage for test cases.
+ * @version 0.1
+ * @date 2025-09-20
+ *
+ * Windows has no getrusage, so BUT assembles the equivalent from several sources. CPU
+ * times come from GetThreadTimes, so they cover only the thread running the test. The
+ * peak working set, page faults, and I/O counts come from GetProcessMemoryInfo and
+ * GetProcessIoCounters, so they include every thread in the process. Windows doesn't
+ * distinguish minor from major page faults, or voluntary from involuntary context
+ * switches, so each is reported as one count. Context switches come from the thread
+ * profiling API and are only available when it is.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_perf.h" // BUTPerfSession
+
+#include <abbreviated_types.h> // u64
+
+#include <stdbool.h> // bool
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief a snapshot of, or the difference between two snapshots of, the resources used
+ * by a thread and its process.
+ */
+typedef struct BUTUsage {
+    u64  user_ns;          ///< CPU time the thread spent in user mode
+    u64  system_ns;        ///< CPU time the thread spent in kernel mode
+    u64  peak_rss_bytes;   ///< the process's peak working set; its growth in a delta
+    u64  page_faults;      ///< the process's soft and hard page faults
+    u64  context_switches; ///< the thread's context switches
+    u64  io_operations;    ///< the process's read, write, and other I/O operations
+    u64  io_bytes;         ///< the bytes transferred by those operations
+    bool switches_valid;   ///< true if context_switches was collected
+} BUTUsage;
+
+/**
+ * @brief read the resources used so far by the calling thread and its process.
+ *
+ * @param session a performance-counter session for the calling thread, used to read its
+ * context switches. If it isn't open, context switches aren't collected.
+ * @param usage receives the resource usage.
+ */
+void but_usage_read(BUTPerfSession *session, BUTUsage *usage);
+
+/**
+ * @brief calculate the difference between two snapshots of resource usage.
+ *
+ * @param begin the usage read before the code being measured.
+ * @param end the usage read after the code being measured.
+ * @param delta receives end - begin for each measurement.
+ */
+void but_usage_delta(BUTUsage const *begin, BUTUsage const *end, BUTUsage *delta);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BUT_USAGE_H_
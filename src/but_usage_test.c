@@ -0,0 +1,54 @@
+/**
+ * @file but_usage_test.c
+ * @author Douglas Cuthbertson
+ * @brief Tests of reading the resources used by a thread and its process.
+ * @version 0.1
+ * @date 2025-10-03
+ *
+ * Windows updates a thread's CPU times at the clock tick, so a short test can't count on
+ * them growing; the test checks what every process has instead.
+ *
+ * See LICENSE.txt for copyright and licensing information about this file.
+ */
+#include "but_perf.h"  // BUTPerfSession, but_perf_open, but_perf_close
+#include "but_usage.h" // BUTUsage, but_usage_read, but_usage_delta
+
+#include <but.h>        // BUT_TEST
+#include <but_assert.h> // BUT_ASSERT_TRUE, BUT_ASSERT_FALSE
+
+#include <stdbool.h> // bool
+
+// Verify usage is read on the test's thread with or without a performance-counter
+// session, that context switches are collected only when the session can read them,
+// and that a delta is the difference of two readings.
+BUT_TEST("Usage Readings", usage_readings) {
+    BUTPerfSession session;
+    BUTUsage       begin;
+    BUTUsage       end;
+    BUTUsage       delta;
+    BUTUsage       closed;
+    bool           profiling;
+
+    but_perf_open(&session);
+    profiling = session.profiling != NULL;
+    but_usage_read(&session, &begin);
+    but_usage_read(&session, &end);
+    but_usage_delta(&begin, &end, &delta);
+    but_perf_close(&session);
+    but_usage_read(&session, &closed);
+
+    BUT_ASSERT_TRUE(begin.peak_rss_bytes > 0);
+    BUT_ASSERT_TRUE(begin.page_faults > 0);
+    BUT_ASSERT_TRUE(end.user_ns >= begin.user_ns);
+    BUT_ASSERT_TRUE(end.page_faults >= begin.page_faults);
+    BUT_ASSERT_TRUE(profiling || !begin.switches_valid);
+    BUT_ASSERT_TRUE(delta.user_ns == end.user_ns - begin.user_ns);
+    BUT_ASSERT_TRUE(delta.page_faults == end.page_faults - begin.page_faults);
+    BUT_ASSERT_FALSE(closed.switches_valid);
+    BUT_ASSERT_TRUE(closed.peak_rss_bytes >= begin.peak_rss_bytes);
+
+    // Context switches are compared only if both readings have them.
+    end.switches_valid = !begin.switches_valid;
+    but_usage_delta(&begin, &end, &delta);
+    BUT_ASSERT_FALSE(delta.switches_valid);
+}
@@ -13,11 +13,14 @@
 #include <exception_assert.h> // assert
 #include "log.h"
 
-#include <stddef.h>  // offsetof, NULL
-#include <stdio.h>   // fprintf
-#include <stdlib.h>  // abort
-#include <string.h>  // strncpy_s
-#include <threads.h> // mtx_t, mtx_lock, mtx_unlock
+#include <stdarg.h>    // va_list, va_start, va_end
+#include <stdatomic.h> // _Atomic, atomic_load_explicit, atomic_fetch_or_explicit
+#include <stdbool.h>   // bool, true, false
+#include <stddef.h>    // offsetof, NULL
+#include <stdio.h>     // fprintf, fflush, vsnprintf
+#include <stdlib.h>    // abort
+#include <string.h>    // strncpy_s, strcmp, strlen, memcpy
+#include <threads.h>   // mtx_t, mtx_lock, mtx_unlock, call_once, once_flag
 
 BUTExceptionReason but_expected_failure
     = "expected failure"; ///< test drivers catch this and do not report it as a failure
@@ -33,6 +36,31 @@ BUTExceptionReason but_internal_error
 BUTExceptionReason but_invalid_address
     = "invalid address"; ///< used when an address is not valid
 
+/**
+ * @brief numbers each distinct reason, in the order the reasons are first thrown or
+ * declared. The text of each is copied into the registry itself, so a reason stays valid
+ * after the module that defined it is unloaded, and no module's C runtime owns the copy.
+ * Reasons are added under the lock, but looked up without it: a slot is only set once
+ * the reason it numbers is complete, and categories are only ever added atomically.
+ */
+struct BUTReasonRegistry {
+    mtx_t               lock;                        ///< serializes adding reasons
+    u32                 count;                       ///< the next number to give out
+    size_t              text_used;                   ///< the bytes of text in use
+    char const         *texts[BUT_MAX_REASONS];      ///< the text of each reason
+    u32                 hashes[BUT_MAX_REASONS];     ///< the hash of each text
+    flag32 _Atomic      categories[BUT_MAX_REASONS]; ///< the categories of each
+    BUTReasonId _Atomic slots[2 * BUT_MAX_REASONS];  ///< numbers by the hash of text
+    char                text[BUT_REASON_TEXT_SIZE];  ///< the copies of the texts
+};
+
+static BUTReasonRegistry g_reasons_;
+static once_flag         g_reasons_once_ = ONCE_FLAG_INIT;
+
+// The details of the last few exceptions thrown with them on this thread.
+static THREAD_LOCAL char g_details_[BUT_DETAILS_RING][BUT_MAX_DETAILS_LENGTH];
+static THREAD_LOCAL u32  g_details_next_;
+
 /**
  * @brief The default handler (through a pointer that can be updated to
  * point to an application-specific handler) when an exception is not caught.
@@ -69,12 +97,10 @@ static THREAD_LOCAL BUTExceptionContext g_default_context_
  * default, then they will each have to register it for themselves either directly, or by
  * calling but_set_exception_context(but_handler_fn **handler) defined below.
  *
- * The global context works only in single-threaded contexts. Maybe I should get rid of
- * the global context and assert that g_context_ is NOT NULL before each use. It would
- * require a call to but_set_exception_context() for initialization.
+ * Each thread starts with its own default context, so but_thread_context is initialized
+ * the first time each thread asks for it rather than once for the process.
  */
-static THREAD_LOCAL BUTExceptionContext *g_context_;
-static once_flag                         g_context_init_flag_ = ONCE_FLAG_INIT;
+THREAD_LOCAL BUTExceptionContext *but_thread_context;
 
 BUT_INIT_FN(but_init) {
     assert(ctx);
@@ -102,6 +128,174 @@ void PrintCallingModule() {
     }
 }
 
+// FNV-1a, 32 bits.
+static u32 hash_reason(char const *text) {
+    u32 hash = 2166136261u;
+
+    for (; *text != '\0'; text++) {
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    }
+    return hash;
+}
+
+// Find the number of a reason without taking the lock. If it has none, return
+// BUT_REASON_ID_NONE, and if empty isn't NULL, the slot where it would go there.
+static BUTReasonId lookup_reason(BUTReasonRegistry *registry, BUTExceptionReason reason,
+                                 u32 hash, u32 *empty) {
+    BUTReasonId _Atomic *slots = registry->slots;
+    u32                  mask  = 2 * BUT_MAX_REASONS - 1;
+    u32                  slot  = hash & mask;
+    BUTReasonId          id    = BUT_REASON_ID_NONE;
+    BUTReasonId          other;
+
+    other = atomic_load_explicit(&slots[slot], memory_order_acquire);
+    while (id == BUT_REASON_ID_NONE && other != BUT_REASON_ID_NONE) {
+        if (registry->hashes[other] == hash
+            && strcmp(registry->texts[other], reason) == 0) {
+            id = other;
+        } else {
+            slot  = (slot + 1) & mask;
+            other = atomic_load_explicit(&slots[slot], memory_order_acquire);
+        }
+    }
+    if (empty != NULL) {
+        *empty = slot;
+    }
+
+    return id;
+}
+
+// Give a reason the next number, unless another thread just did. Only this takes the
+// lock, so it's only called for a reason that looked new.
+static BUTReasonId add_reason(BUTReasonRegistry *registry, BUTExceptionReason reason,
+                              u32 hash) {
+    size_t      size = strlen(reason) + 1;
+    u32         slot;
+    BUTReasonId id;
+    bool        full = false;
+
+    mtx_lock(&registry->lock);
+    id = lookup_reason(registry, reason, hash, &slot);
+    if (id == BUT_REASON_ID_NONE) {
+        if (registry->count < BUT_MAX_REASONS
+            && size <= BUT_REASON_TEXT_SIZE - registry->text_used) {
+            char *copy = &registry->text[registry->text_used];
+
+            memcpy(copy, reason, size);
+            registry->text_used += size;
+            id                   = registry->count++;
+            registry->texts[id]  = copy;
+            registry->hashes[id] = hash;
+            atomic_store_explicit(&registry->categories[id], 0, memory_order_relaxed);
+            atomic_store_explicit(&registry->slots[slot], id, memory_order_release);
+        } else {
+            full = true;
+        }
+    }
+    mtx_unlock(&registry->lock);
+
+    if (full) {
+        LOG_ERROR("Exception", "the reason registry is full; \"%s\" has no number",
+                  reason);
+    }
+
+    return id;
+}
+
+// Find the number of a reason in a registry, or give it the next one. Add categories to
+// the reason's, and if categories isn't NULL, return them all there. Only throwing and
+// declaring a reason add it; catching one only looks it up. A reason that's been thrown
+// before is found without the lock.
+static BUTReasonId register_reason(BUTReasonRegistry *registry,
+                                   BUTExceptionReason reason, flag32 add,
+                                   flag32 *categories) {
+    u32         hash = hash_reason(reason);
+    BUTReasonId id   = lookup_reason(registry, reason, hash, NULL);
+
+    if (id == BUT_REASON_ID_NONE) {
+        id = add_reason(registry, reason, hash);
+    }
+    if (id != BUT_REASON_ID_NONE && add != 0) {
+        atomic_fetch_or_explicit(&registry->categories[id], add, memory_order_acq_rel);
+    }
+    if (categories != NULL) {
+        *categories = id != BUT_REASON_ID_NONE
+                        ? atomic_load_explicit(&registry->categories[id],
+                                               memory_order_acquire)
+                        : 0;
+    }
+
+    return id;
+}
+
+// Number the library's own reasons first, in the order of BUTReasonIds.
+static void initialize_reasons(void) {
+    struct {
+        BUTExceptionReason reason;
+        flag32             categories;
+    } const builtin[] = {
+        {but_expected_failure, BUT_CATEGORY_TEST},
+        {but_unexpected_failure, BUT_CATEGORY_TEST},
+        {but_test_exception, BUT_CATEGORY_TEST},
+        {but_not_implemented, BUT_CATEGORY_BUG},
+        {but_invalid_value, BUT_CATEGORY_ARGUMENT},
+        {but_internal_error, BUT_CATEGORY_BUG},
+        {but_invalid_address, BUT_CATEGORY_ARGUMENT},
+    };
+
+    mtx_init(&g_reasons_.lock, mtx_plain);
+    g_reasons_.count = BUT_REASON_ID_NONE + 1;
+    for (size_t i = 0; i < sizeof builtin / sizeof builtin[0]; i++) {
+        register_reason(&g_reasons_, builtin[i].reason, builtin[i].categories, NULL);
+    }
+}
+
+BUTReasonRegistry *but_reason_registry(void) {
+    call_once(&g_reasons_once_, initialize_reasons);
+    return &g_reasons_;
+}
+
+// The registry a context uses.
+static BUTReasonRegistry *registry_of(BUTExceptionContext const *ctx) {
+    return ctx->reasons != NULL ? ctx->reasons : but_reason_registry();
+}
+
+BUTReasonId but_reason_id(BUTExceptionContext const *ctx, BUTExceptionReason reason) {
+    return lookup_reason(registry_of(ctx), reason, hash_reason(reason), NULL);
+}
+
+bool but_reason_matches(BUTExceptionContext const *ctx,
+                        BUTExceptionEnvironment const *env, BUTExceptionReason reason) {
+    BUTReasonId id = BUT_REASON_ID_NONE;
+
+    if (env->reason == reason) {
+        return true;
+    }
+    if (env->reason_id != BUT_REASON_ID_NONE) {
+        id = but_reason_id(ctx, reason);
+    }
+
+    // A reason the registry had no room for has no number, so compare its text.
+    return id != BUT_REASON_ID_NONE ? id == env->reason_id
+                                    : strcmp(env->reason, reason) == 0;
+}
+
+BUTReasonId but_declare_reason(BUTExceptionContext const *ctx, BUTExceptionReason reason,
+                               flag32 categories) {
+    return register_reason(registry_of(ctx), reason, categories, NULL);
+}
+
+// The module that linked this copy of the library, which is the one throwing. It's only
+// looked up when an exception is thrown, so entering a try block stays cheap.
+static HMODULE throwing_module(void) {
+    HMODULE module = NULL;
+
+    GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                           | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                       (LPCSTR)throwing_module, &module);
+    return module;
+}
+
 BUT_THROW_FN(but_throw) {
     assert(reason);
 
@@ -111,25 +305,99 @@ BUT_THROW_FN(but_throw) {
         PrintCallingModule();
     }
 
-    BUTExceptionContext *ctx = but_get_exception_context(__FILE__, __LINE__);
+    BUTExceptionContext *ctx = BUT_CURRENT_CONTEXT;
+    if (ctx->on_throw != NULL) {
+        (*ctx->on_throw)(ctx, reason, details, file, line);
+    }
+
     if (ctx->stack == NULL) {
         // handle an unhandled exception
         (*ctx->handler)(ctx, reason, details, file, line);
     } else {
+#if defined(BUT_EXCEPTIONS_SEH)
+        // unwind to the __except of the next try-catch block, which pops the stack
+        ULONG_PTR arguments[BUT_SEH_ARGUMENTS];
+        flag32    categories;
+
+        arguments[0] = (ULONG_PTR)ctx->stack;
+        arguments[1] = (ULONG_PTR)reason;
+        arguments[2]
+            = (ULONG_PTR)register_reason(registry_of(ctx), reason, 0, &categories);
+        arguments[3] = (ULONG_PTR)categories;
+        arguments[4] = (ULONG_PTR)details;
+        arguments[5] = (ULONG_PTR)file;
+        arguments[6] = (ULONG_PTR)line;
+        arguments[7] = (ULONG_PTR)throwing_module();
+        RaiseException(BUT_SEH_CODE, EXCEPTION_NONCONTINUABLE, BUT_SEH_ARGUMENTS,
+                       arguments);
+#else
         // pop the stack and leap to the next try-catch block
         BUTExceptionEnvironment *env = ctx->stack;
         ctx->stack                   = ctx->stack->next;
         env->reason                  = reason;
+        env->reason_id               = register_reason(registry_of(ctx), reason, 0,
+                                                       &env->categories);
         env->details                 = details;
         env->file                    = file;
         env->line                    = line;
-        longjmp(env->jmp, BUT_THROWN);
+        env->h                       = throwing_module();
+        BUT_LONGJMP(env->jmp, BUT_THROWN);
+#endif
+    }
+}
+
+void but_left_section(BUTExceptionContext *ctx, BUTExceptionEnvironment *env) {
+    // A break or continue in the try block leaves the section on the stack.
+    if (ctx->stack == env) {
+        ctx->stack = env->next;
     }
+    but_throw(but_internal_error,
+              but_format_details("break or continue left the BUT_TRY block at %s:%u",
+                                 env->try_file, (unsigned)env->try_line),
+              env->try_file, env->try_line);
+}
+
+#if defined(BUT_EXCEPTIONS_SEH)
+int but_seh_filter(EXCEPTION_POINTERS const *info, BUTExceptionEnvironment *env) {
+    EXCEPTION_RECORD const *record = info->ExceptionRecord;
+    int                     result = EXCEPTION_CONTINUE_SEARCH;
+
+    // A section only accepts the exceptions thrown to it, so one thrown from its catch
+    // blocks, or to a section that encloses it, passes through.
+    if (record->ExceptionCode == BUT_SEH_CODE
+        && record->NumberParameters == BUT_SEH_ARGUMENTS
+        && record->ExceptionInformation[0] == (ULONG_PTR)env) {
+        env->reason     = (BUTExceptionReason)record->ExceptionInformation[1];
+        env->reason_id  = (BUTReasonId)record->ExceptionInformation[2];
+        env->categories = (flag32)record->ExceptionInformation[3];
+        env->details    = (char const *)record->ExceptionInformation[4];
+        env->file       = (char const *)record->ExceptionInformation[5];
+        env->line       = (u32)record->ExceptionInformation[6];
+        env->h          = (HMODULE)record->ExceptionInformation[7];
+        env->state      = BUT_THROWN;
+        result          = EXCEPTION_EXECUTE_HANDLER;
+    }
+
+    return result;
+}
+#endif
+
+char const *but_format_details(char const *format, ...) {
+    char   *details = g_details_[g_details_next_];
+    va_list args;
+
+    g_details_next_ = (g_details_next_ + 1) % BUT_DETAILS_RING;
+    va_start(args, format);
+    vsnprintf(details, BUT_MAX_DETAILS_LENGTH, format, args);
+    va_end(args);
+
+    return details;
 }
 
-void initialize_g_context_once(void) {
-    if (g_context_ == 0) {
-        g_context_ = &g_default_context_;
+// Point the calling thread at its default context if it has none yet.
+static void initialize_g_context(void) {
+    if (but_thread_context == NULL) {
+        but_thread_context = &g_default_context_;
     }
 }
 
@@ -139,28 +407,39 @@ void initialize_g_context_once(void) {
  * @return the address of the per-thread exception handler.
  */
 DLL_SPEC_EXPORT BUT_GET_EXCEPTION_CONTEXT(but_get_exception_context) {
-    call_once(&g_context_init_flag_, initialize_g_context_once);
-    LOG_TRACE_FILE_LINE("Exception", file, line, "context: 0x%p, %s[%d]", g_context_,
-                        file, line);
-    return g_context_;
+    initialize_g_context();
+    LOG_TRACE_FILE_LINE("Exception", file, line, "context: 0x%p, %s[%d]",
+                        but_thread_context, file, line);
+    return but_thread_context;
+}
+
+BUTExceptionContext *but_peek_exception_context(void) {
+    return but_thread_context;
 }
 
 /**
  * @brief Enable an application to register its own handler for uncaught exceptions. It
  * accepts an exception handler (handler context) and returns the previous one.
  *
- * @return the previous handler context.
+ * Passing the value it returned restores the previous context exactly. A NULL context
+ * returns the thread to its default context the next time it's used.
+ *
+ * @return the previous handler context, or NULL if the thread hadn't used one yet.
  */
 DLL_SPEC_EXPORT
 BUT_SET_EXCEPTION_CONTEXT(but_set_exception_context) {
-    LOG_DEBUG_FILE_LINE("Exception", file, line, "replace 0x%p wit 0x%p", g_context_,
-                        ctx);
-    assert(ctx != NULL);
+    LOG_DEBUG_FILE_LINE("Exception", file, line, "replace 0x%p wit 0x%p",
+                        but_thread_context, ctx);
     BUTExceptionContext *previous;
 
-    call_once(&g_context_init_flag_, initialize_g_context_once);
-    previous   = g_context_;
-    g_context_ = ctx;
+    previous           = but_thread_context;
+    but_thread_context = ctx;
 
     return previous;
 }
+
+DLL_SPEC_EXPORT
+BUT_FLUSH_OUTPUT(but_flush_output) {
+    fflush(stdout);
+    fflush(stderr);
+}
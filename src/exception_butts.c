@@ -17,7 +17,9 @@
 #include <exception.h>        // BUT_THROW, BUT_TRY, etc.
 #include <but_macros.h>       // DLL_SPEC_EXPORT, BUT_UNUSED
 
-#include <stddef.h> // NULL
+#include <stdbool.h> // bool, true, false
+#include <stddef.h>  // NULL
+#include <string.h>  // strcmp, strstr
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -121,6 +123,287 @@ BUT_TEST("Throw and Catch All", test_throw_catch_all) {
     BUT_END_TRY;
 }
 
+// Report whether a section's environment is empty as it finishes. Called twice from the
+// same frame, the second section reuses the memory of the first one's environment.
+static bool section_is_empty(bool throw_first) {
+    bool empty = false;
+
+    BUT_TRY {
+        if (throw_first) {
+            BUT_THROW_DETAILS(test_exception, "details %d", 1);
+        }
+    }
+    BUT_CATCH(test_exception) {
+        ; // Only the environment left behind matters.
+    }
+    BUT_FINALLY {
+        empty = BUT_REASON_ID == BUT_REASON_ID_NONE && BUT_CATEGORIES == 0
+             && BUT_DETAILS == NULL && BUT_FILE == NULL && BUT_LINE == 0
+             && but_env_.h == NULL;
+    }
+    BUT_END_TRY;
+
+    return empty;
+}
+
+// Verify entering a section clears what an earlier section's exception left behind.
+BUT_TEST("Nothing Thrown", nothing_thrown) {
+    BUT_ASSERT(!section_is_empty(true));
+    BUT_ASSERT(section_is_empty(false));
+}
+
+// Verify a rethrow from a catch block reaches the next enclosing section, with the
+// exception's details and location intact, and each section leaves the stack as it was.
+BUT_TEST("Nested Rethrow", nested_rethrow) {
+    BUTExceptionEnvironment *stack = BUT_CURRENT_CONTEXT->stack;
+    // A rethrow jumps back into this frame, so these change between setjmp and longjmp.
+    char const *volatile file   = NULL;
+    volatile u32         line   = 0;
+    volatile int         caught = 0;
+
+    BUT_TRY {
+        BUT_TRY {
+            BUT_TRY {
+                BUT_THROW_DETAILS(test_exception, "nested %d", 3);
+            }
+            BUT_CATCH(test_exception) {
+                file = BUT_FILE;
+                line = BUT_LINE;
+                caught++;
+                BUT_RETHROW;
+            }
+            BUT_END_TRY;
+        }
+        BUT_CATCH(but_invalid_value) {
+            assert(0);
+        }
+        BUT_END_TRY;
+    }
+    BUT_CATCH(test_exception) {
+        caught++;
+        BUT_ASSERT(BUT_DETAILS != NULL && strcmp(BUT_DETAILS, "nested 3") == 0);
+        BUT_ASSERT(BUT_FILE == file && BUT_LINE == line);
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT(caught == 2);
+    BUT_ASSERT(BUT_CURRENT_CONTEXT->stack == stack);
+}
+
+// Throw details and return them, as a catch block sees them.
+static char const *throw_details(int i) {
+    char const *details = NULL;
+
+    BUT_TRY {
+        BUT_THROW_DETAILS(test_exception, "details %d", i);
+    }
+    BUT_CATCH(test_exception) {
+        details = BUT_DETAILS;
+    }
+    BUT_END_TRY;
+
+    return details;
+}
+
+// Verify the details of an exception stay intact through BUT_DETAILS_RING - 1 later
+// throws with details on the same thread, and the next throw reuses their buffer.
+BUT_TEST("Details Ring", details_ring) {
+    char const *first  = throw_details(0);
+    bool        intact = first != NULL;
+
+    for (int i = 1; i < BUT_DETAILS_RING && intact; i++) {
+        char const *later = throw_details(i);
+
+        intact = later != first && strcmp(first, "details 0") == 0;
+    }
+
+    BUT_ASSERT(intact);
+    BUT_ASSERT(throw_details(BUT_DETAILS_RING) == first);
+    BUT_ASSERT(strcmp(first, "details 0") != 0);
+}
+
+// Verify catching a reason doesn't number it, and an exception without a number matches
+// a catch block by its text, never because neither reason has a number.
+BUT_TEST("Reason Numbers", reason_numbers) {
+    BUTExceptionContext    *ctx          = BUT_CURRENT_CONTEXT;
+    BUTExceptionEnvironment env          = {0};
+    char                    unnumbered[] = "unnumbered";
+    bool                    caught       = false;
+
+    BUT_TRY {
+        BUT_THROW(test_exception);
+    }
+    BUT_CATCH("never thrown") {
+        assert(0);
+    }
+    BUT_CATCH(test_exception) {
+        caught = true;
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT(caught);
+    BUT_ASSERT(but_reason_id(ctx, "never thrown") == BUT_REASON_ID_NONE);
+    BUT_ASSERT(but_reason_id(ctx, test_exception) == BUT_REASON_ID_TEST_EXCEPTION);
+
+    env.reason    = unnumbered;
+    env.reason_id = BUT_REASON_ID_NONE;
+    BUT_ASSERT(but_reason_matches(ctx, &env, "unnumbered"));
+    BUT_ASSERT(!but_reason_matches(ctx, &env, "never thrown"));
+}
+
+// Throw a reason, and return which block caught it: 1 for the first category block, 2
+// for the second, or 0 for the catch-all.
+static int catch_category(BUTExceptionReason reason, flag32 first, flag32 second) {
+    int caught = -1;
+
+    BUT_TRY {
+        BUT_THROW(reason);
+    }
+    BUT_CATCH_CATEGORY(first) {
+        caught = 1;
+    }
+    BUT_CATCH_CATEGORY(second) {
+        caught = 2;
+    }
+    BUT_CATCH_ALL {
+        caught = 0;
+    }
+    BUT_END_TRY;
+
+    return caught;
+}
+
+// Verify the library's own reasons are caught by their categories, and a reason that
+// hasn't been declared belongs to none.
+BUT_TEST("Builtin Categories", builtin_categories) {
+    BUT_ASSERT(catch_category(but_test_exception, BUT_CATEGORY_TEST, 0) == 1);
+    BUT_ASSERT(catch_category(but_expected_failure, BUT_CATEGORY_TEST, 0) == 1);
+    BUT_ASSERT(catch_category(but_unexpected_failure, BUT_CATEGORY_TEST, 0) == 1);
+    BUT_ASSERT(catch_category(but_invalid_value, BUT_CATEGORY_BUG, BUT_CATEGORY_ARGUMENT)
+               == 2);
+    BUT_ASSERT(catch_category(but_invalid_address, BUT_CATEGORY_ARGUMENT, 0) == 1);
+    BUT_ASSERT(catch_category(but_internal_error, BUT_CATEGORY_TEST, BUT_CATEGORY_BUG)
+               == 2);
+    BUT_ASSERT(catch_category(but_not_implemented, BUT_CATEGORY_BUG, 0) == 1);
+    BUT_ASSERT(catch_category(but_invalid_value, BUT_CATEGORY_TEST | BUT_CATEGORY_BUG, 0)
+               == 0);
+    BUT_ASSERT(catch_category("uncategorized", ~(flag32)0, 0) == 0);
+}
+
+// Verify a declared reason is caught by its categories and no others, and declaring it
+// again adds categories without changing its number.
+BUT_TEST("Declared Categories", declared_categories) {
+    static BUTExceptionReason parse_error = "parse error";
+    BUTExceptionContext      *ctx         = BUT_CURRENT_CONTEXT;
+    BUTReasonId               id;
+
+    id = but_declare_reason(ctx, parse_error, BUT_CATEGORY_USER(0));
+    BUT_ASSERT(id != BUT_REASON_ID_NONE);
+    BUT_ASSERT(but_reason_id(ctx, parse_error) == id);
+    BUT_ASSERT(catch_category(parse_error, BUT_CATEGORY_USER(1), BUT_CATEGORY_USER(0))
+               == 2);
+    BUT_ASSERT(catch_category(parse_error, BUT_CATEGORY_ARGUMENT, BUT_CATEGORY_USER(1))
+               == 0);
+
+    BUT_ASSERT(but_declare_reason(ctx, parse_error, BUT_CATEGORY_ARGUMENT) == id);
+    BUT_ASSERT(catch_category(parse_error, BUT_CATEGORY_ARGUMENT, 0) == 1);
+    BUT_ASSERT(catch_category(parse_error, BUT_CATEGORY_USER(0), 0) == 1);
+}
+
+// Leave a section with break (how == 0) or continue (how == 1), from its try block or,
+// after it catches an exception, from its catch block.
+static void leave_section(int how, bool from_catch) {
+    for (int i = 0; i < 2; i++) {
+        BUT_TRY {
+            if (from_catch) {
+                BUT_THROW(test_exception);
+            }
+            if (how == 0) {
+                break;
+            }
+            if (how == 1) {
+                continue;
+            }
+        }
+        BUT_CATCH(test_exception) {
+            if (how == 0) {
+                break;
+            }
+            if (how == 1) {
+                continue;
+            }
+        }
+        BUT_END_TRY;
+    }
+}
+
+// Verify a break or continue in a try or catch block throws but_internal_error instead
+// of leaving its section on the stack, and a break in a loop inside a section still
+// leaves only that loop.
+BUT_TEST("Break and Continue", break_and_continue) {
+    BUTExceptionEnvironment *stack = BUT_CURRENT_CONTEXT->stack;
+
+    for (int how = 0; how < 2; how++) {
+        for (int from_catch = 0; from_catch < 2; from_catch++) {
+            bool left     = false;
+            bool rejected = false;
+
+            BUT_TRY {
+                leave_section(how, from_catch != 0);
+                left = true;
+            }
+            BUT_CATCH(but_internal_error) {
+                rejected = BUT_DETAILS != NULL && strstr(BUT_DETAILS, "BUT_TRY") != NULL;
+            }
+            BUT_END_TRY;
+
+            BUT_ASSERT(rejected);
+            BUT_ASSERT(!left);
+            BUT_ASSERT(BUT_CURRENT_CONTEXT->stack == stack);
+        }
+    }
+
+    int iterations = 0;
+    BUT_TRY {
+        for (int i = 0; i < 4; i++) {
+            if (i == 2) {
+                break;
+            }
+            iterations++;
+        }
+    }
+    BUT_END_TRY;
+    BUT_ASSERT(iterations == 2);
+}
+
+#if defined(BUT_EXCEPTIONS_SEH)
+static void throw_in_try_finally(int *finished) {
+    __try {
+        BUT_THROW(test_exception);
+    }
+    __finally {
+        (*finished)++;
+    }
+}
+
+// Verify unwinding to a section runs the __finally blocks of the frames in between.
+BUT_TEST("Finally on Unwind", seh_finally_on_unwind) {
+    int finished = 0;
+    int caught   = 0;
+
+    BUT_TRY {
+        throw_in_try_finally(&finished);
+    }
+    BUT_CATCH(test_exception) {
+        caught = finished;
+    }
+    BUT_END_TRY;
+
+    BUT_ASSERT(caught == 1);
+    BUT_ASSERT(finished == 1);
+}
+#endif
+
 /**
  * @brief throw an explicit exception that will be caught by the test driver.
  *
@@ -220,6 +503,16 @@ BUT_SUITE_ADD(test_throw_va)
 BUT_SUITE_ADD(test_throw_va_file_line)
 BUT_SUITE_ADD(test_throw_rethrow)
 BUT_SUITE_ADD(test_throw_catch_all)
+BUT_SUITE_ADD(nothing_thrown)
+BUT_SUITE_ADD(nested_rethrow)
+BUT_SUITE_ADD(reason_numbers)
+BUT_SUITE_ADD(details_ring)
+BUT_SUITE_ADD(builtin_categories)
+BUT_SUITE_ADD(declared_categories)
+BUT_SUITE_ADD(break_and_continue)
+#if defined(BUT_EXCEPTIONS_SEH)
+BUT_SUITE_ADD(seh_finally_on_unwind)
+#endif
 BUT_SUITE_ADD(test_failure)
 BUT_SUITE_ADD(setup_failure)
 BUT_SUITE_ADD(cleanup_failure)
@@ -39,24 +39,29 @@ static LoggerContext               g_default_logger_context_
 static char const *level_names[]
     = {"FATAL", "ERROR", "WARN", "INFO", "VERBOSE", "DEBUG", "TRACE"};
 
-static void initialize_g_logger_context_once(void) {
+static void initialize_default_logger_context_once(void) {
+    // Initialize the default logger's mutex
+    if (g_default_logger_context_.logger.output == NULL) {
+        g_default_logger_context_.logger.output = stdout;
+    }
+    if (mtx_init(&g_default_logger_context_.logger.mutex, mtx_plain) != thrd_success) {
+        fprintf(stderr, "Fatal: Failed to initialize default logging mutex\n");
+        abort();
+    }
+}
+
+// The default context is shared by every thread and initialized once, but each thread
+// has its own pointer to its context, so each thread has to point at the default.
+static void initialize_g_logger_context(void) {
+    call_once(&g_logger_context_init_flag, initialize_default_logger_context_once);
     if (g_logger_context_ == NULL) {
         g_logger_context_ = &g_default_logger_context_;
-        // Initialize the default logger's mutex
-        if (g_default_logger_context_.logger.output == NULL) {
-            g_default_logger_context_.logger.output = stdout;
-        }
-        if (mtx_init(&g_default_logger_context_.logger.mutex, mtx_plain)
-            != thrd_success) {
-            fprintf(stderr, "Fatal: Failed to initialize default logging mutex\n");
-            abort();
-        }
     }
 }
 
 // Get current logger context
 LoggerContext *logger_get_context(void) {
-    call_once(&g_logger_context_init_flag, initialize_g_logger_context_once);
+    initialize_g_logger_context();
     return g_logger_context_;
 }
 
@@ -64,7 +69,7 @@ LoggerContext *logger_get_context(void) {
 LoggerContext *logger_set_context(LoggerContext *ctx) {
     assert(ctx != NULL);
 
-    call_once(&g_logger_context_init_flag, initialize_g_logger_context_once);
+    initialize_g_logger_context();
     LoggerContext *previous = g_logger_context_;
     g_logger_context_       = ctx;
     return previous;
@@ -146,7 +151,7 @@ char const *logger_get_filename(char const *path) {
 
 // Initialize logger (call once at startup)
 void logger_init(void) {
-    call_once(&g_logger_context_init_flag, initialize_g_logger_context_once);
+    initialize_g_logger_context();
 }
 
 static void logger_constraint_handler(char const *restrict msg, void *restrict ptr,